@@ -7,7 +7,6 @@
 #include "acmacs-base/string.hh"
 #include "acmacs-base/string-join.hh"
 #include "acmacs-base/enumerate.hh"
-#include "acmacs-virus/virus-name-v1.hh"
 #include "acmacs-chart-2/acd1-import.hh"
 
 using namespace std::string_literals;
@@ -297,7 +296,10 @@ InfoP Acd1Chart::info() const
 
 AntigensP Acd1Chart::antigens() const
 {
-    return std::make_shared<Acd1Antigens>(data_.get("table", "antigens"), mAntigenNameIndex);
+    std::lock_guard<std::mutex> lock{antigens_sera_access_};
+    if (!antigens_)
+        antigens_ = std::make_shared<Acd1Antigens>(data_.get("table", "antigens"));
+    return antigens_;
 
 } // Acd1Chart::antigens
 
@@ -305,7 +307,10 @@ AntigensP Acd1Chart::antigens() const
 
 SeraP Acd1Chart::sera() const
 {
-    return std::make_shared<Acd1Sera>(data_.get("table", "sera"));
+    std::lock_guard<std::mutex> lock{antigens_sera_access_};
+    if (!sera_)
+        sera_ = std::make_shared<Acd1Sera>(data_.get("table", "sera"));
+    return sera_;
 
 } // Acd1Chart::sera
 
@@ -575,33 +580,6 @@ SerumId Acd1Serum::serum_id() const
 
 // ----------------------------------------------------------------------
 
-std::optional<size_t> Acd1Antigens::find_by_full_name(std::string_view aFullName) const
-{
-    if (mAntigenNameIndex.empty())
-        make_name_index();
-    const std::string name(::virus_name::name(aFullName));
-    if (const auto found = mAntigenNameIndex.find(name); found != mAntigenNameIndex.end()) {
-        for (auto index: found->second) {
-            if (Acd1Antigen(data_[index]).format("{name_full}") == aFullName)
-                return index;
-        }
-    }
-    return {};
-
-} // Acd1Antigens::find_by_full_name
-
-// ----------------------------------------------------------------------
-
-void Acd1Antigens::make_name_index() const
-{
-    rjson::for_each(data_, [this](const rjson::value& val, size_t index) {
-        mAntigenNameIndex[*make_name(val)].push_back(index);
-    });
-
-} // Acd1Antigens::make_name_index
-
-// ----------------------------------------------------------------------
-
 // std::string Acd1Projection::comment() const
 // {
 //     try {
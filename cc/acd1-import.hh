@@ -8,11 +8,6 @@
 
 namespace acmacs::chart
 {
-    namespace acd1
-    {
-        using name_index_t = std::map<std::string, std::vector<size_t>>;
-    }
-
     class Acd1Chart : public Chart
     {
       public:
@@ -32,7 +27,9 @@ namespace acmacs::chart
 
      private:
         rjson::value data_;
-        mutable acd1::name_index_t mAntigenNameIndex;
+        mutable std::mutex antigens_sera_access_;
+        mutable AntigensP antigens_; // cached to keep name index of antigens and sera
+        mutable SeraP sera_;
         mutable ProjectionsP projections_;
 
     }; // class Acd1Chart
@@ -130,17 +127,13 @@ namespace acmacs::chart
     class Acd1Antigens : public Antigens
     {
      public:
-        Acd1Antigens(const rjson::value& aData, acd1::name_index_t& aAntigenNameIndex) : data_{aData}, mAntigenNameIndex{aAntigenNameIndex} {}
+        Acd1Antigens(const rjson::value& aData) : data_{aData} {}
 
         size_t size() const override { return data_.size(); }
         AntigenP operator[](size_t aIndex) const override { return std::make_shared<Acd1Antigen>(data_[aIndex]); }
-        std::optional<size_t> find_by_full_name(std::string_view aFullName) const override;
 
      private:
         const rjson::value& data_;
-        acd1::name_index_t& mAntigenNameIndex;
-
-        void make_name_index() const;
 
     }; // class Acd1Antigens
 
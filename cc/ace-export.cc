@@ -5,6 +5,8 @@
 #include "acmacs-chart-2/ace-export.hh"
 #include "acmacs-chart-2/ace.hh"
 #include "acmacs-chart-2/chart.hh"
+#include "acmacs-chart-2/optimize.hh"
+#include "acmacs-chart-2/parallel-chunks.hh"
 
 // ----------------------------------------------------------------------
 
@@ -426,109 +428,159 @@ template std::string acmacs::chart::export_layout<acmacs::DataFormatterCSV>(cons
 
 // ----------------------------------------------------------------------
 
-template <typename DF> std::string acmacs::chart::export_table_map_distances(const Chart& aChart, size_t aProjectionNo)
+namespace
 {
-    auto projection = aChart.projection(aProjectionNo);
-    auto layout = projection->layout();
+    // names are collected once, they are read from parallel formatting
+    std::vector<std::string> point_names_full(const acmacs::chart::Chart& chart)
+    {
+        auto antigens = chart.antigens();
+        auto sera = chart.sera();
+        std::vector<std::string> names;
+        names.reserve(antigens->size() + sera->size());
+        for (const auto& antigen : *antigens)
+            names.push_back(antigen->name_full());
+        for (const auto& serum : *sera)
+            names.push_back(serum->name_full());
+        return names;
+    }
 
-    const auto table_distances = acmacs::chart::table_distances(aChart, projection->minimum_column_basis(), projection->dodgy_titer_is_regular());
-    const MapDistances map_distances(*layout, table_distances);
+    constexpr const size_t records_per_chunk{100000};
 
-    auto antigens = aChart.antigens();
-    auto sera = aChart.sera();
-    auto point_name = [&antigens, &sera](size_t point_no) -> std::string {
-        return point_no < antigens->size() ? antigens->at(point_no)->name_full() : sera->at(point_no - antigens->size())->name_full();
-    };
+} // namespace
+
+// ----------------------------------------------------------------------
 
+template <typename DF> std::string acmacs::chart::export_table_map_distances(const Chart& aChart, size_t aProjectionNo)
+{
     std::string result;
-    for (auto td = table_distances.regular().begin(), md = map_distances.regular().begin(); td != table_distances.regular().end(); ++td, ++md) {
-        DF::first_field(result, point_name(td->point_1));
-        DF::second_field(result, point_name(td->point_2));
-        DF::second_field(result, td->distance);
-        DF::second_field(result, md->distance);
-        DF::end_of_record(result);
-    }
+    export_table_map_distances<DF>(aChart, aProjectionNo, [&result](std::string_view chunk) { result.append(chunk); });
     return result;
 
 } // acmacs::chart::export_table_map_distances
 
+template <typename DF> void acmacs::chart::export_table_map_distances(const Chart& aChart, size_t aProjectionNo, const export_sink_t& sink, int threads)
+{
+    auto projection = aChart.projection(aProjectionNo);
+    auto layout = projection->layout();
+
+    const auto table_distances = acmacs::chart::table_distances(aChart, projection->minimum_column_basis(), projection->dodgy_titer_is_regular());
+    const auto& regular = table_distances.regular();
+    const auto point_name = point_names_full(aChart);
+
+    process_in_chunks<std::string>(
+        regular.size(), records_per_chunk, threads,
+        [&regular, &layout, &point_name](size_t first, size_t last, std::string& chunk) {
+            for (size_t no = first; no < last; ++no) {
+                const auto& td = regular[no];
+                DF::first_field(chunk, point_name[td.point_1]);
+                DF::second_field(chunk, point_name[td.point_2]);
+                DF::second_field(chunk, td.distance);
+                DF::second_field(chunk, layout->distance(td.point_1, td.point_2));
+                DF::end_of_record(chunk);
+            }
+        },
+        sink);
+
+} // acmacs::chart::export_table_map_distances
+
 template std::string acmacs::chart::export_table_map_distances<acmacs::DataFormatterSpaceSeparated>(const Chart& aChart, size_t aProjectionNo);
 template std::string acmacs::chart::export_table_map_distances<acmacs::DataFormatterCSV>(const Chart& aChart, size_t aProjectionNo);
+template void acmacs::chart::export_table_map_distances<acmacs::DataFormatterSpaceSeparated>(const Chart& aChart, size_t aProjectionNo, const export_sink_t& sink, int threads);
+template void acmacs::chart::export_table_map_distances<acmacs::DataFormatterCSV>(const Chart& aChart, size_t aProjectionNo, const export_sink_t& sink, int threads);
 
 // ----------------------------------------------------------------------
 
 template <typename DF> std::string acmacs::chart::export_distances_between_all_points(const Chart& aChart, size_t aProjectionNo)
 {
-    auto projection = aChart.projection(aProjectionNo);
-    auto layout = projection->layout();
-    auto antigens = aChart.antigens();
-    auto sera = aChart.sera();
-    const auto number_of_antigens = antigens->size();
-    const auto number_of_points = number_of_antigens + sera->size();
-
     std::string result;
-    DF::first_field(result, "AG1");
-    DF::second_field(result, "No1");
-    DF::second_field(result, "Name1");
-    DF::second_field(result, "AG2");
-    DF::second_field(result, "No2");
-    DF::second_field(result, "Name2");
-    DF::second_field(result, "Distance");
-    DF::end_of_record(result);
-
-    for (auto point_1 : acmacs::range(number_of_points)) {
-        const auto ag_1 = point_1 < number_of_antigens;
-        const auto no_1 = ag_1 ? point_1 : (point_1 - number_of_antigens);
-        const auto name_1 = ag_1 ? antigens->at(no_1)->name_full() : sera->at(no_1)->name_full();
-        for (auto point_2 : acmacs::range(point_1 + 1, number_of_points)) {
-            const auto ag_2 = point_2 < number_of_antigens;
-            const auto no_2 = ag_2 ? point_2 : (point_2 - number_of_antigens);
-            const auto name_2 = ag_2 ? antigens->at(no_2)->name_full() : sera->at(no_2)->name_full();
-            const auto distance = layout->distance(point_1, point_2);
-
-            DF::first_field(result, ag_1 ? "AG" : "SR");
-            DF::second_field(result, no_1);
-            DF::second_field(result, name_1);
-            DF::second_field(result, ag_2 ? "AG" : "SR");
-            DF::second_field(result, no_2);
-            DF::second_field(result, name_2);
-            DF::second_field(result, distance);
-            DF::end_of_record(result);
-        }
-    }
-
+    export_distances_between_all_points<DF>(aChart, aProjectionNo, [&result](std::string_view chunk) { result.append(chunk); });
     return result;
 
 } // acmacs::chart::export_distances_between_all_points
 
+template <typename DF> void acmacs::chart::export_distances_between_all_points(const Chart& aChart, size_t aProjectionNo, const export_sink_t& sink, int threads)
+{
+    auto projection = aChart.projection(aProjectionNo);
+    auto layout = projection->layout();
+    const auto number_of_antigens = aChart.number_of_antigens();
+    const auto number_of_points = layout->number_of_points();
+    const auto point_name = point_names_full(aChart);
+
+    std::string header;
+    DF::first_field(header, "AG1");
+    DF::second_field(header, "No1");
+    DF::second_field(header, "Name1");
+    DF::second_field(header, "AG2");
+    DF::second_field(header, "No2");
+    DF::second_field(header, "Name2");
+    DF::second_field(header, "Distance");
+    DF::end_of_record(header);
+    sink(header);
+
+    // chunk is a range of the first points, each first point produces (number_of_points - point_1 - 1) records
+    process_in_chunks<std::string>(
+        number_of_points, std::max(records_per_chunk / std::max(number_of_points, size_t{1}), size_t{1}), threads,
+        [&layout, &point_name, number_of_antigens, number_of_points](size_t first, size_t last, std::string& chunk) {
+            for (size_t point_1 = first; point_1 < last; ++point_1) {
+                const auto ag_1 = point_1 < number_of_antigens;
+                const auto no_1 = ag_1 ? point_1 : (point_1 - number_of_antigens);
+                for (size_t point_2 = point_1 + 1; point_2 < number_of_points; ++point_2) {
+                    const auto ag_2 = point_2 < number_of_antigens;
+                    const auto no_2 = ag_2 ? point_2 : (point_2 - number_of_antigens);
+                    DF::first_field(chunk, ag_1 ? "AG" : "SR");
+                    DF::second_field(chunk, no_1);
+                    DF::second_field(chunk, point_name[point_1]);
+                    DF::second_field(chunk, ag_2 ? "AG" : "SR");
+                    DF::second_field(chunk, no_2);
+                    DF::second_field(chunk, point_name[point_2]);
+                    DF::second_field(chunk, layout->distance(point_1, point_2));
+                    DF::end_of_record(chunk);
+                }
+            }
+        },
+        sink);
+
+} // acmacs::chart::export_distances_between_all_points
+
 template std::string acmacs::chart::export_distances_between_all_points<acmacs::DataFormatterSpaceSeparated>(const Chart& aChart, size_t aProjectionNo);
 template std::string acmacs::chart::export_distances_between_all_points<acmacs::DataFormatterCSV>(const Chart& aChart, size_t aProjectionNo);
+template void acmacs::chart::export_distances_between_all_points<acmacs::DataFormatterSpaceSeparated>(const Chart& aChart, size_t aProjectionNo, const export_sink_t& sink, int threads);
+template void acmacs::chart::export_distances_between_all_points<acmacs::DataFormatterCSV>(const Chart& aChart, size_t aProjectionNo, const export_sink_t& sink, int threads);
 
 // ----------------------------------------------------------------------
 
 template <typename DF> std::string acmacs::chart::export_error_lines(const Chart& aChart, size_t aProjectionNo)
 {
-    auto antigens = aChart.antigens();
-    auto sera = aChart.sera();
-    auto point_name = [&antigens, &sera](size_t point_no) -> std::string {
-        return point_no < antigens->size() ? antigens->at(point_no)->name_full() : sera->at(point_no - antigens->size())->name_full();
-    };
-
-    const auto error_lines = aChart.projection(aProjectionNo)->error_lines();
-
     std::string result;
-    for (const auto& el : error_lines) {
-        DF::first_field(result, point_name(el.point_1));
-        DF::second_field(result, point_name(el.point_2));
-        DF::second_field(result, el.error_line);
-        DF::end_of_record(result);
-    }
+    export_error_lines<DF>(aChart, aProjectionNo, [&result](std::string_view chunk) { result.append(chunk); });
     return result;
 
 } // acmacs::chart::export_error_lines
 
+template <typename DF> void acmacs::chart::export_error_lines(const Chart& aChart, size_t aProjectionNo, const export_sink_t& sink, int threads)
+{
+    const auto point_name = point_names_full(aChart);
+    std::string formatted;
+    error_lines(
+        *aChart.projection(aProjectionNo),
+        [&formatted, &point_name, &sink](const ErrorLines& chunk) {
+            formatted.clear();
+            for (const auto& el : chunk) {
+                DF::first_field(formatted, point_name[el.point_1]);
+                DF::second_field(formatted, point_name[el.point_2]);
+                DF::second_field(formatted, el.error_line);
+                DF::end_of_record(formatted);
+            }
+            sink(formatted);
+        },
+        records_per_chunk, threads);
+
+} // acmacs::chart::export_error_lines
+
 template std::string acmacs::chart::export_error_lines<acmacs::DataFormatterSpaceSeparated>(const Chart& aChart, size_t aProjectionNo);
 template std::string acmacs::chart::export_error_lines<acmacs::DataFormatterCSV>(const Chart& aChart, size_t aProjectionNo);
+template void acmacs::chart::export_error_lines<acmacs::DataFormatterSpaceSeparated>(const Chart& aChart, size_t aProjectionNo, const export_sink_t& sink, int threads);
+template void acmacs::chart::export_error_lines<acmacs::DataFormatterCSV>(const Chart& aChart, size_t aProjectionNo, const export_sink_t& sink, int threads);
 
 // ----------------------------------------------------------------------
 /// Local Variables:
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <functional>
 #include "acmacs-base/rjson-v2.hh"
 #include "acmacs-base/data-formatter.hh"
 
@@ -29,6 +30,21 @@ namespace acmacs::chart
     extern template std::string export_error_lines<acmacs::DataFormatterSpaceSeparated>(const Chart& aChart, size_t aProjectionNo);
     extern template std::string export_error_lines<acmacs::DataFormatterCSV>(const Chart& aChart, size_t aProjectionNo);
 
+    // streaming variants for big charts: records are formatted in parallel in chunks and passed to sink sequentially, memory use is bounded by the chunk size
+    using export_sink_t = std::function<void(std::string_view)>;
+
+    template <typename DF> void export_table_map_distances(const Chart& aChart, size_t aProjectionNo, const export_sink_t& sink, int threads = 0);
+    extern template void export_table_map_distances<acmacs::DataFormatterSpaceSeparated>(const Chart& aChart, size_t aProjectionNo, const export_sink_t& sink, int threads);
+    extern template void export_table_map_distances<acmacs::DataFormatterCSV>(const Chart& aChart, size_t aProjectionNo, const export_sink_t& sink, int threads);
+
+    template <typename DF> void export_distances_between_all_points(const Chart& aChart, size_t aProjectionNo, const export_sink_t& sink, int threads = 0);
+    extern template void export_distances_between_all_points<acmacs::DataFormatterSpaceSeparated>(const Chart& aChart, size_t aProjectionNo, const export_sink_t& sink, int threads);
+    extern template void export_distances_between_all_points<acmacs::DataFormatterCSV>(const Chart& aChart, size_t aProjectionNo, const export_sink_t& sink, int threads);
+
+    template <typename DF> void export_error_lines(const Chart& aChart, size_t aProjectionNo, const export_sink_t& sink, int threads = 0);
+    extern template void export_error_lines<acmacs::DataFormatterSpaceSeparated>(const Chart& aChart, size_t aProjectionNo, const export_sink_t& sink, int threads);
+    extern template void export_error_lines<acmacs::DataFormatterCSV>(const Chart& aChart, size_t aProjectionNo, const export_sink_t& sink, int threads);
+
 } // namespace acmacs::chart
 
 // ----------------------------------------------------------------------
@@ -6,7 +6,6 @@
 #include "acmacs-base/string.hh"
 #include "acmacs-base/enumerate.hh"
 #include "acmacs-base/timeit.hh"
-#include "acmacs-virus/virus-name-v1.hh"
 #include "acmacs-chart-2/ace-import.hh"
 #include "acmacs-chart-2/ace.hh"
 
@@ -90,7 +89,10 @@ InfoP AceChart::info() const
 
 AntigensP AceChart::antigens() const
 {
-    return std::make_shared<AceAntigens>(data_.get("c", "a"), mAntigenNameIndex);
+    std::lock_guard<std::mutex> lock{antigens_sera_access_};
+    if (!antigens_)
+        antigens_ = std::make_shared<AceAntigens>(data_.get("c", "a"));
+    return antigens_;
 
 } // AceChart::antigens
 
@@ -98,7 +100,10 @@ AntigensP AceChart::antigens() const
 
 SeraP AceChart::sera() const
 {
-    return std::make_shared<AceSera>(data_.get("c", "s"));
+    std::lock_guard<std::mutex> lock{antigens_sera_access_};
+    if (!sera_)
+        sera_ = std::make_shared<AceSera>(data_.get("c", "s"));
+    return sera_;
 
 } // AceChart::sera
 
@@ -240,43 +245,6 @@ BLineage AceSerum::lineage() const
 
 // ----------------------------------------------------------------------
 
-std::optional<size_t> AceAntigens::find_by_full_name(std::string_view aFullName) const
-{
-    if (mAntigenNameIndex.empty())
-        make_name_index();
-    const auto name = ::virus_name::name(aFullName);
-    if (const auto found = mAntigenNameIndex.find(name); found != mAntigenNameIndex.end()) {
-        for (auto index: found->second) {
-            if (AceAntigen(data_[index]).format("{name_full}") == aFullName)
-                return index;
-        }
-    }
-    return {};
-
-} // AceAntigens::find_by_full_name
-
-// std::optional<size_t> AceAntigens::find_by_full_name(std::string_view aFullName) const
-// {
-//     const std::string_view name{virus_name::name(aFullName)};
-//     for (auto iter = data_.begin(); iter != data_.end(); ++iter) {
-//         if ((*iter)["N"] == name && AceAntigen(*iter).format("{name_full}") == aFullName) {
-//             return static_cast<size_t>(iter - data_.begin());
-//         }
-//     }
-//     return {};
-
-// } // AceAntigens::find_by_full_name
-
-// ----------------------------------------------------------------------
-
-void AceAntigens::make_name_index() const
-{
-    rjson::for_each(data_, [this](const rjson::value& val, size_t index) { mAntigenNameIndex[val["N"].to<std::string_view>()].push_back(index); });
-
-} // AceAntigens::make_name_index
-
-// ----------------------------------------------------------------------
-
 // std::shared_ptr<Layout> AceProjection::layout() const
 // {
 //     if (!layout_)
@@ -8,11 +8,6 @@
 
 namespace acmacs::chart
 {
-    namespace ace
-    {
-        using name_index_t = std::map<std::string_view, std::vector<size_t>>;
-    }
-
     class AceChart : public Chart
     {
       public:
@@ -36,7 +31,9 @@ namespace acmacs::chart
 
      private:
         rjson::value data_;
-        mutable ace::name_index_t mAntigenNameIndex;
+        mutable std::mutex antigens_sera_access_;
+        mutable AntigensP antigens_; // cached to keep name index of antigens and sera
+        mutable SeraP sera_;
         mutable ProjectionsP projections_;
 
     }; // class AceChart
@@ -127,17 +124,13 @@ namespace acmacs::chart
     class AceAntigens : public Antigens
     {
      public:
-        AceAntigens(const rjson::value& aData, ace::name_index_t& aAntigenNameIndex) : data_{aData}, mAntigenNameIndex{aAntigenNameIndex} {}
+        AceAntigens(const rjson::value& aData) : data_{aData} {}
 
         size_t size() const override { return data_.size(); }
         AntigenP operator[](size_t aIndex) const override { return std::make_shared<AceAntigen>(data_[aIndex]); }
-        std::optional<size_t> find_by_full_name(std::string_view aFullName) const override;
 
      private:
         const rjson::value& data_;
-        ace::name_index_t& mAntigenNameIndex;
-
-        void make_name_index() const;
 
     }; // class AceAntigens
 
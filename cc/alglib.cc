@@ -67,26 +67,11 @@ namespace alglib
 
 // ----------------------------------------------------------------------
 
-inline std::pair<double, double> eps(acmacs::chart::optimization_precision precision)
-{
-    switch (precision) {
-      case acmacs::chart::optimization_precision::rough:
-          return {0.5, 1e-3};
-      case acmacs::chart::optimization_precision::very_rough:
-          return {1.0, 0.1};
-      case acmacs::chart::optimization_precision::fine:
-          return {1e-10, 0.0};
-    }
-    return {1e-10, 0.0};
-}
-
-// ----------------------------------------------------------------------
-
 void alglib::lbfgs_optimize(acmacs::chart::optimization_status& status, acmacs::chart::OptimiserCallbackData& callback_data, double* arg_first, double* arg_last,
                             acmacs::chart::optimization_precision precision)
 {
     try {
-        const auto [epsg, epsx] = eps(precision);
+        const auto [epsg, epsx] = acmacs::chart::optimization_epsilon(precision);
         const double epsf = 0;
         const double stpmax = 0.1;
         const ae_int_t max_iterations = 0;
@@ -147,7 +132,7 @@ void alglib::cg_optimize(acmacs::chart::optimization_status& status, acmacs::cha
                          acmacs::chart::optimization_precision precision)
 {
     try {
-        const auto [epsg, epsx] = eps(precision);
+        const auto [epsg, epsx] = acmacs::chart::optimization_epsilon(precision);
         const double epsf = 0;
         const ae_int_t max_iterations = 0;
 
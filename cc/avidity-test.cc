@@ -1,19 +1,94 @@
+#include <numeric>
+
 #include "acmacs-base/range-v3.hh"
+#include "acmacs-base/omp.hh"
 #include "acmacs-chart-2/avidity-test.hh"
 #include "acmacs-chart-2/chart-modify.hh"
 #include "acmacs-chart-2/optimize.hh"
 #include "acmacs-chart-2/procrustes.hh"
+#include "acmacs-chart-2/stress.hh"
+
+// ----------------------------------------------------------------------
+
+namespace
+{
+    // the same layout as used by procrustes(const Projection&, ...)
+    inline acmacs::Layout procrustes_primary(const acmacs::chart::ProjectionModify& projection)
+    {
+        return projection.number_of_dimensions() == acmacs::number_of_dimensions_t{2} ? *projection.transformed_layout() : *projection.layout();
+    }
+
+    // data shared by all avidity tests of a projection
+    struct TestData
+    {
+        TestData(acmacs::chart::ChartModify& chart, const acmacs::chart::ProjectionModify& original_projection, const acmacs::chart::optimization_options& a_options)
+            : options{a_options}, number_of_antigens{chart.number_of_antigens()}, original_stress{original_projection.stress()}, original_layout{*original_projection.layout()},
+              procrustes_primary_layout{procrustes_primary(original_projection)}, original_logged_adjusts{original_projection.avidity_adjusts().logged(chart.number_of_antigens() + chart.number_of_sera())},
+              stress{acmacs::chart::stress_factory(original_projection, acmacs::chart::multiply_antigen_titer_until_column_adjust::no)},
+              entry_indexes{stress.table_distances().entry_indexes(chart.number_of_antigens() + chart.number_of_sera())},
+              common_points{acmacs::chart::CommonAntigensSera{chart}.points()}
+        {
+        }
+
+        const acmacs::chart::optimization_options options;
+        const size_t number_of_antigens;
+        const double original_stress;
+        const acmacs::Layout original_layout;
+        const acmacs::Layout procrustes_primary_layout;
+        const std::vector<double> original_logged_adjusts;
+        const acmacs::chart::Stress stress; // table distances are not clamped (mult is applied after adjusting)
+        const std::vector<acmacs::chart::TableDistances::EntryIndexes> entry_indexes; // per point
+        const std::vector<acmacs::chart::CommonAntigensSera::common_t> common_points;
+    };
+
+    acmacs::chart::avidity::PerAdjust make_per_adjust(const acmacs::Layout& original_layout, const acmacs::Layout& procrustes_primary_layout, const acmacs::Layout& layout,
+                                                      const std::vector<acmacs::chart::CommonAntigensSera::common_t>& common_points, size_t number_of_antigens, size_t antigen_no, double logged_adjust,
+                                                      double stress_diff);
+    acmacs::chart::avidity::PerAdjust make_per_adjust(const acmacs::chart::ProcrustesSummary& summary, const acmacs::Layout& layout, size_t antigen_no, double logged_adjust, double stress_diff);
+
+    // antigen being tested is excluded from the most moved list
+    inline acmacs::chart::ProcrustesSummaryParameters summary_parameters(size_t number_of_antigens, size_t antigen_no)
+    {
+        return {.number_of_antigens = number_of_antigens, .antigen_being_tested = antigen_no, .vaccine_antigen = std::nullopt, .number_of_most_moved = acmacs::chart::avidity::number_of_most_moved_antigens + 1};
+    }
+
+    // stress owned by a thread, avidity adjust of the antigen being tested is applied to its table distance entries only and undone after relaxation
+    class AdjustStress
+    {
+      public:
+        AdjustStress(const TestData& data) : data_{data}, stress_{data.stress} { stress_.table_distances().apply_mult(data.options.mult); }
+
+        // layout: starting layout, replaced with the optimized one, returns stress diff
+        double relax(size_t antigen_no, double logged_adjust, acmacs::Layout& layout)
+        {
+            auto& table_distances = stress_.table_distances();
+            table_distances.set_logged_adjust(data_.entry_indexes[antigen_no], data_.stress.table_distances(), logged_adjust - data_.original_logged_adjusts[antigen_no], data_.options.mult);
+            const auto status = acmacs::chart::optimize(data_.options.method, stress_, layout.data(), layout.data() + layout.size(), data_.options.precision);
+            table_distances.set_logged_adjust(data_.entry_indexes[antigen_no], data_.stress.table_distances(), 0.0, data_.options.mult);
+            return status.final_stress - data_.original_stress;
+        }
+
+        // layout: starting layout, replaced with the optimized one
+        acmacs::chart::avidity::PerAdjust test(size_t antigen_no, double logged_adjust, acmacs::Layout& layout)
+        {
+            const auto stress_diff = relax(antigen_no, logged_adjust, layout);
+            return make_per_adjust(data_.original_layout, data_.procrustes_primary_layout, layout, data_.common_points, data_.number_of_antigens, antigen_no, logged_adjust, stress_diff);
+        }
+
+      private:
+        const TestData& data_;
+        acmacs::chart::Stress stress_;
+    };
+
+} // namespace
 
 // ----------------------------------------------------------------------
 
 acmacs::chart::avidity::Results acmacs::chart::avidity::test(ChartModify& chart, size_t projection_no, const Settings& settings, const optimization_options& options)
 {
-    auto projection = chart.projection_modify(projection_no);
-    Results results{.original_stress = projection->stress()};
-    for (size_t ag_no{0}; ag_no < chart.number_of_antigens(); ++ag_no)
-        results.results.push_back(test(chart, *projection, ag_no, settings, options));
-    results.post_process();
-    return results;
+    std::vector<size_t> antigens_to_test(chart.number_of_antigens());
+    std::iota(antigens_to_test.begin(), antigens_to_test.end(), 0UL);
+    return test(chart, projection_no, antigens_to_test, settings, options);
 
 } // acmacs::chart::avidity::test
 
@@ -22,9 +97,45 @@ acmacs::chart::avidity::Results acmacs::chart::avidity::test(ChartModify& chart,
 acmacs::chart::avidity::Results acmacs::chart::avidity::test(ChartModify& chart, size_t projection_no, const std::vector<size_t>& antigens_to_test, const Settings& settings, const optimization_options& options)
 {
     auto projection = chart.projection_modify(projection_no);
-    Results results{.original_stress = projection->stress()};
+    const TestData data{chart, *projection, options};
+    Results results{.original_stress = data.original_stress};
+
+    // low avidity adjusts followed by high avidity adjusts for each antigen (the same order as in the sequential test)
+    std::vector<double> adjusts;
+    for (double adjust = settings.step; adjust <= settings.max_adjust; adjust += settings.step)
+        adjusts.push_back(adjust);
+    const auto number_of_low = adjusts.size();
+    for (double adjust = - settings.step; adjust >= settings.min_adjust; adjust -= settings.step)
+        adjusts.push_back(adjust);
+
     for (size_t ag_no : antigens_to_test)
-        results.results.push_back(test(chart, *projection, ag_no, settings, options));
+        results.results.push_back(Result{.antigen_no = ag_no, .best_logged_adjust = 0.0, .original = data.original_layout.at(ag_no), .adjusts = {}});
+
+    // tasks: (antigen, direction), adjusts of the same direction are tested sequentially, each (if warm_start) starting from the layout of the previous one
+    const size_t number_of_tasks = results.results.size() * 2;
+    std::vector<std::vector<PerAdjust>> per_task(number_of_tasks);
+    const int num_threads = settings.threads == 0 ? omp_get_max_threads() : static_cast<int>(settings.threads);
+
+#pragma omp parallel default(none) shared(data, results, adjusts, number_of_low, per_task, settings, number_of_tasks) num_threads(num_threads)
+    {
+        AdjustStress stress{data};
+#pragma omp for schedule(dynamic)
+        for (size_t task_no = 0; task_no < number_of_tasks; ++task_no) {
+            const auto antigen_no = results.results[task_no / 2].antigen_no;
+            const auto [first, last] = (task_no % 2) == 0 ? std::pair{size_t{0}, number_of_low} : std::pair{number_of_low, adjusts.size()};
+            acmacs::Layout layout{data.original_layout};
+            for (size_t adjust_no = first; adjust_no < last; ++adjust_no) {
+                if (!settings.warm_start)
+                    layout = data.original_layout;
+                per_task[task_no].push_back(stress.test(antigen_no, adjusts[adjust_no], layout));
+            }
+        }
+    }
+
+    for (size_t task_no = 0; task_no < number_of_tasks; ++task_no) {
+        auto& target = results.results[task_no / 2].adjusts;
+        std::move(per_task[task_no].begin(), per_task[task_no].end(), std::back_inserter(target));
+    }
     results.post_process();
     return results;
 
@@ -35,13 +146,35 @@ acmacs::chart::avidity::Results acmacs::chart::avidity::test(ChartModify& chart,
 acmacs::chart::avidity::Result acmacs::chart::avidity::test(ChartModify& chart, const ProjectionModify& original_projection, size_t antigen_no, const Settings& settings,
                                                             const optimization_options& options)
 {
-    Result result{.antigen_no = antigen_no, .best_logged_adjust = 0.0, .original = original_projection.layout()->at(antigen_no)};
+    const TestData data{chart, original_projection, options};
+    Result result{.antigen_no = antigen_no, .best_logged_adjust = 0.0, .original = data.original_layout.at(antigen_no), .adjusts = {}};
+
+    // relaxations are sequential (for warm start), procrustes and summaries for all adjusts are computed afterwards in parallel
+    std::vector<double> adjusts, stress_diffs;
+    std::vector<std::shared_ptr<acmacs::Layout>> layouts;
+    AdjustStress stress{data};
+    const auto test_direction = [&](double first_adjust, double step, auto in_range) {
+        acmacs::Layout layout{data.original_layout};
+        for (double adjust = first_adjust; in_range(adjust); adjust += step) {
+            if (!settings.warm_start)
+                layout = data.original_layout;
+            adjusts.push_back(adjust);
+            stress_diffs.push_back(stress.relax(antigen_no, adjust, layout));
+            layouts.push_back(std::make_shared<acmacs::Layout>(layout));
+        }
+    };
     // low avidity
-    for (double adjust = settings.step; adjust <= settings.max_adjust; adjust += settings.step)
-        result.adjusts.push_back(test(chart, original_projection, antigen_no, adjust, options));
+    test_direction(settings.step, settings.step, [&settings](double adjust) { return adjust <= settings.max_adjust; });
     // high avidity
-    for (double adjust = - settings.step; adjust >= settings.min_adjust; adjust -= settings.step)
-        result.adjusts.push_back(test(chart, original_projection, antigen_no, adjust, options));
+    test_direction(- settings.step, - settings.step, [&settings](double adjust) { return adjust >= settings.min_adjust; });
+
+    const auto threads = static_cast<int>(settings.threads);
+    const auto oriented = procrustes(data.procrustes_primary_layout, layouts, data.common_points, procrustes_scaling_t::no, threads);
+    std::vector<std::shared_ptr<acmacs::Layout>> transformed(oriented.size());
+    std::transform(oriented.begin(), oriented.end(), transformed.begin(), [](const auto& pc_data) { return pc_data.secondary_transformed; });
+    const auto summaries = procrustes_summary(data.original_layout, transformed, {summary_parameters(data.number_of_antigens, antigen_no)}, threads);
+    for (size_t adjust_no = 0; adjust_no < adjusts.size(); ++adjust_no)
+        result.adjusts.push_back(make_per_adjust(summaries[adjust_no], *layouts[adjust_no], antigen_no, adjusts[adjust_no], stress_diffs[adjust_no]));
 
     return result;
 
@@ -63,36 +196,57 @@ acmacs::chart::avidity::PerAdjust acmacs::chart::avidity::test(ChartModify& char
     const auto status = optimize(options.method, stress, layout->data(), layout->data() + layout->size(), options.precision);
     // AD_DEBUG("avidity relax AG {} adjust:{:4.1f} stress: {:10.4f} diff: {:8.4f}", antigen_no, logged_adjust, status.final_stress, status.final_stress - original_stress);
 
-    const auto pc_data = procrustes(original_projection, *projection, CommonAntigensSera{chart}.points(), procrustes_scaling_t::no);
-    // AD_DEBUG("AG {} pc-rms:{}", antigen_no, pc_data.rms);
-    const auto summary = procrustes_summary(*original_projection.layout(), *pc_data.secondary_transformed,
-                                            ProcrustesSummaryParameters{.number_of_antigens = chart.number_of_antigens(), .antigen_being_tested = antigen_no});
-
-    PerAdjust result{.logged_adjust = logged_adjust,
-                     .distance_test_antigen = summary.antigen_distances[antigen_no],
-                     .angle_test_antigen = summary.test_antigen_angle,
-                     .average_procrustes_distances_except_test_antigen = summary.average_distance,
-                     .final_coordinates = layout->at(antigen_no),
-                     .stress_diff = status.final_stress - original_stress};
-    size_t most_moved_no{0};
-    for (const auto ag_no : summary.antigens_by_distance) {
-        if (ag_no != antigen_no) { // do not put antigen being tested into the most moved list
-            result.most_moved[most_moved_no] = MostMoved{ag_no, summary.antigen_distances[ag_no]};
-            ++most_moved_no;
-            if (most_moved_no >= result.most_moved.size())
-                break;
-        }
-    }
-    // if (parameters().validVaccineAntigen()) {
-    //     result.distance_vaccine_to_test_antigen = summary.distance_vaccine_to_test_antigen;
-    //     result.angle_vaccine_to_test_antigen = summary.angle_vaccine_to_test_antigen;
-    // }
-    return result;
+    return make_per_adjust(*original_projection.layout(), procrustes_primary(original_projection), *layout, CommonAntigensSera{chart}.points(), chart.number_of_antigens(), antigen_no, logged_adjust, status.final_stress - original_stress);
 
 } // acmacs::chart::avidity::test
 
 // ----------------------------------------------------------------------
 
+namespace
+{
+    acmacs::chart::avidity::PerAdjust make_per_adjust(const acmacs::Layout& original_layout, const acmacs::Layout& procrustes_primary_layout, const acmacs::Layout& layout,
+                                                      const std::vector<acmacs::chart::CommonAntigensSera::common_t>& common_points, size_t number_of_antigens, size_t antigen_no, double logged_adjust,
+                                                      double stress_diff)
+    {
+        using namespace acmacs::chart;
+        const auto pc_data = procrustes(procrustes_primary_layout, layout, common_points, procrustes_scaling_t::no);
+        // AD_DEBUG("AG {} pc-rms:{}", antigen_no, pc_data.rms);
+        return make_per_adjust(procrustes_summary(original_layout, *pc_data.secondary_transformed, summary_parameters(number_of_antigens, antigen_no)), layout, antigen_no, logged_adjust, stress_diff);
+
+    } // make_per_adjust
+
+    // ----------------------------------------------------------------------
+
+    acmacs::chart::avidity::PerAdjust make_per_adjust(const acmacs::chart::ProcrustesSummary& summary, const acmacs::Layout& layout, size_t antigen_no, double logged_adjust, double stress_diff)
+    {
+        using namespace acmacs::chart;
+        avidity::PerAdjust result{.logged_adjust = logged_adjust,
+                                  .distance_test_antigen = summary.antigen_distances[antigen_no],
+                                  .angle_test_antigen = summary.test_antigen_angle,
+                                  .average_procrustes_distances_except_test_antigen = summary.average_distance,
+                                  .final_coordinates = layout.at(antigen_no),
+                                  .stress_diff = stress_diff};
+        size_t most_moved_no{0};
+        for (const auto ag_no : summary.antigens_by_distance) {
+            if (ag_no != antigen_no) { // do not put antigen being tested into the most moved list
+                result.most_moved[most_moved_no] = avidity::MostMoved{ag_no, summary.antigen_distances[ag_no]};
+                ++most_moved_no;
+                if (most_moved_no >= result.most_moved.size())
+                    break;
+            }
+        }
+        // if (parameters().validVaccineAntigen()) {
+        //     result.distance_vaccine_to_test_antigen = summary.distance_vaccine_to_test_antigen;
+        //     result.angle_vaccine_to_test_antigen = summary.angle_vaccine_to_test_antigen;
+        // }
+        return result;
+
+    } // make_per_adjust
+
+} // namespace
+
+// ----------------------------------------------------------------------
+
 void acmacs::chart::avidity::Result::post_process()
 {
     if (const auto best = std::min_element(std::begin(adjusts), std::end(adjusts), [](const auto& en1, const auto& en2) { return en1.stress_diff < en2.stress_diff; });
@@ -77,10 +77,11 @@ namespace acmacs::chart
             double step{1.0};
             double min_adjust{-6.0};
             double max_adjust{6.0};
-            size_t threads{0};
+            size_t threads{0};      // 0 - omp_get_max_threads()
+            bool warm_start{false}; // optimization for an adjust starts from the result of the previous adjust of the same antigen and direction, results differ from the original layout start
         };
 
-        // test all antigens
+        // test all antigens, (antigen, low/high avidity) sweeps are run in parallel
         Results test(ChartModify& chart, size_t projection_no, const Settings& settings, const optimization_options& options);
         // test some antigens
         Results test(ChartModify& chart, size_t projection_no, const std::vector<size_t>& antigens_to_test, const Settings& settings, const optimization_options& options);
@@ -1,32 +1,26 @@
-#include <array>
+#include <numeric>
+#include <optional>
 
 #include "acmacs-chart-2/blobs.hh"
 #include "acmacs-base/layout.hh"
+#include "acmacs-base/omp.hh"
 #include "acmacs-chart-2/stress.hh"
 #include "acmacs-chart-2/point-index-list.hh"
 
-// http://docs.rexamine.com/R-devel/contour-common_8h.html
-
-// Suspended on 2019-02-25
-
-// Possible implementation
-// Move point in a grid and calculate stress or stress diff, the same
-// as in hemi-grid-test.
-// Infer contour(s) for the points within stress_diff and store them,
-// perhaps as a vector of points in order of drawing the contour.
+// Blob of a point: for each direction (ray from the point position) the
+// distance at which stress increases by stress_diff when just this point
+// is moved along the ray. Moving one point changes just its contribution to
+// the stress, so stress diff is contribution(moved) - contribution(original).
+// Radius is bracketed by doubling and then refined by regula falsi
+// (Illinois modification) until stress diff is within stress_diff_precision.
 
 // ----------------------------------------------------------------------
 
 void acmacs::chart::Blobs::calculate(const acmacs::Layout& layout, const Stress& stress)
 {
-    if (layout.number_of_dimensions() != number_of_dimensions_t{2})
-        throw std::runtime_error("wrong number of dimensions for blobs");
-    acmacs::Layout layout_for_blobs{layout};
-    const auto initial_stress = stress.value(layout_for_blobs);
-    for (size_t point_no = 0; point_no < layout_for_blobs.number_of_points(); ++point_no) {
-        calculate_for_point(point_no, layout_for_blobs, stress, initial_stress);
-        layout_for_blobs.update(point_no, layout[point_no]);
-    }
+    std::vector<size_t> points(layout.number_of_points());
+    std::iota(points.begin(), points.end(), 0UL);
+    calculate_for_points(layout, points, stress);
 
 } // acmacs::chart::Blobs::calculate
 
@@ -34,22 +28,87 @@ void acmacs::chart::Blobs::calculate(const acmacs::Layout& layout, const Stress&
 
 void acmacs::chart::Blobs::calculate(const acmacs::Layout& layout, const PointIndexList& points, const Stress& stress)
 {
-    if (layout.number_of_dimensions() != number_of_dimensions_t{2})
-        throw std::runtime_error("wrong number of dimensions for blobs");
-    acmacs::Layout layout_for_blobs{layout};
-    const auto initial_stress = stress.value(layout_for_blobs);
-    for (size_t point_no : points) {
-        calculate_for_point(point_no, layout_for_blobs, stress, initial_stress);
-        layout_for_blobs.update(point_no, layout[point_no]);
-    }
+    calculate_for_points(layout, std::vector<size_t>(points.begin(), points.end()), stress);
 
 } // acmacs::chart::Blobs::calculate
 
 // ----------------------------------------------------------------------
 
-void acmacs::chart::Blobs::calculate_for_point(size_t /*point_no*/, acmacs::Layout& /*layout*/, const Stress& /*stress*/, double /*initial_stress*/)
+void acmacs::chart::Blobs::calculate_for_points(const acmacs::Layout& layout, const std::vector<size_t>& points, const Stress& stress)
 {
-} // acmacs::chart::Blobs::calculate
+    if (layout.number_of_dimensions() != number_of_dimensions_t{2})
+        throw std::runtime_error("wrong number of dimensions for blobs");
+    result_.resize(layout.number_of_points());
+
+    // table distances and contribution at the original position for each point to calculate
+    std::vector<std::optional<Stress::TableDistancesForPoint>> table_distances(points.size());
+    std::vector<double> initial_contribution(points.size());
+#pragma omp parallel for default(none) shared(layout, points, stress, table_distances, initial_contribution) schedule(dynamic)
+    for (size_t index = 0; index < points.size(); ++index) {
+        table_distances[index].emplace(stress.table_distances_for(points[index]));
+        initial_contribution[index] = stress.contribution(points[index], *table_distances[index], layout.data());
+    }
+    for (size_t index = 0; index < points.size(); ++index) {
+        if (!table_distances[index]->empty() && layout.at(points[index]).exists())
+            result_[points[index]].assign(number_of_drections_, 0.0);
+    }
+
+    // (point, direction) pairs are processed in parallel, each thread moves points in its own copy of the layout
+#pragma omp parallel default(none) shared(layout, points, stress, table_distances, initial_contribution)
+    {
+        acmacs::Layout moved{layout};
+#pragma omp for schedule(dynamic, 4)
+        for (size_t task_no = 0; task_no < points.size() * number_of_drections_; ++task_no) {
+            const auto index = task_no / number_of_drections_, direction_no = task_no % number_of_drections_;
+            const auto point_no = points[index];
+            if (result_[point_no].empty())
+                continue;
+            const double x0 = layout.coordinate(point_no, number_of_dimensions_t{0}), y0 = layout.coordinate(point_no, number_of_dimensions_t{1});
+            const auto angle = angle_step_ * static_cast<double>(direction_no);
+            const auto dx = std::cos(angle), dy = std::sin(angle);
+            double* coord = moved.data() + point_no * 2;
+            // stress diff at radius minus target stress diff
+            const auto excess = [&](double radius) {
+                coord[0] = x0 + dx * radius;
+                coord[1] = y0 + dy * radius;
+                return stress.contribution(point_no, *table_distances[index], moved.data()) - initial_contribution[index] - stress_diff_;
+            };
+
+            double r_lo{0.0}, f_lo{-stress_diff_}, r_hi{0.1}, f_hi{excess(r_hi)};
+            for (size_t step = 0; f_hi < 0.0 && step < 30; ++step) { // up to 0.1 * 2^30
+                r_lo = r_hi;
+                f_lo = f_hi;
+                r_hi *= 2.0;
+                f_hi = excess(r_hi);
+            }
+            if (f_hi >= 0.0) {
+                int retained_side{0};
+                for (size_t step = 0; step < 100 && std::abs(f_hi) > stress_diff_precision_ && (r_hi - r_lo) > stress_diff_precision_; ++step) {
+                    const auto radius = (r_lo * f_hi - r_hi * f_lo) / (f_hi - f_lo);
+                    const auto f_radius = excess(radius);
+                    if (f_radius < 0.0) {
+                        r_lo = radius;
+                        f_lo = f_radius;
+                        if (retained_side == -1)
+                            f_hi /= 2.0;
+                        retained_side = -1;
+                    }
+                    else {
+                        r_hi = radius;
+                        f_hi = f_radius;
+                        if (retained_side == 1)
+                            f_lo /= 2.0;
+                        retained_side = 1;
+                    }
+                }
+            }
+            result_[point_no][direction_no] = r_hi; // if stress diff is not reached within the bracketing range, the largest tested radius
+            coord[0] = x0;
+            coord[1] = y0;
+        }
+    }
+
+} // acmacs::chart::Blobs::calculate_for_points
 
 // ----------------------------------------------------------------------
 
@@ -3,13 +3,7 @@
 #include <cmath>
 #include <vector>
 #include <string>
-#include <algorithm>
-
-#ifdef __clang__
-# define MAYBE_UNUSED [[maybe_unused]]
-#else
-# define MAYBE_UNUSED
-#endif
+#include <stdexcept>
 
 // ----------------------------------------------------------------------
 
@@ -35,21 +29,22 @@ namespace acmacs::chart
         constexpr auto number_of_drections() const { return number_of_drections_; }
         constexpr auto angle_step() const { return angle_step_; }
 
+        // radius of the blob for each direction, direction_no * angle_step() is the angle of the ray
         const std::vector<double>& data_for_point(size_t point_no) const
         {
-            if (const auto found = std::find_if(std::begin(result_), std::end(result_), [point_no](const auto& entry) { return entry.first == point_no; }); found != std::end(result_))
-                return found->second;
+            if (point_no < result_.size() && !result_[point_no].empty())
+                return result_[point_no];
             throw std::runtime_error("Blobs::data_for_point: blob for point " + std::to_string(point_no) + " was not calculated");
         }
 
       private:
-        MAYBE_UNUSED const double stress_diff_;
+        const double stress_diff_;
         const size_t number_of_drections_;
-        MAYBE_UNUSED const double stress_diff_precision_;
+        const double stress_diff_precision_;
         const double angle_step_;
-        std::vector<std::pair<size_t, std::vector<double>>> result_; // point_no, blob_data
+        std::vector<std::vector<double>> result_; // point_no -> blob_data, empty if not calculated
 
-        void calculate_for_point(size_t point_no, acmacs::Layout& layout, const Stress& stress, double initial_stress);
+        void calculate_for_points(const acmacs::Layout& layout, const std::vector<size_t>& points, const Stress& stress);
 
     }; // class Blobs
 
@@ -0,0 +1,303 @@
+#include <filesystem>
+#include <algorithm>
+#include <set>
+#include <optional>
+
+#include "acmacs-base/log.hh"
+#include "acmacs-base/omp.hh"
+#include "acmacs-base/enumerate.hh"
+#include "acmacs-base/to-json.hh"
+#include "acmacs-base/rjson-v2.hh"
+#include "acmacs-base/read-file.hh"
+#include "acmacs-chart-2/chart-archive-index.hh"
+#include "acmacs-chart-2/factory-import.hh"
+#include "acmacs-chart-2/chart.hh"
+
+// ----------------------------------------------------------------------
+
+namespace
+{
+    // names of an imported chart before interning, collected in parallel
+    struct imported_t
+    {
+        size_t chart_no;                   // in the new list of charts
+        std::optional<size_t> indexed_no; // in the current list of charts if chart was indexed before
+        acmacs::chart::ChartArchiveIndex::chart_t chart;
+        std::vector<std::string> antigen_names, antigens, sera;
+        std::string error;
+    };
+
+    inline void make_postings(std::vector<acmacs::chart::ChartArchiveIndex::postings_t>& postings, size_t number_of_names, size_t chart_no, const std::vector<acmacs::chart::ChartArchiveIndex::name_id_t>& ids)
+    {
+        postings.resize(number_of_names);
+        for (const auto id : ids) {
+            if (auto& target = postings[id]; !target.empty() && target.back().chart_no == chart_no)
+                ++target.back().count;
+            else
+                target.push_back({chart_no, 1});
+        }
+    }
+
+} // namespace
+
+// ----------------------------------------------------------------------
+
+size_t acmacs::chart::ChartArchiveIndex::update(const std::vector<std::string_view>& filenames, int threads)
+{
+    // indexed charts are checked first, then new ones in the order of filenames
+    std::vector<std::string_view> candidates;
+    std::set<std::string_view, std::less<>> seen;
+    for (const auto& chart : charts_) {
+        seen.insert(chart.filename);
+        candidates.push_back(chart.filename);
+    }
+    for (const auto& filename : filenames) {
+        if (!filename.empty() && seen.insert(filename).second)
+            candidates.push_back(filename);
+    }
+
+    std::vector<chart_t> charts;
+    std::vector<imported_t> to_import;
+    for (auto [candidate_no, filename] : acmacs::enumerate(candidates)) {
+        const auto indexed = candidate_no < charts_.size();
+        std::error_code ec;
+        const auto mtime = static_cast<long>(std::filesystem::last_write_time(filename, ec).time_since_epoch().count());
+        const auto size = ec ? std::uintmax_t{0} : std::filesystem::file_size(filename, ec);
+        if (ec) {
+            if (indexed)
+                AD_INFO("chart archive index: {} removed: {}", filename, ec.message());
+            else
+                AD_WARNING("{}: {}", filename, ec.message());
+            continue;
+        }
+        if (indexed && charts_[candidate_no].mtime == mtime && charts_[candidate_no].size == size) {
+            charts.push_back(std::move(charts_[candidate_no]));
+        }
+        else {
+            to_import.push_back(imported_t{.chart_no = charts.size(),
+                                           .indexed_no = indexed ? std::optional<size_t>{candidate_no} : std::nullopt,
+                                           .chart = chart_t{.filename = std::string{filename}, .mtime = mtime, .size = size}});
+            charts.emplace_back();
+        }
+    }
+
+    // charts are imported lazily, i.e. just info, antigens and sera are extracted, titers and projections are not touched
+#pragma omp parallel for default(none) shared(to_import) num_threads(threads <= 0 ? omp_get_max_threads() : threads) schedule(dynamic)
+    for (size_t no = 0; no < to_import.size(); ++no) {
+        auto& entry = to_import[no];
+        try {
+            auto chart = import_from_file(entry.chart.filename);
+            entry.chart.table_date = std::string(chart->info()->date());
+            entry.chart.number_of_projections = chart->number_of_projections();
+            auto antigens = chart->antigens();
+            for (auto antigen : *antigens) {
+                entry.antigen_names.emplace_back(antigen->name());
+                entry.antigens.push_back(antigen->name_full());
+            }
+            auto sera = chart->sera();
+            for (auto serum : *sera)
+                entry.sera.push_back(serum->name_full());
+        }
+        catch (std::exception& err) {
+            entry.error = err.what();
+        }
+    }
+
+    // interning is sequential, in the order of filenames
+    size_t imported{0};
+    for (auto& entry : to_import) {
+        if (!entry.error.empty()) {
+            AD_WARNING("{}: {}", entry.chart.filename, entry.error.substr(0, 200));
+            // the previous entry is kept, its mtime and size differ from the file, i.e. it is re-imported on the next update
+            if (entry.indexed_no.has_value())
+                charts[entry.chart_no] = std::move(charts_[*entry.indexed_no]);
+            continue;
+        }
+        for (const auto& name : entry.antigen_names)
+            entry.chart.antigen_names.push_back(intern(name));
+        for (const auto& name : entry.antigens)
+            entry.chart.antigens.push_back(intern(name));
+        for (const auto& name : entry.sera)
+            entry.chart.sera.push_back(intern(name));
+        charts[entry.chart_no] = std::move(entry.chart);
+        ++imported;
+    }
+    // new charts that failed to import are dropped, they are tried again when they are passed to update()
+    charts.erase(std::remove_if(charts.begin(), charts.end(), [](const auto& chart) { return chart.filename.empty(); }), charts.end());
+
+    const auto removed = charts_.size() + imported > charts.size();
+    charts_ = std::move(charts);
+    if (removed)
+        compact();
+    make_postings();
+    AD_INFO("chart archive index: {} charts, {} imported, {} names", charts_.size(), imported, names_.size());
+    return imported;
+
+} // acmacs::chart::ChartArchiveIndex::update
+
+// ----------------------------------------------------------------------
+
+acmacs::chart::ChartArchiveIndex::name_id_t acmacs::chart::ChartArchiveIndex::intern(std::string_view name)
+{
+    if (const auto found = interned_.find(name); found != interned_.end())
+        return found->second;
+    const auto inserted = interned_.emplace(std::string{name}, names_.size()).first;
+    names_.push_back(inserted);
+    return inserted->second;
+
+} // acmacs::chart::ChartArchiveIndex::intern
+
+// ----------------------------------------------------------------------
+
+void acmacs::chart::ChartArchiveIndex::compact()
+{
+    std::vector<name_id_t> old_to_new(names_.size(), names_.size());
+    std::vector<interned_t::const_iterator> names;
+    const auto renumber = [&old_to_new, &names, this](std::vector<name_id_t>& ids) {
+        for (auto& id : ids) {
+            if (old_to_new[id] == names_.size()) {
+                old_to_new[id] = names.size();
+                names.push_back(names_[id]);
+            }
+            id = old_to_new[id];
+        }
+    };
+    for (auto& chart : charts_) {
+        renumber(chart.antigen_names);
+        renumber(chart.antigens);
+        renumber(chart.sera);
+    }
+
+    for (auto it = interned_.begin(); it != interned_.end();) {
+        if (old_to_new[it->second] == names_.size()) {
+            it = interned_.erase(it);
+        }
+        else {
+            it->second = old_to_new[it->second];
+            ++it;
+        }
+    }
+    names_ = std::move(names);
+
+} // acmacs::chart::ChartArchiveIndex::compact
+
+// ----------------------------------------------------------------------
+
+void acmacs::chart::ChartArchiveIndex::make_postings()
+{
+    for (auto* postings : {&antigen_names_postings_, &antigens_postings_, &sera_postings_})
+        postings->clear();
+    chart_by_filename_.clear();
+    for (auto [chart_no, chart] : acmacs::enumerate(charts_)) {
+        chart_by_filename_.emplace(chart.filename, chart_no);
+        ::make_postings(antigen_names_postings_, names_.size(), chart_no, chart.antigen_names);
+        ::make_postings(antigens_postings_, names_.size(), chart_no, chart.antigens);
+        ::make_postings(sera_postings_, names_.size(), chart_no, chart.sera);
+    }
+
+} // acmacs::chart::ChartArchiveIndex::make_postings
+
+// ----------------------------------------------------------------------
+
+const acmacs::chart::ChartArchiveIndex::postings_t& acmacs::chart::ChartArchiveIndex::find(const std::vector<postings_t>& postings, std::string_view name) const
+{
+    static const postings_t empty;
+    if (const auto found = interned_.find(name); found != interned_.end() && found->second < postings.size())
+        return postings[found->second];
+    return empty;
+
+} // acmacs::chart::ChartArchiveIndex::find
+
+std::optional<size_t> acmacs::chart::ChartArchiveIndex::find_chart(std::string_view filename) const
+{
+    if (const auto found = chart_by_filename_.find(filename); found != chart_by_filename_.end())
+        return found->second;
+    return std::nullopt;
+
+} // acmacs::chart::ChartArchiveIndex::find_chart
+
+// ----------------------------------------------------------------------
+
+void acmacs::chart::ChartArchiveIndex::write(std::string_view filename) const
+{
+    const auto export_chart = [](const chart_t& chart) -> to_json::object {
+        return to_json::object{
+            to_json::key_val{"f", chart.filename},
+            to_json::key_val{"m", chart.mtime},
+            to_json::key_val{"s", static_cast<size_t>(chart.size)},
+            to_json::key_val{"D", chart.table_date},
+            to_json::key_val{"p", chart.number_of_projections},
+            to_json::key_val{"n", to_json::array(chart.antigen_names.begin(), chart.antigen_names.end())},
+            to_json::key_val{"a", to_json::array(chart.antigens.begin(), chart.antigens.end())},
+            to_json::key_val{"S", to_json::array(chart.sera.begin(), chart.sera.end())},
+        };
+    };
+
+    const auto data = fmt::format("{}\n", to_json::object{
+            to_json::key_val{"  version", "chart-archive-index-v1"},
+            to_json::key_val{"names", to_json::array(names_.begin(), names_.end(), [](const auto& entry) { return entry->first; })},
+            to_json::key_val{"charts", to_json::array(charts_.begin(), charts_.end(), export_chart)},
+        });
+    const auto temp_filename = fmt::format("{}.tmp", filename);
+    acmacs::file::write(temp_filename, data);
+    std::filesystem::rename(temp_filename, filename);
+
+} // acmacs::chart::ChartArchiveIndex::write
+
+// ----------------------------------------------------------------------
+
+void acmacs::chart::ChartArchiveIndex::read(std::string_view filename)
+{
+    try {
+        const auto data = rjson::parse_string(static_cast<std::string>(acmacs::file::read(filename)));
+        if (data["  version"].to<std::string_view>() != "chart-archive-index-v1")
+            throw std::runtime_error{"unsupported version"};
+        charts_.clear();
+        interned_.clear();
+        names_.clear();
+        rjson::for_each(data["names"], [this](const rjson::value& name) { intern(name.to<std::string_view>()); });
+        const auto to_ids = [this](const rjson::value& source) {
+            std::vector<name_id_t> ids;
+            rjson::transform(source, std::back_inserter(ids), [this](const rjson::value& val) -> name_id_t {
+                if (const auto id = val.to<size_t>(); id < names_.size())
+                    return id;
+                throw std::runtime_error{"invalid name id"};
+            });
+            return ids;
+        };
+        rjson::for_each(data["charts"], [this, &to_ids](const rjson::value& entry) {
+            charts_.push_back(chart_t{.filename = entry["f"].to<std::string>(),
+                                      .mtime = entry["m"].to<long>(),
+                                      .size = entry["s"].to<size_t>(),
+                                      .table_date = entry["D"].to<std::string>(),
+                                      .number_of_projections = entry["p"].to<size_t>(),
+                                      .antigen_names = to_ids(entry["n"]),
+                                      .antigens = to_ids(entry["a"]),
+                                      .sera = to_ids(entry["S"])});
+        });
+    }
+    catch (std::exception& err) {
+        throw std::runtime_error{fmt::format("cannot read chart archive index from {}: {}", filename, err.what())};
+    }
+    make_postings();
+
+} // acmacs::chart::ChartArchiveIndex::read
+
+// ----------------------------------------------------------------------
+
+acmacs::chart::ChartArchiveIndex acmacs::chart::chart_archive_index(std::string_view index_filename, const std::vector<std::string_view>& chart_filenames, int threads)
+{
+    ChartArchiveIndex index;
+    if (std::filesystem::exists(index_filename))
+        index.read(index_filename);
+    const auto number_of_charts = index.charts().size();
+    if (index.update(chart_filenames, threads) > 0 || index.charts().size() != number_of_charts)
+        index.write(index_filename);
+    return index;
+
+} // acmacs::chart::chart_archive_index
+
+// ----------------------------------------------------------------------
+/// Local Variables:
+/// eval: (if (fboundp 'eu-rename-buffer) (eu-rename-buffer))
+/// End:
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <optional>
+#include <cstdint>
+
+// ----------------------------------------------------------------------
+
+namespace acmacs::chart
+{
+    // Inverted index of antigens and sera over a set of chart files (e.g. whole chart archive),
+    // answers "which charts contain antigen X / serum Y" without importing charts.
+    // Names are interned in one table, each chart refers to names by id. Index is stored in a side file,
+    // update() re-imports just new charts and charts whose modification time or size has changed.
+    class ChartArchiveIndex
+    {
+      public:
+        using name_id_t = size_t;
+
+        struct chart_t
+        {
+            std::string filename;
+            long mtime{0};                       // std::filesystem::last_write_time, ticks since file clock epoch
+            std::uintmax_t size{0};              // file size
+            std::string table_date;
+            size_t number_of_projections{0};
+            std::vector<name_id_t> antigen_names; // per antigen, in chart order
+            std::vector<name_id_t> antigens;      // full names, per antigen
+            std::vector<name_id_t> sera;          // full names, per serum
+        };
+
+        struct entry_t
+        {
+            size_t chart_no;
+            size_t count; // number of antigens/sera in the chart having the name
+        };
+        using postings_t = std::vector<entry_t>; // sorted by chart_no
+
+        ChartArchiveIndex() = default;
+        ChartArchiveIndex(std::string_view filename) { read(filename); }
+        ChartArchiveIndex(const ChartArchiveIndex&) = delete; // names_ and chart_by_filename_ refer to interned_ and charts_
+        ChartArchiveIndex(ChartArchiveIndex&&) = default;
+        ChartArchiveIndex& operator=(const ChartArchiveIndex&) = delete;
+        ChartArchiveIndex& operator=(ChartArchiveIndex&&) = default;
+
+        // adds charts from filenames to the index, charts whose files were changed are re-imported, whose files were removed are dropped,
+        // (re)imports are done in parallel. Returns number of charts (re)imported. Charts that cannot be imported are reported,
+        // new ones are skipped, indexed ones keep their previous entry and are tried again on the next update
+        size_t update(const std::vector<std::string_view>& filenames, int threads = 0);
+
+        void write(std::string_view filename) const; // written to a temporary file first and then renamed
+        void read(std::string_view filename);        // throws std::runtime_error if file cannot be read or parsed
+
+        const std::vector<chart_t>& charts() const { return charts_; }
+        const chart_t& chart(size_t chart_no) const { return charts_[chart_no]; }
+        std::string_view name(name_id_t id) const { return names_[id]->first; }
+        std::optional<size_t> find_chart(std::string_view filename) const;
+
+        const postings_t& charts_with_antigen_name(std::string_view name) const { return find(antigen_names_postings_, name); }
+        const postings_t& charts_with_antigen(std::string_view name_full) const { return find(antigens_postings_, name_full); }
+        const postings_t& charts_with_serum(std::string_view name_full) const { return find(sera_postings_, name_full); }
+
+      private:
+        using interned_t = std::map<std::string, name_id_t, std::less<>>;
+
+        std::vector<chart_t> charts_;
+        interned_t interned_;
+        std::vector<interned_t::const_iterator> names_; // id -> interned_ entry
+        std::vector<postings_t> antigen_names_postings_, antigens_postings_, sera_postings_; // name id -> charts
+        std::map<std::string_view, size_t, std::less<>> chart_by_filename_;
+
+        name_id_t intern(std::string_view name);
+        const postings_t& find(const std::vector<postings_t>& postings, std::string_view name) const;
+        void compact();        // drops names no longer referred by charts
+        void make_postings();
+
+    }; // class ChartArchiveIndex
+
+    // reads index_filename if it exists, updates index with chart_filenames and writes it back if index was changed
+    ChartArchiveIndex chart_archive_index(std::string_view index_filename, const std::vector<std::string_view>& chart_filenames, int threads = 0);
+
+} // namespace acmacs::chart
+
+// ----------------------------------------------------------------------
+/// Local Variables:
+/// eval: (if (fboundp 'eu-rename-buffer) (eu-rename-buffer))
+/// End:
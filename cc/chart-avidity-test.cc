@@ -22,7 +22,9 @@ struct Options : public argv
     option<double> max_adjust{*this, "max-adjust", dflt{6.0}};
     option<size_t> projection{*this, "projection", dflt{0ul}};
     option<bool>   rough{*this, "rough"};
-    option<str>    method{*this, "method", dflt{"alglib-cg"}, desc{"method: alglib-lbfgs, alglib-cg, optim-bfgs, optim-differential-evolution"}};
+    option<size_t> threads{*this, "threads", dflt{0ul}, desc{"number of threads to use (omp): 0 - autodetect, 1 - sequential"}};
+    option<bool>   warm_start{*this, "warm-start", desc{"start optimization for each adjust from the layout of the previous adjust instead of the original layout (faster, results differ)"}};
+    option<str>    method{*this, "method", dflt{"alglib-cg"}, desc{"method: alglib-lbfgs, alglib-cg, native-lbfgs, native-cg"}};
 
     option<str_array> verbose{*this, 'v', "verbose", desc{"comma separated list (or multiple switches) of enablers"}};
 
@@ -50,7 +52,7 @@ int main(int argc, char* const argv[])
 
         using namespace acmacs::chart;
         using namespace acmacs::chart::avidity;
-        const auto results = test(chart, opt.projection, Settings{.step = opt.adjust_step, .min_adjust = opt.min_adjust, .max_adjust = opt.max_adjust},
+        const auto results = test(chart, opt.projection, Settings{.step = opt.adjust_step, .min_adjust = opt.min_adjust, .max_adjust = opt.max_adjust, .threads = opt.threads, .warm_start = opt.warm_start},
              optimization_options{optimization_method_from_string(opt.method), opt.rough ? optimization_precision::rough : optimization_precision::fine});
         AD_PRINT("{}", results);
     }
@@ -3,6 +3,7 @@
 #include "acmacs-chart-2/factory-import.hh"
 #include "acmacs-chart-2/factory-export.hh"
 #include "acmacs-chart-2/chart-modify.hh"
+#include "acmacs-chart-2/procrustes.hh"
 
 // Makes sure table is the same, combines projections, sorts them, keep few best projections
 
@@ -17,6 +18,8 @@ struct Options : public argv
     option<size_t> keep_projections{*this, 'k', "keep-projections", dflt{10ul}, desc{"number of projections to keep, 0 - keep all"}};
     option<str>    output_chart{*this, 'o', "output", desc{"output-chart"}};
     option<bool>   info{*this, 'i', "info"};
+    option<bool>   reorient{*this, "reorient", desc{"re-orient kept projections to the best one"}};
+    option<int>    threads{*this, "threads", dflt{0}, desc{"number of threads to use for re-orienting (omp): 0 - autodetect, 1 - sequential"}};
 
     argument<str_array>  source_charts{*this, arg_name{"source-chart"}, mandatory};
 };
@@ -41,6 +44,15 @@ int main(int argc, char* const argv[])
         if (opt.info)
             fmt::print("{}\n", master.make_info());
         master.projections_modify().keep_just(*opt.keep_projections);
+        if (opt.reorient && master.number_of_projections() > 1) {
+            acmacs::chart::CommonAntigensSera common(master);
+            std::vector<std::shared_ptr<acmacs::chart::Projection>> projections;
+            for (size_t projection_no = 1; projection_no < master.number_of_projections(); ++projection_no)
+                projections.push_back(master.projection(projection_no));
+            const auto procrustes_data = acmacs::chart::procrustes(*master.projection(0), projections, common.points(), acmacs::chart::procrustes_scaling_t::no, opt.threads);
+            for (size_t projection_no = 1; projection_no < master.number_of_projections(); ++projection_no)
+                master.projection_modify(projection_no)->transformation(procrustes_data[projection_no - 1].transformation);
+        }
         if (opt.output_chart.has_value())
             acmacs::chart::export_factory(master, opt.output_chart, opt.program_name());
         fmt::print("{}\n", master.make_name());
@@ -4,23 +4,14 @@
 #include "acmacs-base/timeit.hh"
 #include "acmacs-base/filesystem.hh"
 #include "acmacs-chart-2/chart-modify.hh"
-#include "acmacs-chart-2/randomizer.hh"
 #include "acmacs-chart-2/factory-import.hh"
 #include "acmacs-chart-2/factory-export.hh"
 #include "acmacs-chart-2/serum-line.hh"
+#include "acmacs-chart-2/degradation-resolver.hh"
 
 // ----------------------------------------------------------------------
 
-struct Options
-{
-    Options(size_t a_number_of_attempts, double a_serum_line_sd_threshold, double a_rms_threshold)
-        : number_of_attempts{a_number_of_attempts}, serum_line_sd_threshold{a_serum_line_sd_threshold}, rms_threshold{a_rms_threshold} {}
-
-    size_t number_of_attempts;
-    double serum_line_sd_threshold;
-    double rms_threshold;
-    size_t max_levels_in_randomization_descent = 20;
-};
+using Options = acmacs::chart::DegradationResolverParameters;
 
 struct SplitData
 {
@@ -44,9 +35,6 @@ struct SplitData
 };
 
 static acmacs::chart::ProjectionModifyP flip_relax(acmacs::chart::ChartModify& chart, acmacs::chart::ProjectionModifyP original_projection, const Options& options);
-static acmacs::chart::ProjectionModifyP randomize_found_on_the_wrong_side_of_serum_line_recursive(acmacs::chart::ChartModify& chart, acmacs::chart::ProjectionModifyP original_projection, size_t level, std::string level_path, const Options& options);
-// static acmacs::chart::ProjectionModifyP randomize_found_on_the_wrong_side_of_serum_line(acmacs::chart::ChartModify& chart, acmacs::chart::ProjectionModifyP original_projection, const Options& options);
-static acmacs::chart::ProjectionModifyP randomize_found_on_the_wrong_side_of_serum_line_parallel(acmacs::chart::ChartModify& chart, acmacs::chart::ProjectionModifyP original_projection, const Options& options);
 
 // ----------------------------------------------------------------------
 
@@ -62,6 +50,8 @@ int main(int argc, char* const argv[])
                            {"--no-disconnect-having-few-titers", false, "do not disconnect points having too few numeric titers"},
                            {"--serum-line-sd-threshold", 0.4, "do not run resolver if serum line sd higher than this threshold"},
                            {"--rms-threshold", 0.1, "run resolver until rms between current and previous map bigger than this"},
+                           {"--max-expansions", 50, "recursive search: max number of layouts to randomize further"},
+                           {"--threads", 0, "number of threads to use (omp): 0 - autodetect, 1 - sequential"},
                            {"--time", false, "report time of loading chart"},
                            {"--verbose", false},
                            {"-h", false},
@@ -75,9 +65,13 @@ int main(int argc, char* const argv[])
         else {
             const size_t projection_no = 0;
             const std::string type(args["--type"]);
-            const Options options(args["-n"], args["--serum-line-sd-threshold"], args["--rms-threshold"]);
-            // const size_t number_of_attempts = args["-n"];
-            // const double rms_threshold = args["--rms-threshold"];
+            const Options options{.number_of_attempts = args["-n"],
+                                  .serum_line_sd_threshold = args["--serum-line-sd-threshold"],
+                                  .rms_threshold = args["--rms-threshold"],
+                                  .max_levels = 20,
+                                  .max_expansions = type == "recursive" ? static_cast<size_t>(args["--max-expansions"]) : 1};
+            acmacs::chart::optimization_options optimization_options;
+            optimization_options.num_threads = args["--threads"];
             const auto report = do_report_time(args["--time"]);
             fs::path output_filename(args[1]);
             auto intermediate_filename = [&output_filename](size_t step) -> std::string {
@@ -90,14 +84,13 @@ int main(int argc, char* const argv[])
 
             auto found1 = flip_relax(chart, original_projection, options);
               // std::cerr << found1->make_info() << '\n' << '\n';
-            if (type == "recursive") {
-                auto found2 = randomize_found_on_the_wrong_side_of_serum_line_recursive(chart, original_projection, 0, "", options);
-                chart.projections_modify().add(found2);
-            }
-            else if (type == "random") {
-                  // auto found2 = randomize_found_on_the_wrong_side_of_serum_line(chart, original_projection, options);
-                auto found2 = randomize_found_on_the_wrong_side_of_serum_line_parallel(chart, original_projection, options);
-                chart.projections_modify().add(found2);
+            if (type == "recursive" || type == "random") {
+                const auto resolved = acmacs::chart::resolve_degradation(*original_projection, options, optimization_options);
+                auto found2 = chart.projections_modify().new_by_cloning(*original_projection);
+                found2->set_layout(resolved.layout);
+                found2->comment(fmt::format("resolver {} {}, wrong_side:{}", type, resolved.path, resolved.on_the_wrong_side));
+                found2->orient_to(*original_projection);
+                std::cerr << "resolver: " << resolved.number_of_relaxations << " relaxations, wrong_side: " << resolved.on_the_wrong_side << "  stress: " << resolved.stress << '\n';
             }
             else {
                 std::cerr << "Unrecognized type of search: " << type << '\n';
@@ -118,98 +111,6 @@ int main(int argc, char* const argv[])
 
 // ----------------------------------------------------------------------
 
-// acmacs::chart::ProjectionModifyP randomize_found_on_the_wrong_side_of_serum_line(acmacs::chart::ChartModify& chart, acmacs::chart::ProjectionModifyP original_projection, const Options& options)
-// {
-//     acmacs::chart::ProjectionModifyP result;
-//     size_t wrong_side = 100000;
-//     const SplitData split_data(*original_projection);
-//     acmacs::chart::ProjectionModifyP projection_for_randomizer = chart.projections_modify().new_by_cloning(*original_projection, false);
-//     auto randomizer = acmacs::chart::randomizer_border_with_current_layout_area(*projection_for_randomizer, 1.0, {split_data.serum_line.line(), split_data.good_side});
-//     for (size_t attempt = 0; attempt < options.number_of_attempts; ++attempt) {
-//         acmacs::chart::ProjectionModifyP new_projection = chart.projections_modify().new_by_cloning(*original_projection, false);
-//         new_projection->randomize_layout(split_data.on_the_wrong_side, randomizer);
-//         new_projection->relax(acmacs::chart::optimization_options(acmacs::chart::optimization_precision::rough));
-//         const SplitData new_split_data(*new_projection);
-//         const auto on_the_wrong_side = new_split_data.on_the_wrong_side->size();
-//         if (!result || on_the_wrong_side < wrong_side || (on_the_wrong_side == wrong_side && new_projection->stress() < result->stress())) {
-//             result = new_projection;
-//             result->comment("resolver random, wrong_side:" + std::to_string(on_the_wrong_side));
-//             wrong_side = on_the_wrong_side;
-//             std::cerr << "wrong_side: " << std::setw(3) << on_the_wrong_side << "  stress: " << std::setw(8) << result->stress() << " line-sera-sd: " << new_split_data.serum_line.standard_deviation() << '\n';
-//         }
-//     }
-//     result->orient_to(*original_projection);
-//     return result;
-
-// } // randomize_found_on_the_wrong_side_of_serum_line
-
-// ----------------------------------------------------------------------
-
-acmacs::chart::ProjectionModifyP randomize_found_on_the_wrong_side_of_serum_line_parallel(acmacs::chart::ChartModify& chart, acmacs::chart::ProjectionModifyP original_projection,
-                                                                                          const Options& options)
-{
-    using Entry = std::tuple<acmacs::chart::ProjectionModifyP, size_t>; // projection, on_the_wrong_side
-    auto entry_compare = [](const auto& e1, const auto& e2) -> bool {
-        if (std::get<size_t>(e1) == std::get<size_t>(e2))
-            return std::get<acmacs::chart::ProjectionModifyP>(e1)->stress() < std::get<acmacs::chart::ProjectionModifyP>(e2)->stress();
-        else
-            return std::get<size_t>(e1) < std::get<size_t>(e2);
-    };
-
-    std::vector<Entry> results(options.number_of_attempts);
-    const SplitData split_data(*original_projection);
-
-#pragma omp parallel for default(shared) schedule(static, 4)
-    for (size_t attempt = 0; attempt < options.number_of_attempts; ++attempt) {
-        acmacs::chart::ProjectionModifyP new_projection = chart.projections_modify().new_by_cloning(*original_projection, false);
-        auto randomizer = acmacs::chart::randomizer_border_with_current_layout_area(*new_projection, 1.0, {split_data.serum_line.line(), split_data.good_side});
-        new_projection->randomize_layout(split_data.on_the_wrong_side, randomizer);
-        new_projection->relax(acmacs::chart::optimization_options(acmacs::chart::optimization_precision::rough));
-        const SplitData new_split_data(*new_projection);
-        new_projection->comment("resolver random, wrong_side:" + std::to_string(new_split_data.on_the_wrong_side->size()));
-        results[attempt] = {new_projection, new_split_data.on_the_wrong_side->size()};
-    }
-
-    auto result = std::get<acmacs::chart::ProjectionModifyP>(*std::min_element(results.begin(), results.end(), entry_compare));
-    result->relax({acmacs::chart::optimization_precision::fine});
-    result->orient_to(*original_projection);
-    return result;
-
-} // randomize_found_on_the_wrong_side_of_serum_line_parallel
-
-// ----------------------------------------------------------------------
-
-acmacs::chart::ProjectionModifyP randomize_found_on_the_wrong_side_of_serum_line_recursive(acmacs::chart::ChartModify& chart, acmacs::chart::ProjectionModifyP original_projection, size_t level, std::string level_path, const Options& options)
-{
-    std::vector<acmacs::chart::ProjectionModifyP> results(options.number_of_attempts);
-    for (size_t attempt = 0; attempt < options.number_of_attempts; ++attempt) {
-        const std::string sublevel_path = level_path + (level_path.empty() ? "" : "-") + acmacs::to_string(attempt + 1);
-          // std::cerr << sublevel_path << '\n';
-
-        SplitData split_data(*original_projection);
-        acmacs::chart::ProjectionModifyP new_projection = chart.projections_modify().new_by_cloning(*original_projection, false);
-        auto randomizer = acmacs::chart::randomizer_border_with_current_layout_area(*new_projection, 1.0, {split_data.serum_line.line(), split_data.good_side});
-        new_projection->randomize_layout(split_data.on_the_wrong_side, randomizer);
-        new_projection->comment("resolver " + sublevel_path + " wrong-side:" + std::to_string(split_data.on_the_wrong_side->size()));
-        new_projection->relax(acmacs::chart::optimization_options(acmacs::chart::optimization_precision::rough));
-        const auto procrustes_data = new_projection->orient_to(*original_projection);
-        std::cerr << level << ' ' << sublevel_path << " wrong-side: " << split_data.on_the_wrong_side->size() << "  rms: " << procrustes_data.rms << '\n';
-
-        if (procrustes_data.rms > options.rms_threshold && level < options.max_levels_in_randomization_descent) {
-            std::cerr << new_projection->make_info() << '\n';
-            new_projection = randomize_found_on_the_wrong_side_of_serum_line_recursive(chart, new_projection, level + 1, sublevel_path, options);
-        }
-
-        std::cerr << "    " << new_projection->make_info() << '\n';
-        results[attempt] = new_projection;
-    }
-    return *std::min_element(results.begin(), results.end(), [](const auto& p1, const auto& p2) { return p1->stress() < p2->stress(); });
-
-} // randomize_found_on_the_wrong_side_of_serum_line_recursive
-
-// ----------------------------------------------------------------------
-
-
 acmacs::chart::ProjectionModifyP flip_relax(acmacs::chart::ChartModify& chart, acmacs::chart::ProjectionModifyP original_projection, const Options& options)
 {
     SplitData split_data(*original_projection);
@@ -3,9 +3,11 @@
 #include "acmacs-base/range-v3.hh"
 #include "acmacs-base/string-compare.hh"
 #include "acmacs-base/read-file.hh"
+#include "acmacs-base/file-stream.hh"
 // #include "acmacs-base/csv.hh"
 #include "acmacs-chart-2/factory-import.hh"
 #include "acmacs-chart-2/chart.hh"
+#include "acmacs-chart-2/parallel-chunks.hh"
 
 // ----------------------------------------------------------------------
 
@@ -15,6 +17,7 @@ struct Options : public argv
     Options(int a_argc, const char* const a_argv[], on_error on_err = on_error::exit) : argv() { parse(a_argc, a_argv, on_err); }
 
     option<size_t> projection_no{*this, "projection", dflt{0UL}};
+    option<int>    threads{*this, "threads", dflt{0}, desc{"number of threads to use (omp): 0 - autodetect, 1 - sequential"}};
 
     argument<str> input_chart{*this, arg_name{"chart-file"}, mandatory};
     argument<str> output_distances{*this, arg_name{"output-distances.{txt,csv,json}[.xz]"}, mandatory};
@@ -22,7 +25,7 @@ struct Options : public argv
 
 static void write_csv(std::string_view aFilename, size_t projection_no, const acmacs::chart::Chart& chart);
 static void write_json(std::string_view aFilename, size_t projection_no, const acmacs::chart::Chart& chart);
-static void write_text(std::string_view aFilename, size_t projection_no, const acmacs::chart::Chart& chart);
+static void write_text(std::string_view aFilename, size_t projection_no, const acmacs::chart::Chart& chart, int threads);
 
 // static std::string encode_name(std::string_view aName, std::string_view aFieldSeparator);
 // static std::string field(const acmacs::chart::Chart& chart, std::string_view field_name, size_t point_no);
@@ -41,7 +44,7 @@ int main(int argc, char* const argv[])
         else if (acmacs::string::endswith(*opt.output_distances, ".json"sv) || acmacs::string::endswith(*opt.output_distances, ".json.xz"sv))
             write_json(opt.output_distances, opt.projection_no, *chart);
         else
-            write_text(opt.output_distances, opt.projection_no, *chart);
+            write_text(opt.output_distances, opt.projection_no, *chart, opt.threads);
     }
     catch (std::exception& err) {
         AD_ERROR("{}", err);
@@ -67,29 +70,44 @@ void write_json(std::string_view /*aFilename*/, size_t /*projection_no*/, const
 // ----------------------------------------------------------------------
 
 // c2: acmacs/core/chart.py:1103 distances_between_all_points
-void write_text(std::string_view aFilename, size_t projection_no, const acmacs::chart::Chart& chart)
+void write_text(std::string_view aFilename, size_t projection_no, const acmacs::chart::Chart& chart, int threads)
 {
+    using namespace std::string_view_literals;
+
     auto antigens = chart.antigens();
     auto sera = chart.sera();
     auto projection = (*chart.projections())[projection_no];
     auto layout = projection->layout();
-    const auto number_of_antigens = antigens->size();
-    const auto name = [number_of_antigens, &antigens, &sera](size_t p_no) {
-        if (p_no < number_of_antigens)
-            return fmt::format("{}-AG", antigens->at(p_no)->format("{name_full}"));
-        else
-            return fmt::format("{}-SR", sera->at(p_no - number_of_antigens)->format("{name_full}"));
-    };
-
+    std::vector<std::string> names;
+    for (const auto& antigen : *antigens)
+        names.push_back(fmt::format("{}-AG", antigen->format("{name_full}")));
+    for (const auto& serum : *sera)
+        names.push_back(fmt::format("{}-SR", serum->format("{name_full}")));
+
+    // rows (first points) are formatted in parallel in chunks, chunks are written to the output as soon as they are ready,
+    // compressed output still needs the whole text in memory
+    const bool compressed = acmacs::string::endswith(aFilename, ".xz"sv);
+    std::string whole;
+    std::optional<acmacs::file::ofstream> output;
+    if (!compressed)
+        output.emplace(aFilename);
     const auto number_of_points = layout->number_of_points();
-    fmt::memory_buffer out;
-    for (const auto p1 : range_from_0_to(number_of_points - 1)) {
-        for (const auto p2 : range_from_to(p1 + 1, number_of_points)) {
-            const auto distance = layout->distance(p1, p2);
-            fmt::format_to(out, "{}\t{}\t{}\n", name(p1), name(p2), distance);
-        }
-    }
-    acmacs::file::write(aFilename, fmt::to_string(out));
+    acmacs::chart::process_in_chunks<fmt::memory_buffer>(
+        number_of_points, std::max(100000 / std::max(number_of_points, 1UL), 1UL), threads,
+        [&layout, &names, number_of_points](size_t first, size_t last, fmt::memory_buffer& out) {
+            for (size_t p1 = first; p1 < last; ++p1) {
+                for (size_t p2 = p1 + 1; p2 < number_of_points; ++p2)
+                    fmt::format_to(out, "{}\t{}\t{}\n", names[p1], names[p2], layout->distance(p1, p2));
+            }
+        },
+        [&output, &whole](const fmt::memory_buffer& out) {
+            if (output.has_value())
+                static_cast<std::ostream&>(*output).write(out.data(), static_cast<std::streamsize>(out.size()));
+            else
+                whole.append(out.data(), out.size());
+        });
+    if (compressed)
+        acmacs::file::write(aFilename, whole);
 }
 
 // ----------------------------------------------------------------------
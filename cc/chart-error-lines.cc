@@ -5,6 +5,7 @@
 #include "acmacs-chart-2/factory-import.hh"
 #include "acmacs-chart-2/factory-export.hh"
 #include "acmacs-chart-2/chart.hh"
+#include "acmacs-chart-2/optimize.hh"
 
 // ----------------------------------------------------------------------
 
@@ -15,6 +16,7 @@ struct Options : public argv
 
     option<size_t> projection{*this, "projection", desc{"report names with fields"}};
     option<bool> report_time{*this, "time", desc{"report time of loading chart"}};
+    option<int>  threads{*this, "threads", dflt{0}, desc{"number of threads to use (omp): 0 - autodetect, 1 - sequential"}};
     argument<str> chart{*this, arg_name{"chart"}, mandatory};
 };
 
@@ -25,9 +27,17 @@ int main(int argc, char* const argv[])
         Options opt(argc, argv);
         auto chart = acmacs::chart::import_from_file(opt.chart, acmacs::chart::Verify::None, do_report_time(opt.report_time));
         auto projection = chart->projection(opt.projection);
-        const auto error_lines = projection->error_lines();
-        for (const auto& line : error_lines)
-            fmt::print("{} {} {}\n", line.point_1, line.point_2, line.error_line);
+        // error lines are printed in chunks as soon as they are computed, memory use does not depend on the chart size
+        fmt::memory_buffer out;
+        acmacs::chart::error_lines(
+            *projection,
+            [&out](const acmacs::chart::ErrorLines& chunk) {
+                out.clear();
+                for (const auto& line : chunk)
+                    fmt::format_to(out, "{} {} {}\n", line.point_1, line.point_2, line.error_line);
+                std::fwrite(out.data(), 1, out.size(), stdout);
+            },
+            100000, opt.threads);
     }
     catch (std::exception& err) {
         AD_ERROR("{}", err);
@@ -4,10 +4,12 @@
 #include "acmacs-base/string-split.hh"
 #include "acmacs-chart-2/factory-import.hh"
 #include "acmacs-chart-2/chart.hh"
+#include "acmacs-chart-2/chart-archive-index.hh"
 
 // ----------------------------------------------------------------------
 
 static void process(const std::vector<std::string_view>& names, const std::vector<std::string_view>& chart_file_names);
+static void process(const std::vector<std::string_view>& names, const std::vector<std::string_view>& chart_file_names, const acmacs::chart::ChartArchiveIndex& index);
 
 using namespace acmacs::argv;
 struct Options : public argv
@@ -15,6 +17,8 @@ struct Options : public argv
     Options(int a_argc, const char* const a_argv[], on_error on_err = on_error::exit) : argv() { parse(a_argc, a_argv, on_err); }
 
     option<str> charts_from{*this, "charts-from", desc{"file with chart file names"}};
+    option<str> index{*this, "index", desc{"chart archive index file, created if absent, updated with the charts whose files were changed, without charts all indexed charts are searched"}};
+    option<int> threads{*this, "threads", dflt{0}, desc{"number of threads to use for updating index (omp): 0 - autodetect, 1 - sequential"}};
 
     argument<str> names{*this, arg_name{"names"}, mandatory, desc{"file with names"}};
     argument<str> chart{*this, arg_name{"chart"}};
@@ -25,7 +29,16 @@ int main(int argc, char* const argv[])
     int exit_code = 0;
     try {
         Options opt(argc, argv);
-        if (opt.charts_from)
+        if (opt.index) {
+            const std::string names{static_cast<std::string>(acmacs::file::read(opt.names))}, charts_from{opt.charts_from ? static_cast<std::string>(acmacs::file::read(opt.charts_from)) : std::string{}};
+            std::vector<std::string_view> chart_file_names;
+            if (opt.charts_from)
+                chart_file_names = acmacs::string::split(charts_from, "\n");
+            else if (opt.chart)
+                chart_file_names.push_back(*opt.chart);
+            process(acmacs::string::split(names, "\n"), chart_file_names, acmacs::chart::chart_archive_index(opt.index, chart_file_names, opt.threads));
+        }
+        else if (opt.charts_from)
             process(acmacs::string::split(static_cast<std::string>(acmacs::file::read(opt.names)), "\n"), acmacs::string::split(static_cast<std::string>(acmacs::file::read(opt.charts_from)), "\n"));
         else
             process(acmacs::string::split(static_cast<std::string>(acmacs::file::read(opt.names)), "\n"), std::vector<std::string_view>{*opt.chart});
@@ -84,6 +97,59 @@ void process(const std::vector<std::string_view>& names, const std::vector<std::
 
 // ----------------------------------------------------------------------
 
+void process(const std::vector<std::string_view>& names, const std::vector<std::string_view>& chart_file_names, const acmacs::chart::ChartArchiveIndex& index)
+{
+    // charts to search, all indexed charts if none given
+    std::vector<bool> to_search(index.charts().size(), chart_file_names.empty());
+    for (const auto& filename : chart_file_names) {
+        if (const auto chart_no = index.find_chart(filename); chart_no.has_value())
+            to_search[*chart_no] = true;
+    }
+
+    std::map<std::string_view, size_t, std::less<>> m_names;
+    for (const auto& name : names) {
+        if (!name.empty())
+            m_names[name] = 0;
+    }
+
+    std::vector<size_t> found_in_chart(index.charts().size(), 0);
+    for (auto& [name, count] : m_names) {
+        for (const auto& entry : index.charts_with_antigen_name(name)) {
+            if (to_search[entry.chart_no] && index.chart(entry.chart_no).number_of_projections) {
+                found_in_chart[entry.chart_no] += entry.count;
+                count += entry.count;
+            }
+        }
+    }
+
+    const auto report = [&found_in_chart, &index](size_t chart_no) {
+        if (found_in_chart[chart_no])
+            fmt::print("{:3d} {}\n", found_in_chart[chart_no], index.chart(chart_no).filename);
+        found_in_chart[chart_no] = 0; // report once if the same chart is listed more than once
+    };
+    if (chart_file_names.empty()) {
+        for (size_t chart_no = 0; chart_no < found_in_chart.size(); ++chart_no)
+            report(chart_no);
+    }
+    else {
+        // in the order of the given charts
+        for (const auto& filename : chart_file_names) {
+            if (const auto chart_no = index.find_chart(filename); chart_no.has_value())
+                report(*chart_no);
+        }
+    }
+
+    if (std::count(to_search.begin(), to_search.end(), true) > 1) {
+        for (auto [name, count] : m_names) {
+            if (count == 0)
+                fmt::print(stderr, "WARNING: name not found: \"{}\"\n", name);
+        }
+    }
+
+} // process
+
+// ----------------------------------------------------------------------
+
 
 // ----------------------------------------------------------------------
 /// Local Variables:
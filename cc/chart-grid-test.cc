@@ -19,6 +19,7 @@ struct Options : public argv
     option<bool>   relax{*this, "relax", desc{"move trapped points and relax, test again, repeat while there are trapped points"}};
     option<size_t> projection{*this, "projection", dflt{0UL}, desc{"projection number to test"}};
     option<double> grid_step{*this, "step", dflt{0.1}, desc{"grid step"}};
+    option<double> coarse_step{*this, "coarse-step", dflt{0.0}, desc{"scan grid with this step first, then scan with --step around promising nodes only, 0 - no coarse scan"}};
     option<str>    points_to_test{*this, "points", dflt{"all"}, desc{"comma separated list of point numbers or names to test, \"all\" to test all"}};
     option<str>    grid_json{*this, "json", desc{"export test results into json"}};
     option<str>    csv{*this, "csv", desc{"export layout and test results into csv"}};
@@ -42,7 +43,7 @@ int main(int argc, char* const argv[])
         if (opt.points_to_test == "all") {
             auto master_projection = chart.projection(opt.projection);
             const size_t relax_attempts = 20;
-            const auto [grid_results, grid_projections] = acmacs::chart::grid_test(chart, opt.projection, opt.grid_step, opt.threads, relax_attempts, opt.grid_json);
+            const auto [grid_results, grid_projections] = acmacs::chart::grid_test(chart, opt.projection, opt.grid_step, opt.threads, relax_attempts, opt.grid_json, acmacs::verbose::yes, opt.coarse_step);
             AD_PRINT(""); // new line after grid test report
 
             if (opt.output.has_value()) {
@@ -59,7 +60,7 @@ int main(int argc, char* const argv[])
             fmt::print(stderr, "{}\n", chart.make_info());
         }
         else {
-            acmacs::chart::GridTest test(chart, opt.projection, opt.grid_step);
+            acmacs::chart::GridTest test(chart, opt.projection, opt.grid_step, opt.coarse_step);
             auto antigens = chart.antigens();
             acmacs::chart::Indexes points;
             for (const auto& point_ref : acmacs::string::split(*opt.points_to_test, ",")) {
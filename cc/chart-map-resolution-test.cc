@@ -20,6 +20,8 @@ struct Options : public argv
     option<bool>   no_column_bases_from_master{*this, "no-column-bases-from-master", desc{"converting titers to dont-care may change column bases, do not force master chart column bases"}};
     option<bool>   relax_from_full_table{*this, "relax-from-full-table", desc{"additional projection in each replicate, first full table is relaxed, then titers dont-cared and the best projection relaxed again from already found starting coordinates."}};
     option<str>    save_charts_to{*this, "save", desc{"save intermediate charts to this directory"}};
+    option<int>    threads{*this, "threads", dflt{0}, desc{"number of threads to use (omp): 0 - autodetect, 1 - sequential"}};
+    option<bool>   verbose{*this, 'v', "verbose", desc{"report summaries as they are computed"}};
 
     argument<str> source{*this, arg_name{"chart-to-test"}, mandatory};
 };
@@ -42,11 +44,13 @@ int main(int argc, char* const argv[])
         parameters.optimization_precision = *opt.fine_optimisation ? acmacs::chart::optimization_precision::fine : acmacs::chart::optimization_precision::rough;
         parameters.relax_from_full_table = *opt.relax_from_full_table ? acmacs::chart::map_resolution_test_data::relax_from_full_table::yes : acmacs::chart::map_resolution_test_data::relax_from_full_table::no;
         parameters.save_charts_to = *opt.save_charts_to;
+        parameters.threads = opt.threads;
 
         fmt::print(stderr, "{}\n", parameters);
 
         acmacs::chart::ChartModify chart{acmacs::chart::import_from_file(opt.source, acmacs::chart::Verify::None, report_time::no)};
-        const auto results = acmacs::chart::map_resolution_test(chart, parameters);
+        const auto report_summary = [](const acmacs::chart::map_resolution_test_data::PredictionsSummary& summary) { std::cerr << summary << '\n'; };
+        const auto results = acmacs::chart::map_resolution_test(chart, parameters, opt.verbose ? acmacs::chart::map_resolution_test_data::summary_callback_t{report_summary} : acmacs::chart::map_resolution_test_data::summary_callback_t{});
         std::cout << results << '\n';
     }
     catch (std::exception& err) {
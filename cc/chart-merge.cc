@@ -33,6 +33,7 @@ struct Options : public argv
     option<bool> duplicates_distinct{*this, "duplicates-distinct", desc{"make duplicates distinct"}};
     option<str>  report_titers{*this, "report", desc{"titer merge report"}};
     option<bool> report_common_only{*this, "common-only", desc{"titer merge report for common antigens and sera only"}};
+    option<int>  threads{*this, "threads", dflt{0}, desc{"number of threads to use for copying titers (omp): 0 - autodetect, 1 - sequential"}};
     option<str_array> verbose{*this, 'v', "verbose", desc{"comma separated list (or multiple switches) of enablers: all, common"}};
 
     argument<str_array> source_charts{*this, arg_name{"source-chart"}, mandatory};
@@ -63,15 +64,13 @@ int main(int argc, const char* const argv[])
 
         settings.combine_cheating_assays_ = combine_cheating_assays(charts, opt.combine_cheating_assays);
 
-        auto [result, merge_report] = acmacs::chart::merge(*charts[0], *charts[1], settings);
+        const auto sources = charts | ranges::views::transform([](const auto& chart) -> const acmacs::chart::Chart* { return chart.get(); }) | ranges::to_vector;
+        auto [result, merge_reports] = acmacs::chart::merge(sources, settings, opt.threads);
+        const auto& merge_report = merge_reports.back();
 
-        fmt::print("{}\n{}\n\n{}\n----------\n\n", charts[0]->description(), charts[1]->description(), merge_report.common.report());
-        for (const size_t c_no : range_from_to(2ul, charts.size())) {
-            auto& chart3 = *charts[c_no];
-            fmt::print("{}\n{}\n\n", result->description(), chart3.description());
-            std::tie(result, merge_report) = acmacs::chart::merge(*result, chart3, settings);
-            fmt::print("{}\n----------\n\n", merge_report.common.report());
-        }
+        fmt::print("{}\n", charts[0]->description());
+        for (const size_t c_no : range_from_to(1ul, charts.size()))
+            fmt::print("{}\n\n{}\n----------\n\n", charts[c_no]->description(), merge_reports[c_no - 1].common.report());
         if (opt.output_chart.has_value())
             acmacs::chart::export_factory(*result, opt.output_chart, opt.program_name());
         if (opt.report_titers.has_value()) {
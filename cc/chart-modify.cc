@@ -2,8 +2,10 @@
 #include <functional>
 #include <limits>
 #include <algorithm>
+#include <numeric>
 
 #include "acmacs-base/log.hh"
+#include "acmacs-base/timeit.hh"
 #include "acmacs-base/omp.hh"
 #include "acmacs-base/flat-set.hh"
 #include "acmacs-base/range-v3.hh"
@@ -14,12 +16,28 @@
 #include "locationdb/locdb.hh"
 #include "acmacs-chart-2/chart-modify.hh"
 #include "acmacs-chart-2/log.hh"
+#include "acmacs-chart-2/relax-selector.hh"
 
 using namespace std::string_literals;
 using namespace acmacs::chart;
 
 // ----------------------------------------------------------------------
 
+namespace
+{
+    // if source is a modify object, the new one shares its data (copy on write), otherwise data is copied
+    template <typename Modify, typename SourceP> inline std::shared_ptr<Modify> make_modify(SourceP source)
+    {
+        if (const auto source_modify = std::dynamic_pointer_cast<const Modify>(source); source_modify)
+            return std::make_shared<Modify>(*source_modify);
+        else
+            return std::make_shared<Modify>(source);
+    }
+
+} // namespace
+
+// ----------------------------------------------------------------------
+
 ChartModify::ChartModify(size_t number_of_antigens, size_t number_of_sera)
     : info_{std::make_shared<InfoModify>()},
       antigens_{std::make_shared<AntigensModify>(number_of_antigens)},
@@ -34,9 +52,9 @@ ChartModify::ChartModify(size_t number_of_antigens, size_t number_of_sera)
 
 ChartModify::ChartModify(const Chart& source, bool copy_projections, bool copy_plot_spec)
     : info_{std::make_shared<InfoModify>(source.info())},
-      antigens_{std::make_shared<AntigensModify>(source.antigens())},
-      sera_{std::make_shared<SeraModify>(source.sera())},
-      titers_{std::make_shared<TitersModify>(source.titers())},
+      antigens_{make_modify<AntigensModify>(source.antigens())},
+      sera_{make_modify<SeraModify>(source.sera())},
+      titers_{make_modify<TitersModify>(source.titers())},
       projections_{copy_projections ? std::make_shared<ProjectionsModify>(*this, source.projections()) : std::make_shared<ProjectionsModify>(*this)},
       plot_spec_{copy_plot_spec ? std::make_shared<PlotSpecModify>(source.plot_spec(), source.number_of_antigens()) : std::make_shared<PlotSpecModify>(source.number_of_antigens(), source.number_of_sera())}
 {
@@ -79,7 +97,7 @@ AntigensP ChartModify::antigens() const
 std::shared_ptr<AntigensModify> ChartModify::antigens_modify_ptr()
 {
     if (!antigens_)
-        antigens_ = std::make_shared<AntigensModify>(main_->antigens());
+        antigens_ = make_modify<AntigensModify>(main_->antigens());
     return antigens_;
 
 } // ChartModify::antigens_modify_ptr
@@ -107,7 +125,7 @@ SeraP ChartModify::sera() const
 std::shared_ptr<SeraModify> ChartModify::sera_modify_ptr()
 {
     if (!sera_)
-        sera_ = std::make_shared<SeraModify>(main_->sera());
+        sera_ = make_modify<SeraModify>(main_->sera());
     return sera_;
 
 } // ChartModify::sera_modify_ptr
@@ -128,7 +146,7 @@ TitersP ChartModify::titers() const
 TitersModify& ChartModify::titers_modify()
 {
     if (!titers_)
-        titers_ = std::make_shared<TitersModify>(main_->titers());
+        titers_ = make_modify<TitersModify>(main_->titers());
     return *titers_;
 
 } // ChartModify::titers_modify
@@ -320,18 +338,26 @@ std::pair<optimization_status, ProjectionModifyP> ChartModify::relax(MinimumColu
 
 // ----------------------------------------------------------------------
 
-void ChartModify::relax(number_of_optimizations_t number_of_optimizations, MinimumColumnBasis minimum_column_basis, number_of_dimensions_t number_of_dimensions,
-                        use_dimension_annealing dimension_annealing, const optimization_options& options, const DisconnectedPoints& disconnect_points)
+Stress ChartModify::relax_stress(number_of_dimensions_t number_of_dimensions, MinimumColumnBasis minimum_column_basis, const optimization_options& options, const DisconnectedPoints& disconnect_points)
 {
-    const auto start_num_dim = dimension_annealing == use_dimension_annealing::yes && *number_of_dimensions < 5 ? number_of_dimensions_t{5} : number_of_dimensions;
-    auto titrs = titers();
-    auto stress = acmacs::chart::stress_factory(*this, start_num_dim, minimum_column_basis, options.mult, dodgy_titer_is_regular::no);
+    auto stress = acmacs::chart::stress_factory(*this, number_of_dimensions, minimum_column_basis, options.mult, dodgy_titer_is_regular::no);
     stress.set_disconnected(disconnect_points);
     if (options.disconnect_too_few_numeric_titers == disconnect_few_numeric_titers::yes)
-        stress.extend_disconnected(titrs->having_too_few_numeric_titers());
+        stress.extend_disconnected(titers()->having_too_few_numeric_titers());
     if (const auto num_connected = number_of_antigens() + number_of_sera() - stress.number_of_disconnected(); num_connected < 3)
         throw std::runtime_error{AD_FORMAT("cannot relax: too few connected points: {}", num_connected)};
     report_disconnected_unmovable(stress.parameters().disconnected, stress.parameters().unmovable);
+    return stress;
+
+} // ChartModify::relax_stress
+
+// ----------------------------------------------------------------------
+
+void ChartModify::relax(number_of_optimizations_t number_of_optimizations, MinimumColumnBasis minimum_column_basis, number_of_dimensions_t number_of_dimensions,
+                        use_dimension_annealing dimension_annealing, const optimization_options& options, const DisconnectedPoints& disconnect_points)
+{
+    const auto start_num_dim = dimension_annealing == use_dimension_annealing::yes && *number_of_dimensions < 5 ? number_of_dimensions_t{5} : number_of_dimensions;
+    auto stress = relax_stress(start_num_dim, minimum_column_basis, options, disconnect_points);
     auto rnd = randomizer_plain_from_sample_optimization(*this, stress, start_num_dim, minimum_column_basis, options.randomization_diameter_multiplier);
 
     std::vector<std::shared_ptr<ProjectionModifyNew>> projections(*number_of_optimizations);
@@ -374,6 +400,232 @@ void ChartModify::relax(number_of_optimizations_t number_of_optimizations, Minim
 
 // ----------------------------------------------------------------------
 
+void ChartModify::relax_rough_fine(number_of_optimizations_t number_of_optimizations, size_t number_of_fine, MinimumColumnBasis minimum_column_basis, number_of_dimensions_t number_of_dimensions,
+                                   use_dimension_annealing dimension_annealing, const optimization_options& options, const DisconnectedPoints& disconnect_points)
+{
+    const auto start_num_dim = dimension_annealing == use_dimension_annealing::yes && *number_of_dimensions < 5 ? number_of_dimensions_t{5} : number_of_dimensions;
+    auto stress = relax_stress(start_num_dim, minimum_column_basis, options, disconnect_points);
+    auto rnd = randomizer_plain_from_sample_optimization(*this, stress, start_num_dim, minimum_column_basis, options.randomization_diameter_multiplier);
+    const auto number_of_points = number_of_antigens() + number_of_sera();
+
+#ifdef _OPENMP
+    const int num_threads = options.num_threads <= 0 ? omp_get_max_threads() : options.num_threads;
+    const int slot_size = number_of_antigens() < 1000 ? 4 : 1;
+#endif
+
+    // rough stage: layouts are not attached to projections, just the best number_of_fine are retained by selector
+    const auto rough_start = acmacs::timestamp();
+    RelaxSelector selector{std::min(number_of_fine, *number_of_optimizations)};
+#pragma omp parallel for default(shared) num_threads(num_threads) firstprivate(stress) schedule(static, slot_size)
+    for (size_t opt_no = 0; opt_no < *number_of_optimizations; ++opt_no) {
+        acmacs::Layout layout(number_of_points, start_num_dim);
+        for (size_t point_no = 0; point_no < number_of_points; ++point_no)
+            layout.update(point_no, rnd->get(start_num_dim));
+        const auto status = acmacs::chart::optimize(options.method, stress, layout.data(), layout.data() + layout.size(), optimization_precision::rough);
+        selector.add(status.final_stress, std::move(layout));
+    }
+    auto survivors = selector.extract();
+    AD_LOG(acmacs::log::relax, "rough stage: {} optimizations, {} kept, best stress: {:.4f}, time: {:.1f}s", selector.number_of_added(), survivors.size(), survivors.empty() ? 0.0 : survivors.front().stress,
+           acmacs::elapsed_seconds(rough_start));
+
+    // projections are created sequentially, ProjectionsModify is not thread safe
+    std::vector<std::shared_ptr<ProjectionModifyNew>> projections(survivors.size());
+    std::transform(projections.begin(), projections.end(), projections.begin(), [number_of_dimensions, minimum_column_basis, this, &stress](const auto&) {
+        auto projection = projections_modify().new_from_scratch(number_of_dimensions, minimum_column_basis);
+        projection->set_disconnected(stress.parameters().disconnected);
+        projection->set_unmovable(stress.parameters().unmovable);
+        return projection;
+    });
+
+    // fine stage: dimension annealing and fine optimization of the survivors only
+    const auto fine_start = acmacs::timestamp();
+#pragma omp parallel for default(shared) num_threads(num_threads) firstprivate(stress) schedule(dynamic, 1)
+    for (size_t p_no = 0; p_no < survivors.size(); ++p_no) {
+        auto& layout = survivors[p_no].layout;
+        stress.change_number_of_dimensions(start_num_dim);
+        if (start_num_dim > number_of_dimensions) {
+            acmacs::chart::dimension_annealing(options.method, stress, start_num_dim, number_of_dimensions, layout.data(), layout.data() + layout.size());
+            layout.change_number_of_dimensions(number_of_dimensions);
+            stress.change_number_of_dimensions(number_of_dimensions);
+        }
+        const auto status = acmacs::chart::optimize(options.method, stress, layout.data(), layout.data() + layout.size(), options.precision);
+        auto projection = projections[p_no];
+        projection->set_layout(layout);
+        if (!std::isnan(status.final_stress))
+            projection->stress_ = status.final_stress;
+        projection->transformation_reset();
+        AD_LOG(acmacs::log::report_stresses, "{:3d} {:.4f} (rough: {:.4f})", p_no, *projection->stress_, survivors[p_no].stress);
+    }
+    AD_LOG(acmacs::log::relax, "fine stage: {} optimizations, time: {:.1f}s", survivors.size(), acmacs::elapsed_seconds(fine_start));
+
+    projections_modify().sort();
+
+} // ChartModify::relax_rough_fine
+
+// ----------------------------------------------------------------------
+
+std::vector<size_t> ChartModify::relax_distinct(number_of_optimizations_t number_of_optimizations, MinimumColumnBasis minimum_column_basis, number_of_dimensions_t number_of_dimensions,
+                                                use_dimension_annealing dimension_annealing, const optimization_options& options, const RelaxDistinctMinima::parameters_t& distinct_parameters,
+                                                const DisconnectedPoints& disconnect_points)
+{
+    const auto start_num_dim = dimension_annealing == use_dimension_annealing::yes && *number_of_dimensions < 5 ? number_of_dimensions_t{5} : number_of_dimensions;
+    auto stress = relax_stress(start_num_dim, minimum_column_basis, options, disconnect_points);
+    auto rnd = randomizer_plain_from_sample_optimization(*this, stress, start_num_dim, minimum_column_basis, options.randomization_diameter_multiplier);
+    const auto number_of_points = number_of_antigens() + number_of_sera();
+
+    // disconnected points keep random coordinates, they must not affect procrustes
+    std::vector<CommonAntigensSera::common_t> points_to_compare;
+    for (size_t point_no = 0; point_no < number_of_points; ++point_no) {
+        if (!stress.parameters().is_disconnected(point_no))
+            points_to_compare.emplace_back(point_no, point_no);
+    }
+    RelaxDistinctMinima distinct{points_to_compare, distinct_parameters};
+
+#ifdef _OPENMP
+    const int num_threads = options.num_threads <= 0 ? omp_get_max_threads() : options.num_threads;
+    const int slot_size = number_of_antigens() < 1000 ? 4 : 1;
+#endif
+#pragma omp parallel for default(shared) num_threads(num_threads) firstprivate(stress) schedule(static, slot_size)
+    for (size_t opt_no = 0; opt_no < *number_of_optimizations; ++opt_no) {
+        acmacs::Layout layout(number_of_points, start_num_dim);
+        for (size_t point_no = 0; point_no < number_of_points; ++point_no)
+            layout.update(point_no, rnd->get(start_num_dim));
+        stress.change_number_of_dimensions(start_num_dim);
+        auto status = acmacs::chart::optimize(options.method, stress, layout.data(), layout.data() + layout.size(), start_num_dim > number_of_dimensions ? optimization_precision::rough : options.precision);
+        if (start_num_dim > number_of_dimensions) {
+            acmacs::chart::dimension_annealing(options.method, stress, start_num_dim, number_of_dimensions, layout.data(), layout.data() + layout.size());
+            layout.change_number_of_dimensions(number_of_dimensions);
+            stress.change_number_of_dimensions(number_of_dimensions);
+            status = acmacs::chart::optimize(options.method, stress, layout.data(), layout.data() + layout.size(), options.precision);
+        }
+        distinct.add(status.final_stress, std::move(layout));
+    }
+
+    const auto minima = distinct.extract();
+    AD_LOG(acmacs::log::relax, "{} optimizations converged to {} distinct minima, procrustes calculated: {}", distinct.number_of_added(), minima.size(), distinct.number_of_procrustes());
+    std::vector<size_t> hits(minima.size());
+    for (size_t m_no = 0; m_no < minima.size(); ++m_no) {
+        const auto& minimum = minima[m_no];
+        auto projection = projections_modify().new_from_scratch(number_of_dimensions, minimum_column_basis);
+        projection->set_disconnected(stress.parameters().disconnected);
+        projection->set_unmovable(stress.parameters().unmovable);
+        projection->set_layout(*minimum.layout);
+        projection->stress_ = minimum.stress;
+        projection->transformation_reset();
+        projection->comment(fmt::format("distinct minimum: {} of {} optimizations", minimum.hits, distinct.number_of_added()));
+        hits[m_no] = minimum.hits;
+        AD_LOG(acmacs::log::report_stresses, "{:3d} {:.4f} hits: {}", m_no, minimum.stress, minimum.hits);
+    }
+    return hits;
+
+} // ChartModify::relax_distinct
+
+// ----------------------------------------------------------------------
+
+void ChartModify::relax_checkpointed(number_of_optimizations_t number_of_optimizations, MinimumColumnBasis minimum_column_basis, number_of_dimensions_t number_of_dimensions,
+                                     use_dimension_annealing dimension_annealing, const optimization_options& options, RelaxCheckpoint& checkpoint, const DisconnectedPoints& disconnect_points)
+{
+    const auto start_num_dim = dimension_annealing == use_dimension_annealing::yes && *number_of_dimensions < 5 ? number_of_dimensions_t{5} : number_of_dimensions;
+    auto stress = relax_stress(start_num_dim, minimum_column_basis, options, disconnect_points);
+    const auto number_of_points = number_of_antigens() + number_of_sera();
+    const auto method = fmt::format("{}", options.method);
+    const auto annealing = dimension_annealing == use_dimension_annealing::yes;
+    const auto number_of_titers = titers()->number_of_non_dont_cares();
+
+    if (checkpoint.started()) {
+        if (checkpoint.number_of_dimensions != number_of_dimensions || !float_equal(checkpoint.minimum_column_basis, static_cast<double>(minimum_column_basis)) ||
+            checkpoint.optimization_method != method || checkpoint.dimension_annealing != annealing)
+            throw std::runtime_error{AD_FORMAT("cannot resume relax: checkpoint {} was made for {}d, minimum column basis {}, method {}, dimension annealing {}", checkpoint.filename,
+                                               checkpoint.number_of_dimensions, checkpoint.minimum_column_basis, checkpoint.optimization_method, checkpoint.dimension_annealing)};
+        if (checkpoint.number_of_antigens != number_of_antigens() || checkpoint.number_of_sera != number_of_sera() || checkpoint.number_of_titers != number_of_titers ||
+            std::any_of(checkpoint.best.begin(), checkpoint.best.end(), [number_of_points](const auto& entry) { return entry.layout.number_of_points() != number_of_points; }))
+            throw std::runtime_error{AD_FORMAT("cannot resume relax: checkpoint {} was made for a different chart ({} antigens, {} sera, {} titers)", checkpoint.filename,
+                                               checkpoint.number_of_antigens, checkpoint.number_of_sera, checkpoint.number_of_titers)};
+        // disconnected points were stored as 0, restore them as they are in an uninterrupted run
+        for (auto& entry : checkpoint.best)
+            stress.set_coordinates_of_disconnected(entry.layout.data(), entry.layout.size(), std::numeric_limits<double>::quiet_NaN(), number_of_dimensions);
+        AD_INFO("resuming relax from {}: {} optimizations completed", checkpoint.filename, checkpoint.completed);
+    }
+    else {
+        auto rnd = randomizer_plain_from_sample_optimization(*this, stress, start_num_dim, minimum_column_basis, options.randomization_diameter_multiplier);
+        checkpoint.number_of_dimensions = number_of_dimensions;
+        checkpoint.minimum_column_basis = minimum_column_basis;
+        checkpoint.optimization_method = method;
+        checkpoint.dimension_annealing = annealing;
+        checkpoint.number_of_antigens = number_of_antigens();
+        checkpoint.number_of_sera = number_of_sera();
+        checkpoint.number_of_titers = number_of_titers;
+        checkpoint.seed = std::random_device{}();
+        checkpoint.randomization_diameter = std::dynamic_pointer_cast<LayoutRandomizerPlain>(rnd)->diameter();
+        checkpoint.completed = 0;
+    }
+
+    RelaxSelector selector{checkpoint.number_to_keep};
+    for (auto& entry : checkpoint.best)
+        selector.add(entry.stress, std::move(entry.layout));
+
+#ifdef _OPENMP
+    const int num_threads = options.num_threads <= 0 ? omp_get_max_threads() : options.num_threads;
+#endif
+    while (checkpoint.completed < *number_of_optimizations) {
+        const auto batch_first = checkpoint.completed, batch_last = std::min(*number_of_optimizations, batch_first + std::max(checkpoint.every, 1UL));
+#pragma omp parallel for default(shared) num_threads(num_threads) firstprivate(stress) schedule(dynamic, 1)
+        for (size_t opt_no = batch_first; opt_no < batch_last; ++opt_no) {
+            // own randomizer for each optimization makes its starting layout independent from thread scheduling and interruptions
+            LayoutRandomizerPlain rnd{checkpoint.randomization_diameter, static_cast<std::uint_fast32_t>(checkpoint.seed + opt_no)};
+            acmacs::Layout layout(number_of_points, start_num_dim);
+            for (size_t point_no = 0; point_no < number_of_points; ++point_no)
+                layout.update(point_no, rnd.get(start_num_dim));
+            stress.change_number_of_dimensions(start_num_dim);
+            auto status = acmacs::chart::optimize(options.method, stress, layout.data(), layout.data() + layout.size(), start_num_dim > number_of_dimensions ? optimization_precision::rough : options.precision);
+            if (start_num_dim > number_of_dimensions) {
+                acmacs::chart::dimension_annealing(options.method, stress, start_num_dim, number_of_dimensions, layout.data(), layout.data() + layout.size());
+                layout.change_number_of_dimensions(number_of_dimensions);
+                stress.change_number_of_dimensions(number_of_dimensions);
+                status = acmacs::chart::optimize(options.method, stress, layout.data(), layout.data() + layout.size(), options.precision);
+            }
+            selector.add(status.final_stress, std::move(layout));
+        }
+        checkpoint.completed = batch_last;
+        checkpoint.best = selector.sorted();
+        checkpoint.write();
+        AD_LOG(acmacs::log::relax, "checkpoint {}: {} of {} optimizations completed, best stress: {:.4f}", checkpoint.filename, checkpoint.completed, *number_of_optimizations,
+               checkpoint.best.empty() ? 0.0 : checkpoint.best.front().stress);
+    }
+
+    for (const auto& entry : selector.sorted()) {
+        auto projection = projections_modify().new_from_scratch(number_of_dimensions, minimum_column_basis);
+        projection->set_disconnected(stress.parameters().disconnected);
+        projection->set_unmovable(stress.parameters().unmovable);
+        projection->set_layout(entry.layout);
+        projection->stress_ = entry.stress;
+        projection->transformation_reset();
+    }
+
+} // ChartModify::relax_checkpointed
+
+// ----------------------------------------------------------------------
+
+void ChartModify::relax_best_finely(size_t number_of_best, const optimization_options& options)
+{
+    auto& projections = projections_modify();
+    number_of_best = std::min(number_of_best, projections.size());
+    std::vector<ProjectionModifyP> best(number_of_best);
+    for (size_t p_no = 0; p_no < number_of_best; ++p_no)
+        best[p_no] = projections.at(p_no);
+    // column bases are cached by Chart::computed_column_bases() under lock, it is safe to relax in parallel
+#ifdef _OPENMP
+    const int num_threads = options.num_threads <= 0 ? omp_get_max_threads() : options.num_threads;
+#endif
+#pragma omp parallel for default(shared) num_threads(num_threads) schedule(dynamic, 1)
+    for (size_t p_no = 0; p_no < best.size(); ++p_no)
+        best[p_no]->relax(options);
+    projections.sort();
+
+} // ChartModify::relax_best_finely
+
+// ----------------------------------------------------------------------
+
 void ChartModify::relax_projections(const optimization_options& options, size_t first_projection_no, const DisconnectedPoints& disconnect_points)
 {
     auto titrs = titers();
@@ -494,12 +746,8 @@ void ChartModify::relax_incremental(size_t source_projection_no, number_of_optim
         projections_modify().remove(source_projection_no);
     projections_modify().sort();
 
-    if (options.precision == optimization_precision::fine) {
-        const size_t top_projections = std::min(5UL, *number_of_optimizations);
-        for (size_t p_no = 0; p_no < top_projections; ++p_no)
-            projections_modify().at(p_no)->relax(options); // do not omp parallel, occasionally fails
-        projections_modify().sort();
-    }
+    if (options.precision == optimization_precision::fine)
+        relax_best_finely(std::min(5UL, *number_of_optimizations), options);
 
 } // ChartModify::relax_incremental
 
@@ -514,7 +762,7 @@ void ChartModify::remove_layers()
 
 // ----------------------------------------------------------------------
 
-void ChartModify::remove_antigens(const ReverseSortedIndexes& indexes)
+void ChartModify::remove_antigens(const ReverseSortedIndexes& indexes, int threads)
 {
     // obtain *_modify pointers before removing antigens
     // otherwise they are incrrectly created with the new number of antigens
@@ -525,18 +773,18 @@ void ChartModify::remove_antigens(const ReverseSortedIndexes& indexes)
 
     antigens_mod.remove(indexes);
     titers_mod.remove_antigens(indexes);
-    projections_mod.remove_antigens(indexes);
+    projections_mod.remove_antigens(indexes, threads);
     plot_spec_mod.remove_antigens(indexes);
 
 } // ChartModify::remove_antigens
 
 // ----------------------------------------------------------------------
 
-void ChartModify::remove_sera(const ReverseSortedIndexes& indexes)
+void ChartModify::remove_sera(const ReverseSortedIndexes& indexes, int threads)
 {
     sera_modify().remove(indexes);
     titers_modify().remove_sera(indexes);
-    projections_modify().remove_sera(indexes, number_of_antigens());
+    projections_modify().remove_sera(indexes, number_of_antigens(), threads);
     plot_spec_modify().remove_sera(indexes);
     if (auto fcb = forced_column_bases_modify(MinimumColumnBasis{}); fcb)
         fcb->remove(indexes);
@@ -782,6 +1030,7 @@ void AntigenModify::replace_with(const Antigen& main)
     reference_ = main.reference();
     sequence_aa_ = main.sequence_aa();
     sequence_nuc_ = main.sequence_nuc();
+    name_changed();
 
 } // AntigenModify::replace_with
 
@@ -861,6 +1110,7 @@ void SerumModify::replace_with(const Serum& main)
     // homologous_antigens_ = main.homologous_antigens();
     sequence_aa_ = main.sequence_aa();
     sequence_nuc_ = main.sequence_nuc();
+    name_changed();
 
 } // SerumModify::replace_with
 
@@ -887,7 +1137,7 @@ void SerumModify::update_with(const Serum& main)
 // ----------------------------------------------------------------------
 
 TitersModify::TitersModify(size_t number_of_antigens, size_t number_of_sera)
-    : number_of_sera_{number_of_sera}, titers_{dense_t(number_of_antigens * number_of_sera)}
+    : number_of_sera_{number_of_sera}, titers_{std::make_shared<titers_t>(dense_t(number_of_antigens * number_of_sera))}, layers_{std::make_shared<layers_t>()}
 {
 } // TitersModify::TitersModify
 
@@ -895,7 +1145,8 @@ TitersModify::TitersModify(size_t number_of_antigens, size_t number_of_sera)
 
 TitersModify::TitersModify(TitersP main)
     : number_of_sera_{main->number_of_sera()},
-      titers_{main->is_dense() ? titers_t{dense_t{}} : titers_t{sparse_t{}}}
+      titers_{std::make_shared<titers_t>(main->is_dense() ? titers_t{dense_t{}} : titers_t{sparse_t{}})},
+      layers_{std::make_shared<layers_t>()}
 {
       // Titers
 
@@ -920,14 +1171,14 @@ TitersModify::TitersModify(TitersP main)
         }
     };
 
-    std::visit(fill_titers, titers_);
+    std::visit(fill_titers, *titers_);
 
       // Layers
     if (main->number_of_layers() > 0) {
-        layers_.resize(main->number_of_layers());
+        layers_->resize(main->number_of_layers());
         try {
             rjson::for_each(main->rjson_layers(), [this](const rjson::value& source_layer, size_t layer_no) {
-                auto& target = this->layers_[layer_no];
+                auto& target = (*this->layers_)[layer_no];
                 target.resize(source_layer.size());
                 rjson::for_each(source_layer, [&target](const rjson::value& source_row, size_t ag_no) {
                     using target_t = std::remove_reference_t<decltype(target[ag_no])>;
@@ -946,7 +1197,7 @@ TitersModify::TitersModify(TitersP main)
         }
         catch (data_not_available&) {
             for (size_t layer_no = 0; layer_no < main->number_of_layers(); ++layer_no) {
-                auto& target = layers_[layer_no];
+                auto& target = (*layers_)[layer_no];
                 target.resize(main->number_of_antigens());
                 for (auto ag_no : range_from_0_to(target.size())) {
                     for (auto sr_no : range_from_0_to(number_of_sera_))
@@ -991,7 +1242,7 @@ Titer TitersModify::titer(size_t aAntigenNo, size_t aSerumNo) const
         else
             return titer_in_sparse_t(titers, aAntigenNo, aSerumNo);
     };
-    return std::visit(get, titers_);
+    return std::visit(get, *titers_);
 
 } // TitersModify::titer
 
@@ -999,7 +1250,7 @@ Titer TitersModify::titer(size_t aAntigenNo, size_t aSerumNo) const
 
 Titer TitersModify::titer_of_layer(size_t aLayerNo, size_t aAntigenNo, size_t aSerumNo) const
 {
-    return titer_in_sparse_t(layers_[aLayerNo], aAntigenNo, aSerumNo);
+    return titer_in_sparse_t((*layers_)[aLayerNo], aAntigenNo, aSerumNo);
 
 } // TitersModify::titer_of_layer
 
@@ -1007,10 +1258,10 @@ Titer TitersModify::titer_of_layer(size_t aLayerNo, size_t aAntigenNo, size_t aS
 
 std::vector<Titer> TitersModify::titers_for_layers(size_t aAntigenNo, size_t aSerumNo, include_dotcare inc) const
 {
-    if (layers_.empty())
+    if (layers_->empty())
         throw acmacs::chart::data_not_available("no layers");
     std::vector<Titer> result;
-    for (const auto& layer: layers_) {
+    for (const auto& layer: *layers_) {
         if (const auto titer = find_titer_for_serum(layer[aAntigenNo], aSerumNo); !titer.is_dont_care())
             result.push_back(titer);
         else if (inc == include_dotcare::yes)
@@ -1024,11 +1275,11 @@ std::vector<Titer> TitersModify::titers_for_layers(size_t aAntigenNo, size_t aSe
 
 std::vector<size_t> TitersModify::layers_with_antigen(size_t aAntigenNo) const
 {
-    if (layers_.empty())
+    if (layers_->empty())
         throw acmacs::chart::data_not_available("no layers");
     const auto num_sera = number_of_sera();
     std::vector<size_t> result;
-    for (auto [no, layer] : acmacs::enumerate(layers_)) {
+    for (auto [no, layer] : acmacs::enumerate(*layers_)) {
         for (size_t serum_no = 0; serum_no < num_sera; ++serum_no) {
             if (const auto titer = find_titer_for_serum(layer[aAntigenNo], serum_no); !titer.is_dont_care()) {
                 result.push_back(no);
@@ -1044,11 +1295,11 @@ std::vector<size_t> TitersModify::layers_with_antigen(size_t aAntigenNo) const
 
 std::vector<size_t> TitersModify::layers_with_serum(size_t aSerumNo) const
 {
-    if (layers_.empty())
+    if (layers_->empty())
         throw acmacs::chart::data_not_available("no layers");
     const auto num_antigens = number_of_antigens();
     std::vector<size_t> result;
-    for (auto [no, layer] : acmacs::enumerate(layers_)) {
+    for (auto [no, layer] : acmacs::enumerate(*layers_)) {
         for (size_t antigen_no = 0; antigen_no < num_antigens; ++antigen_no) {
             if (const auto titer = find_titer_for_serum(layer[antigen_no], aSerumNo); !titer.is_dont_care()) {
                 result.push_back(no);
@@ -1064,7 +1315,7 @@ std::vector<size_t> TitersModify::layers_with_serum(size_t aSerumNo) const
 
 void TitersModify::remove_layers()
 {
-    layers_.clear();
+    layers_ = std::make_shared<layers_t>(); // layers shared with another TitersModify are not copied
 
 } // TitersModify::remove_layers
 
@@ -1074,10 +1325,11 @@ void TitersModify::create_layers(size_t number_of_layers, size_t number_of_antig
 {
     if (number_of_layers < 2)
         throw invalid_data{AD_FORMAT("invalid number of layers to create: {}", number_of_layers)};
-    if (!layers_.empty())
+    if (!layers_->empty())
         throw invalid_data{"cannot create layers: already present"};
-    layers_.resize(number_of_layers);
-    for (auto& layer : layers_)
+    auto& layers = layers_to_modify();
+    layers.resize(number_of_layers);
+    for (auto& layer : layers)
         layer.resize(number_of_antigens);
     layer_titer_modified_ = true;
 
@@ -1085,6 +1337,19 @@ void TitersModify::create_layers(size_t number_of_layers, size_t number_of_antig
 
 // ----------------------------------------------------------------------
 
+void TitersModify::set_layers(layers_t&& layers)
+{
+    if (layers.size() < 2)
+        throw invalid_data{AD_FORMAT("invalid number of layers to set: {}", layers.size())};
+    if (!layers_->empty())
+        throw invalid_data{"cannot set layers: already present"};
+    layers_ = std::make_shared<layers_t>(std::move(layers));
+    layer_titer_modified_ = true;
+
+} // TitersModify::set_layers
+
+// ----------------------------------------------------------------------
+
 void TitersModify::set_titer(sparse_t& titers, size_t aAntigenNo, size_t aSerumNo, const acmacs::chart::Titer& aTiter)
 {
     auto& row = titers[aAntigenNo];
@@ -1104,14 +1369,14 @@ void TitersModify::set_titer(sparse_t& titers, size_t aAntigenNo, size_t aSerumN
 
 void TitersModify::titer(size_t aAntigenNo, size_t aSerumNo, size_t aLayerNo, const acmacs::chart::Titer& aTiter)
 {
-    set_titer(layers_.at(aLayerNo), aAntigenNo, aSerumNo, aTiter);
+    set_titer(layers_to_modify().at(aLayerNo), aAntigenNo, aSerumNo, aTiter);
     layer_titer_modified_ = true;
 
 } // TitersModify::titer
 
 // ----------------------------------------------------------------------
 
-std::unique_ptr<TitersModify::titer_merge_report> TitersModify::set_from_layers(ChartModify& chart)
+std::unique_ptr<TitersModify::titer_merge_report> TitersModify::set_from_layers(ChartModify& chart, int threads)
 {
     // merge titers from layers
     // ~/ac/acmacs/acmacs/core/chart.py:1281
@@ -1119,14 +1384,15 @@ std::unique_ptr<TitersModify::titer_merge_report> TitersModify::set_from_layers(
     if (number_of_layers() < 2)
         throw std::runtime_error("table has no layers");
 
+    const auto cells = layer_cells(threads);
     std::shared_ptr<ColumnBases> column_bases;
     MinimumColumnBasis no_column_bases{};
     if (has_morethan_in_layers()) {
           // std::cerr << AD_FORMAT("DEBUG: has_morethan_in_layers");
-        set_titers_from_layers(more_than_thresholded::adjust_to_next);
+        set_titers_from_layers(cells, more_than_thresholded::adjust_to_next, threads);
         column_bases = computed_column_bases(no_column_bases);
     }
-    auto titer_merge_report = set_titers_from_layers(more_than_thresholded::to_dont_care);
+    auto titer_merge_report = set_titers_from_layers(cells, more_than_thresholded::to_dont_care, threads);
     if (column_bases) {
         chart.forced_column_bases_modify(*column_bases);
         AD_INFO("forced column bases: {}", *chart.forced_column_bases(no_column_bases));
@@ -1137,35 +1403,88 @@ std::unique_ptr<TitersModify::titer_merge_report> TitersModify::set_from_layers(
 
 // ----------------------------------------------------------------------
 
+TitersModify::layer_cells_t TitersModify::layer_cells(int threads) const
+{
+    const auto& layers = *layers_;
+    const auto number_of_antigens = layers[0].size();
+    const auto number_of_layers = layers.size();
+    layer_cells_t cells(number_of_antigens);
+#pragma omp parallel for default(none) shared(cells, layers, number_of_antigens, number_of_layers) num_threads(threads <= 0 ? omp_get_max_threads() : threads) schedule(dynamic, 64)
+    for (size_t ag_no = 0; ag_no < number_of_antigens; ++ag_no) {
+        auto& row = cells[ag_no];
+        for (size_t layer_no = 0; layer_no < number_of_layers; ++layer_no) {
+            for (const auto& [sr_no, titer] : layers[layer_no][ag_no]) {
+                if (!titer.is_dont_care())
+                    row.push_back(layer_titer_t{sr_no, layer_no, &titer});
+            }
+        }
+        // rows of each layer are sorted by serum, stable sort keeps layer order for the same serum
+        std::stable_sort(row.begin(), row.end(), [](const auto& e1, const auto& e2) { return e1.serum < e2.serum; });
+    }
+    return cells;
+
+} // TitersModify::layer_cells
+
+// ----------------------------------------------------------------------
+
 // if there are more-than thresholded titers and more_than_thresholded
 // is 'dont-care', ignore them, if more_than_thresholded is
 // 'adjust-to-next', those titers are converted to the next value,
 // e.g. >5120 to 10240.
-std::unique_ptr<TitersModify::titer_merge_report> TitersModify::set_titers_from_layers(more_than_thresholded mtt)
+std::unique_ptr<TitersModify::titer_merge_report> TitersModify::set_titers_from_layers(const layer_cells_t& cells, more_than_thresholded mtt, int threads)
 {
       // core/antigenic_table.py:266
       // backend/antigenic-table.hh:892
 
     constexpr double standard_deviation_threshold = 1.0; // lispmds: average-multiples-unless-sd-gt-1-ignore-thresholded-unless-only-entries-then-min-threshold
-    const auto number_of_antigens = layers_[0].size();
-    auto titers = std::make_unique<std::vector<titer_merge_data>>();
-    for (auto ag_no : range_from_0_to(number_of_antigens)) {
-        for (auto sr_no : range_from_0_to(number_of_sera_)) {
-            auto [titer, titer_merge_report] = titer_from_layers(ag_no, sr_no, mtt, standard_deviation_threshold);
-            titers->emplace_back(std::move(titer), ag_no, sr_no, titer_merge_report);
+    const auto number_of_antigens = cells.size();
+
+    // only populated cells are merged and reported, rows are computed in parallel
+    std::vector<titer_merge_report> report_rows(number_of_antigens);
+    sparse_t rows(number_of_antigens);
+#pragma omp parallel for default(none) shared(cells, report_rows, rows, number_of_antigens, mtt, standard_deviation_threshold) num_threads(threads <= 0 ? omp_get_max_threads() : threads) schedule(dynamic, 16)
+    for (size_t ag_no = 0; ag_no < number_of_antigens; ++ag_no) {
+        const auto& antigen_cells = cells[ag_no];
+        auto& report_row = report_rows[ag_no];
+        auto& row = rows[ag_no];
+        size_t number_of_cells{0}; // sera titrated in any layer
+        for (size_t no = 0; no < antigen_cells.size(); ++no) {
+            if (no == 0 || antigen_cells[no - 1].serum != antigen_cells[no].serum)
+                ++number_of_cells;
+        }
+        report_row.reserve(number_of_cells);
+        row.reserve(number_of_cells);
+        std::vector<Titer> titers;
+        for (auto cell = antigen_cells.begin(); cell != antigen_cells.end();) {
+            const auto sr_no = cell->serum;
+            titers.clear();
+            for (; cell != antigen_cells.end() && cell->serum == sr_no; ++cell)
+                titers.push_back(*cell->titer);
+            auto [titer, titer_merge_report] = merge_titers(titers, mtt, standard_deviation_threshold);
+            if (!titer.is_dont_care())
+                row.emplace_back(sr_no, titer);
+            report_row.emplace_back(std::move(titer), ag_no, sr_no, titer_merge_report);
         }
     }
 
-    if (titers->size() < (number_of_antigens * number_of_sera_ / 2))
-        titers_ = sparse_t(number_of_antigens);
-    else
-        titers_ = dense_t(number_of_antigens * number_of_sera_);
-    // std::cerr << "DEBUG: titers: " << titers.size() << " ag:" << number_of_antigens << " sr: " << number_of_sera_ << '\n';
-    for (const auto& data : *titers) {
-        if (!data.titer.is_dont_care())
-            std::visit([&data,this](auto& target) { this->set_titer(target, data.antigen, data.serum, data.titer); }, titers_);
+    const auto number_of_titers = std::accumulate(rows.begin(), rows.end(), size_t{0}, [](size_t sum, const auto& row) { return sum + row.size(); });
+    if (number_of_titers < (number_of_antigens * number_of_sera_ / 2)) {
+        titers_ = std::make_shared<titers_t>(std::move(rows));
+    }
+    else {
+        dense_t dense(number_of_antigens * number_of_sera_);
+        for (size_t ag_no = 0; ag_no < number_of_antigens; ++ag_no) {
+            for (auto& [sr_no, titer] : rows[ag_no])
+                dense[ag_no * number_of_sera_ + sr_no] = std::move(titer);
+        }
+        titers_ = std::make_shared<titers_t>(std::move(dense));
     }
 
+    auto titers = std::make_unique<titer_merge_report>();
+    titers->reserve(std::accumulate(report_rows.begin(), report_rows.end(), size_t{0}, [](size_t sum, const auto& row) { return sum + row.size(); }));
+    for (auto& report_row : report_rows)
+        std::move(report_row.begin(), report_row.end(), std::back_inserter(*titers));
+
     return titers;
 
 } // TitersModify::set_titers_from_layers
@@ -1263,21 +1582,6 @@ std::pair<Titer, TitersModify::titer_merge> TitersModify::merge_titers(const std
 
 // ----------------------------------------------------------------------
 
-std::pair<Titer, TitersModify::titer_merge> TitersModify::titer_from_layers(size_t ag_no, size_t sr_no, more_than_thresholded mtt, double standard_deviation_threshold) const
-{
-    std::vector<Titer> titers;
-    for (auto layer_no : range_from_0_to(layers_.size())) {
-        if (auto titer = titer_in_sparse_t(layers_[layer_no], ag_no, sr_no); !titer.is_dont_care()) {
-            titers.emplace_back(std::move(titer));
-        }
-    }
-
-    return merge_titers(titers, mtt, standard_deviation_threshold);
-
-} // TitersModify::titer_from_layers
-
-// ----------------------------------------------------------------------
-
 std::string TitersModify::titer_merge_report_brief(titer_merge data)
 {
     switch (data) {
@@ -1365,7 +1669,7 @@ size_t TitersModify::number_of_antigens() const
         else
             return titers.size();
     };
-    return std::visit(num_ags, titers_);
+    return std::visit(num_ags, *titers_);
 
 } // TitersModify::number_of_antigens
 
@@ -1380,7 +1684,7 @@ size_t TitersModify::number_of_non_dont_cares() const
         else
             return std::accumulate(titers.begin(), titers.end(), size_t{0}, [](size_t a, const auto& row) -> size_t { return a + row.size(); });
     };
-    return std::visit(num_non_dont_cares, titers_);
+    return std::visit(num_non_dont_cares, *titers_);
 
 } // TitersModify::number_of_non_dont_cares
 
@@ -1396,7 +1700,7 @@ size_t TitersModify::titrations_for_antigen(size_t antigen_no) const
         else
             return titers[antigen_no].size();
     };
-    return std::visit(num_non_dont_cares, titers_);
+    return std::visit(num_non_dont_cares, *titers_);
 
 } // TitersModify::titrations_for_antigen
 
@@ -1423,7 +1727,7 @@ size_t TitersModify::titrations_for_serum(size_t serum_no) const
         }
         return result;
     };
-    return std::visit(num_non_dont_cares, titers_);
+    return std::visit(num_non_dont_cares, *titers_);
 
 } // TitersModify::titrations_for_serum
 
@@ -1432,7 +1736,7 @@ size_t TitersModify::titrations_for_serum(size_t serum_no) const
 void TitersModify::titer(size_t aAntigenNo, size_t aSerumNo, const acmacs::chart::Titer& aTiter)
 {
     modifiable_check();
-    std::visit([aAntigenNo,aSerumNo,&aTiter,this](auto& titers) { this->set_titer(titers, aAntigenNo, aSerumNo, aTiter); }, titers_);
+    std::visit([aAntigenNo,aSerumNo,&aTiter,this](auto& titers) { this->set_titer(titers, aAntigenNo, aSerumNo, aTiter); }, titers_to_modify());
 
 } // TitersModify::titer
 
@@ -1450,7 +1754,7 @@ void TitersModify::dontcare_for_antigen(size_t aAntigenNo)
             titers[aAntigenNo].clear();
         }
     };
-    return std::visit(set_dontcare, titers_);
+    return std::visit(set_dontcare, titers_to_modify());
 
 } // TitersModify::dontcare_for_antigen
 
@@ -1472,7 +1776,7 @@ void TitersModify::dontcare_for_serum(size_t aSerumNo)
             }
         }
     };
-    return std::visit(set_dontcare, titers_);
+    return std::visit(set_dontcare, titers_to_modify());
 
 } // TitersModify::dontcare_for_serum
 
@@ -1491,7 +1795,7 @@ void TitersModify::multiply_by_for_antigen(size_t aAntigenNo, double multiply_by
             std::for_each(titers[aAntigenNo].begin(), titers[aAntigenNo].end(), [multiply_by](sparse_entry_t& entry) { entry.second = entry.second.multiplied_by(multiply_by); });
         }
     };
-    return std::visit(multiply, titers_);
+    return std::visit(multiply, titers_to_modify());
 
 } // TitersModify::multiply_by_for_antigen
 
@@ -1515,7 +1819,7 @@ void TitersModify::multiply_by_for_serum(size_t aSerumNo, double multiply_by)
             }
         }
     };
-    return std::visit(multiply, titers_);
+    return std::visit(multiply, titers_to_modify());
 
 } // TitersModify::multiply_by_for_serum
 
@@ -1577,7 +1881,7 @@ void TitersModify::set_proportion_of_titers_to_dont_care(double proportion)
             }
         }
     };
-    std::visit(set_to_dont_care, titers_);
+    std::visit(set_to_dont_care, titers_to_modify());
 
 } // TitersModify::set_proportion_of_titers_to_dont_care
 
@@ -1585,26 +1889,20 @@ void TitersModify::set_proportion_of_titers_to_dont_care(double proportion)
 
 void TitersModify::remove_antigens(const ReverseSortedIndexes& indexes)
 {
-    auto do_remove_antigens_sparse = [&indexes](auto& titers) { acmacs::remove(indexes, titers); };
+    // a single compaction pass over titers and each layer
+    const IndexCompaction compaction(number_of_antigens(), indexes);
 
-    auto do_remove_antigens_dense = [&indexes, this](auto& titers) {
-        for (auto index : indexes) {
-            const auto first = titers.begin() + static_cast<Indexes::difference_type>(index * this->number_of_sera_);
-            titers.erase(first, first + static_cast<Indexes::difference_type>(this->number_of_sera_));
-        }
-    };
-
-    auto do_remove_antigens = [&do_remove_antigens_sparse, &do_remove_antigens_dense](auto& titers) {
+    auto do_remove_antigens = [&compaction, this](auto& titers) {
         using T = std::decay_t<decltype(titers)>;
         if constexpr (std::is_same_v<T, dense_t>)
-            do_remove_antigens_dense(titers);
+            compaction.apply(titers, this->number_of_sera_);
         else
-            do_remove_antigens_sparse(titers);
+            compaction.apply(titers);
     };
 
-    std::visit(do_remove_antigens, titers_);
-    for (auto& layer : layers_)
-        do_remove_antigens_sparse(layer);
+    std::visit(do_remove_antigens, titers_to_modify());
+    for (auto& layer : layers_to_modify())
+        compaction.apply(layer);
 
 } // TitersModify::remove_antigens
 
@@ -1628,7 +1926,7 @@ void TitersModify::insert_antigen(size_t before)
             do_insert_antigen_sparse(titers);
     };
 
-    std::visit(do_insert_antigen, titers_);
+    std::visit(do_insert_antigen, titers_to_modify());
 
 } // TitersModify::insert_antigen
 
@@ -1636,26 +1934,24 @@ void TitersModify::insert_antigen(size_t before)
 
 void TitersModify::remove_sera(const ReverseSortedIndexes& indexes)
 {
-    auto do_remove_sera_sparse = [&indexes](auto& titers) {
+    // a single compaction pass over titers and each layer
+    const IndexCompaction compaction(number_of_sera_, indexes);
+
+    auto do_remove_sera_sparse = [&compaction](auto& titers) {
         for (auto& row : titers) {
-            for (auto index : indexes) {
-                  // remove entry for index, then renumber entries for >index
-                if (auto found = std::lower_bound(row.begin(), row.end(), index, [](const auto& e1, size_t sr_no) { return e1.first < sr_no; }); found != row.end()) {
-                    if (found->first == index)
-                        found = row.erase(found);
-                    for (; found != row.end(); ++found)
-                        --found->first;
-                }
-            }
+            row.erase(std::remove_if(row.begin(), row.end(), [&compaction](const auto& entry) { return compaction.is_removed(entry.first); }), row.end());
+            for (auto& entry : row)
+                entry.first = compaction[entry.first];
         }
     };
 
-    auto do_remove_sera_dense = [&indexes, this](auto& titers) {
-        using diff_t = Indexes::difference_type;
-        for (auto ag_no = static_cast<diff_t>(this->number_of_antigens()) - 1; ag_no >= 0; --ag_no) {
-            for (auto index : indexes)
-                titers.erase(titers.begin() + ag_no * static_cast<diff_t>(this->number_of_sera_) + static_cast<diff_t>(index));
+    auto do_remove_sera_dense = [&compaction, this](auto& titers) {
+        auto target = titers.begin();
+        for (auto source = titers.begin(); source != titers.end(); ++source) {
+            if (!compaction.is_removed(static_cast<size_t>(source - titers.begin()) % this->number_of_sera_))
+                *target++ = std::move(*source);
         }
+        titers.erase(target, titers.end());
     };
 
     auto do_remove_sera = [&do_remove_sera_sparse, &do_remove_sera_dense](auto& titers) {
@@ -1666,8 +1962,8 @@ void TitersModify::remove_sera(const ReverseSortedIndexes& indexes)
             do_remove_sera_sparse(titers);
     };
 
-    std::visit(do_remove_sera, titers_);
-    for (auto& layer : layers_)
+    std::visit(do_remove_sera, titers_to_modify());
+    for (auto& layer : layers_to_modify())
         do_remove_sera_sparse(layer);
 
     number_of_sera_ -= indexes.size();
@@ -1702,7 +1998,7 @@ void TitersModify::insert_serum(size_t before)
             do_insert_serum_sparse(titers);
     };
 
-    std::visit(do_insert_serum, titers_);
+    std::visit(do_insert_serum, titers_to_modify());
     ++number_of_sera_;
 
 } // TitersModify::insert_serum
@@ -1774,6 +2070,26 @@ std::shared_ptr<ProjectionModifyNew> ProjectionsModify::new_by_cloning(const Pro
 
 // ----------------------------------------------------------------------
 
+void ProjectionsModify::remove_antigens(const ReverseSortedIndexes& indexes, int threads)
+{
+#pragma omp parallel for default(none) shared(indexes) num_threads(threads <= 0 ? omp_get_max_threads() : threads) schedule(dynamic)
+    for (size_t projection_no = 0; projection_no < projections_.size(); ++projection_no)
+        projections_[projection_no]->remove_antigens(indexes);
+
+} // ProjectionsModify::remove_antigens
+
+// ----------------------------------------------------------------------
+
+void ProjectionsModify::remove_sera(const ReverseSortedIndexes& indexes, size_t number_of_antigens, int threads)
+{
+#pragma omp parallel for default(none) shared(indexes, number_of_antigens) num_threads(threads <= 0 ? omp_get_max_threads() : threads) schedule(dynamic)
+    for (size_t projection_no = 0; projection_no < projections_.size(); ++projection_no)
+        projections_[projection_no]->remove_sera(indexes, number_of_antigens);
+
+} // ProjectionsModify::remove_sera
+
+// ----------------------------------------------------------------------
+
 void ProjectionsModify::remove_all()
 {
     projections_.erase(projections_.begin(), projections_.end());
@@ -1837,35 +2153,10 @@ PointIndexList ProjectionModify::non_nan_points() const // for relax_incremental
 
 // ----------------------------------------------------------------------
 
-static inline void remove_from(PointIndexList& list, const acmacs::ReverseSortedIndexes& indexes, size_t base)
-{
-    // if (!list.empty() && !indexes.empty())
-    //     fmt::print(stderr, "DEBUG: remove_from BEGIN {} {} {}\n", list, indexes, base);
-    for (const auto to_remove_base : indexes) {
-        const auto to_remove = to_remove_base + base;
-        for (auto listp = list.rbegin(); listp != list.rend(); ++listp) {
-            if (*listp > to_remove) {
-                --*listp;
-            }
-            else if (*listp == to_remove) {
-                list.erase(listp.base() - 1);
-                break;
-            }
-            else
-                break;
-        }
-    }
-    // if (!indexes.empty())
-    //     fmt::print(stderr, "DEBUG: remove_from END {}\n", list);
-}
-
 void ProjectionModify::remove_antigens(const ReverseSortedIndexes& indexes)
 {
     modify();
-    layout_modified()->remove_points(indexes, 0);
-    ::remove_from(disconnected_, indexes, 0);
-    ::remove_from(unmovable_, indexes, 0);
-    ::remove_from(unmovable_in_the_last_dimension_, indexes, 0);
+    remove_points(IndexCompaction(layout_->number_of_points(), indexes, 0));
 
 } // ProjectionModify::remove_antigens
 
@@ -1874,17 +2165,32 @@ void ProjectionModify::remove_antigens(const ReverseSortedIndexes& indexes)
 void ProjectionModify::remove_sera(const ReverseSortedIndexes& indexes, size_t number_of_antigens)
 {
     modify();
-    layout_modified()->remove_points(indexes, number_of_antigens);
     if (forced_column_bases_)
         forced_column_bases_->remove(indexes);
-    ::remove_from(disconnected_, indexes, number_of_antigens);
-    ::remove_from(unmovable_, indexes, number_of_antigens);
-    ::remove_from(unmovable_in_the_last_dimension_, indexes, number_of_antigens);
+    remove_points(IndexCompaction(layout_->number_of_points(), indexes, number_of_antigens));
 
 } // ProjectionModify::remove_sera
 
 // ----------------------------------------------------------------------
 
+void ProjectionModify::remove_points(const IndexCompaction& compaction)
+{
+    modify();
+    const auto& source = *layout_;
+    auto compacted = std::make_shared<acmacs::Layout>(compaction.new_size(), source.number_of_dimensions());
+    for (size_t point_no = 0; point_no < compaction.old_size(); ++point_no) {
+        if (!compaction.is_removed(point_no))
+            compacted->update(compaction[point_no], source[point_no]);
+    }
+    layout_ = std::move(compacted);
+    compaction.renumber(disconnected_);
+    compaction.renumber(unmovable_);
+    compaction.renumber(unmovable_in_the_last_dimension_);
+
+} // ProjectionModify::remove_points
+
+// ----------------------------------------------------------------------
+
 static inline void index_inserted(PointIndexList& list, size_t before, size_t base)
 {
     for (auto listp = std::lower_bound(list.begin(), list.end(), before + base); listp != list.end(); ++listp)
@@ -2073,8 +2379,9 @@ PlotSpecModify::PlotSpecModify(size_t number_of_antigens, size_t number_of_sera)
 void PlotSpecModify::remove_antigens(const ReverseSortedIndexes& indexes)
 {
     modify();
-    acmacs::remove(indexes, styles_);
-    drawing_order_.remove_points(indexes);
+    const IndexCompaction compaction(styles_.size(), indexes);
+    compaction.apply(styles_);
+    drawing_order_.remove_points(compaction);
     number_of_antigens_ -= indexes.size();
 
 } // PlotSpecModify::remove_antigens
@@ -2084,8 +2391,9 @@ void PlotSpecModify::remove_antigens(const ReverseSortedIndexes& indexes)
 void PlotSpecModify::remove_sera(const ReverseSortedIndexes& indexes)
 {
     modify();
-    acmacs::remove(indexes, styles_, static_cast<ReverseSortedIndexes::difference_type>(number_of_antigens_));
-    drawing_order_.remove_points(indexes, number_of_antigens_);
+    const IndexCompaction compaction(styles_.size(), indexes, number_of_antigens_);
+    compaction.apply(styles_);
+    drawing_order_.remove_points(compaction);
 
 } // PlotSpecModify::remove_sera
 
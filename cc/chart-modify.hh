@@ -7,6 +7,8 @@
 #include "acmacs-chart-2/chart.hh"
 #include "acmacs-chart-2/procrustes.hh"
 #include "acmacs-chart-2/randomizer.hh"
+#include "acmacs-chart-2/relax-selector.hh"
+#include "acmacs-chart-2/relax-checkpoint.hh"
 
 // ----------------------------------------------------------------------
 
@@ -78,13 +80,31 @@ namespace acmacs::chart
                                                                 const DisconnectedPoints& disconnect_points = {});
         void relax(number_of_optimizations_t number_of_optimizations, MinimumColumnBasis minimum_column_basis, number_of_dimensions_t number_of_dimensions, use_dimension_annealing dimension_annealing,
                    const optimization_options& options, const DisconnectedPoints& disconnect_points = {});
+        // multi-stage relax: number_of_optimizations rough optimizations (in start dimensions if dimension annealing is used),
+        // number_of_fine best of them are kept, annealed and then finely optimized in parallel,
+        // just survivors are added to the chart as projections
+        void relax_rough_fine(number_of_optimizations_t number_of_optimizations, size_t number_of_fine, MinimumColumnBasis minimum_column_basis, number_of_dimensions_t number_of_dimensions,
+                              use_dimension_annealing dimension_annealing, const optimization_options& options, const DisconnectedPoints& disconnect_points = {});
+        // relax like above but keep just distinct minima (see RelaxDistinctMinima), the new projections are sorted by stress and added to the chart,
+        // returns number of optimizations converged to each of them, projection comment reports it as well
+        std::vector<size_t> relax_distinct(number_of_optimizations_t number_of_optimizations, MinimumColumnBasis minimum_column_basis, number_of_dimensions_t number_of_dimensions,
+                                           use_dimension_annealing dimension_annealing, const optimization_options& options, const RelaxDistinctMinima::parameters_t& distinct_parameters,
+                                           const DisconnectedPoints& disconnect_points = {});
+        // relax like above writing checkpoint.number_to_keep best layouts and the run state to checkpoint.filename after every checkpoint.every optimizations,
+        // if checkpoint was read (checkpoint.started()), optimizations [0, checkpoint.completed) are not repeated,
+        // the best layouts are added to the chart as projections sorted by stress
+        void relax_checkpointed(number_of_optimizations_t number_of_optimizations, MinimumColumnBasis minimum_column_basis, number_of_dimensions_t number_of_dimensions,
+                                use_dimension_annealing dimension_annealing, const optimization_options& options, RelaxCheckpoint& checkpoint, const DisconnectedPoints& disconnect_points = {});
+        // relax number_of_best first projections (using options.precision) in parallel and then sort projections
+        void relax_best_finely(size_t number_of_best, const optimization_options& options);
         void relax_incremental(size_t source_projection_no, number_of_optimizations_t number_of_optimizations, const optimization_options& options,
                                remove_source_projection rsp = remove_source_projection::yes, unmovable_non_nan_points unnp = unmovable_non_nan_points::no);
         void relax_projections(const optimization_options& options, size_t first_projection_no, const DisconnectedPoints& disconnect_points = {});
 
         void remove_layers();
-        void remove_antigens(const ReverseSortedIndexes& indexes);
-        void remove_sera(const ReverseSortedIndexes& indexes);
+        // threads: number of threads to update projections with (omp): 0 - autodetect, 1 - sequential
+        void remove_antigens(const ReverseSortedIndexes& indexes, int threads = 0);
+        void remove_sera(const ReverseSortedIndexes& indexes, int threads = 0);
         AntigenModifyP insert_antigen(size_t before);
         SerumModifyP insert_serum(size_t before);
         void detect_reference_antigens(remove_reference_before_detecting rrbd);
@@ -108,6 +128,7 @@ namespace acmacs::chart
         rjson::value extensions_{rjson::null{}};
 
         void report_disconnected_unmovable(const DisconnectedPoints& disconnected, const UnmovablePoints& unmovable) const;
+        Stress relax_stress(number_of_dimensions_t number_of_dimensions, MinimumColumnBasis minimum_column_basis, const optimization_options& options, const DisconnectedPoints& disconnect_points);
 
     }; // class ChartModify
 
@@ -213,16 +234,16 @@ namespace acmacs::chart
         std::string sequence_aa() const override { return sequence_aa_; }
         std::string sequence_nuc() const override { return sequence_nuc_; }
 
-        void name(std::string_view value) { name_ = acmacs::virus::name_t{value}; }
+        void name(std::string_view value) { name_ = acmacs::virus::name_t{value}; name_changed(); }
         void date(std::string_view value) { date_ = Date{value}; }
-        void passage(const acmacs::virus::Passage& value) { passage_ = value; }
+        void passage(const acmacs::virus::Passage& value) { passage_ = value; name_changed(); }
         void lineage(std::string_view value) { lineage_ = value; }
-        void reassortant(const acmacs::virus::Reassortant& value) { reassortant_ = value; }
+        void reassortant(const acmacs::virus::Reassortant& value) { reassortant_ = value; name_changed(); }
         void reference(bool value) { reference_ = value; }
-        void add_annotation(std::string_view annotation) { annotations_.insert_if_not_present(std::string{annotation}); }
-        void set_distinct() { annotations_.set_distinct(); }
+        void add_annotation(std::string_view annotation) { annotations_.insert_if_not_present(std::string{annotation}); name_changed(); }
+        void set_distinct() { annotations_.set_distinct(); name_changed(); }
         void add_clade(std::string_view clade) { clades_.insert_if_not_present(std::string{clade}); }
-        void remove_annotation(std::string_view annotation) { annotations_.remove(std::string{annotation}); }
+        void remove_annotation(std::string_view annotation) { annotations_.remove(std::string{annotation}); name_changed(); }
         template <typename S> void continent(S&& value) { continent_ = Continent{std::forward<S>(value)}; }
         void set_continent();
         void sequence_aa(std::string_view seq) { sequence_aa_.assign(seq); }
@@ -231,7 +252,12 @@ namespace acmacs::chart
         void replace_with(const Antigen& main);
         void update_with(const Antigen& main);
 
+        // name index of the AntigensModify owning this entry, it is marked as outdated when name is changed
+        void name_index_outdated(const std::shared_ptr<std::atomic<bool>>& flag) { name_index_outdated_ = flag; }
+
       private:
+        std::shared_ptr<std::atomic<bool>> name_index_outdated_;
+        void name_changed() { if (name_index_outdated_) *name_index_outdated_ = true; }
         acmacs::virus::name_t name_;
         Date date_;
         acmacs::virus::Passage passage_;
@@ -269,15 +295,15 @@ namespace acmacs::chart
         std::string sequence_aa() const override { return sequence_aa_; }
         std::string sequence_nuc() const override { return sequence_nuc_; }
 
-        void name(std::string_view value) { name_ = acmacs::virus::name_t{value}; }
+        void name(std::string_view value) { name_ = acmacs::virus::name_t{value}; name_changed(); }
         void passage(const acmacs::virus::Passage& value) { passage_ = value; }
         void lineage(std::string_view value) { lineage_ = value; }
-        void reassortant(const acmacs::virus::Reassortant& value) { reassortant_ = value; }
-        void serum_id(const SerumId& value) { serum_id_ = value; }
+        void reassortant(const acmacs::virus::Reassortant& value) { reassortant_ = value; name_changed(); }
+        void serum_id(const SerumId& value) { serum_id_ = value; name_changed(); }
         void serum_species(const SerumSpecies& value) { serum_species_ = value; }
-        void add_annotation(std::string_view annotation) { annotations_.insert_if_not_present(std::string{annotation}); }
+        void add_annotation(std::string_view annotation) { annotations_.insert_if_not_present(std::string{annotation}); name_changed(); }
         void add_clade(std::string_view clade) { clades_.insert_if_not_present(std::string{clade}); }
-        void remove_annotation(std::string_view annotation) { annotations_.remove(std::string{annotation}); }
+        void remove_annotation(std::string_view annotation) { annotations_.remove(std::string{annotation}); name_changed(); }
         void set_continent() {}
         void sequence_aa(std::string_view seq) { sequence_aa_.assign(seq); }
         void sequence_nuc(std::string_view seq) { sequence_nuc_.assign(seq); }
@@ -285,7 +311,12 @@ namespace acmacs::chart
         void replace_with(const Serum& main);
         void update_with(const Serum& main);
 
+        // name index of the SeraModify owning this entry, it is marked as outdated when name is changed
+        void name_index_outdated(const std::shared_ptr<std::atomic<bool>>& flag) { name_index_outdated_ = flag; }
+
       private:
+        std::shared_ptr<std::atomic<bool>> name_index_outdated_;
+        void name_changed() { if (name_index_outdated_) *name_index_outdated_ = true; }
         acmacs::virus::name_t name_;
         acmacs::virus::Passage passage_;
         BLineage lineage_;
@@ -315,37 +346,56 @@ namespace acmacs::chart
         {
             std::transform(main->begin(), main->end(), data_.begin(), [](auto ag_sr) { return std::make_shared<Modify>(*ag_sr); });
         }
+        // entries are shared with source until modified (copy on write) in either of them, source must not be modified concurrently
+        explicit AntigensSeraModify(const AntigensSeraModify& source) : Base{}, data_{source.data_} {}
 
         size_t size() const override { return data_.size(); }
         std::shared_ptr<ModifyBase> operator[](size_t aIndex) const override { return data_.at(aIndex); }
-        Modify& at(size_t aIndex) { return *data_.at(aIndex); }
-        std::shared_ptr<Modify> ptr_at(size_t aIndex) { return data_.at(aIndex); }
+        // entries changing their names through non-const access mark name index as outdated, it is rebuilt on the next find_by_full_name() or find_by_name()
+        // entry referred elsewhere (e.g. shared with a clone) is copied first, i.e. pointer returned by ptr_at() must not be kept across ptr_at() calls for the same entry
+        Modify& at(size_t aIndex) { return *ptr_at(aIndex); }
+        std::shared_ptr<Modify> ptr_at(size_t aIndex)
+        {
+            auto& entry = data_.at(aIndex);
+            if (entry.use_count() > 1)
+                entry = std::make_shared<Modify>(static_cast<const ModifyBase&>(*entry));
+            entry->name_index_outdated(this->name_index_outdated());
+            return entry;
+        }
 
         void remove(const ReverseSortedIndexes& indexes)
         {
+            this->invalidate_name_index();
             for (auto index : indexes) {
                 if (index >= data_.size())
                     throw invalid_data{"invalid index to remove: " + to_string(index) + ", valid values in [0.." + to_string(data_.size()) + ')'};
-                data_.erase(data_.begin() + static_cast<Indexes::difference_type>(index));
             }
+            const IndexCompaction compaction(data_.size(), indexes);
+            compaction.apply(data_);
         }
 
         std::shared_ptr<Modify> insert(size_t before)
         {
             if (before > data_.size())
                 throw invalid_data{"invalid index to insert before: " + to_string(before) + ", valid values in [0.." + to_string(data_.size()) + ']'};
-            return *data_.emplace(data_.begin() + static_cast<Indexes::difference_type>(before), std::make_shared<Modify>());
+            this->invalidate_name_index();
+            auto& entry = *data_.emplace(data_.begin() + static_cast<Indexes::difference_type>(before), std::make_shared<Modify>());
+            entry->name_index_outdated(this->name_index_outdated());
+            return entry;
         }
 
         std::shared_ptr<Modify> append()
         {
-            return data_.emplace_back(std::make_shared<Modify>());
+            this->invalidate_name_index();
+            auto& entry = data_.emplace_back(std::make_shared<Modify>());
+            entry->name_index_outdated(this->name_index_outdated());
+            return entry;
         }
 
         void set_continent()
         {
-            for (auto& entry : data_)
-                entry->set_continent();
+            for (size_t index = 0; index < data_.size(); ++index)
+                at(index).set_continent();
         }
 
         void duplicates_distinct(const duplicates_t& dups)
@@ -356,6 +406,9 @@ namespace acmacs::chart
             }
         }
 
+      protected:
+        std::shared_ptr<ModifyBase> to_modify(size_t aIndex) override { return ptr_at(aIndex); }
+
       private:
         std::vector<std::shared_ptr<Modify>> data_;
     };
@@ -400,7 +453,7 @@ namespace acmacs::chart
             titer_merge report;
         };
 
-        using titer_merge_report = std::vector<titer_merge_data>;
+        using titer_merge_report = std::vector<titer_merge_data>; // cells having titers in layers only, ordered by antigen, then by serum
 
         enum class more_than_thresholded { adjust_to_next, to_dont_care };
 
@@ -408,6 +461,11 @@ namespace acmacs::chart
 
         explicit TitersModify(size_t number_of_antigens, size_t number_of_sera);
         explicit TitersModify(TitersP main);
+        // titers and layers are shared with source until modified (copy on write) in either of them
+        explicit TitersModify(const TitersModify& source)
+            : Titers{}, number_of_sera_{source.number_of_sera_}, titers_{source.titers_}, layers_{source.layers_}, layer_titer_modified_{source.layer_titer_modified_}
+        {
+        }
 
         Titer titer(size_t aAntigenNo, size_t aSerumNo) const override;
         size_t number_of_antigens() const override;
@@ -416,7 +474,7 @@ namespace acmacs::chart
         size_t titrations_for_antigen(size_t antigen_no) const override;
         size_t titrations_for_serum(size_t serum_no) const override;
 
-        bool modifiable() const noexcept { return layers_.empty(); }
+        bool modifiable() const noexcept { return layers_->empty(); }
         void modifiable_check() const
         {
             if (!modifiable())
@@ -439,16 +497,17 @@ namespace acmacs::chart
         void append_antigen() { insert_antigen(number_of_antigens()); }
         void insert_serum(size_t before);
 
-        size_t number_of_layers() const override { return layers_.size(); }
+        size_t number_of_layers() const override { return layers_->size(); }
         Titer titer_of_layer(size_t aLayerNo, size_t aAntigenNo, size_t aSerumNo) const override;
-        const layers_t& layers() const { return layers_; }
+        const layers_t& layers() const { return *layers_; }
         std::vector<Titer> titers_for_layers(size_t aAntigenNo, size_t aSerumNo, include_dotcare inc = include_dotcare::no) const override;
         std::vector<size_t> layers_with_antigen(size_t aAntigenNo) const override;
         std::vector<size_t> layers_with_serum(size_t aSerumNo) const override;
         void remove_layers();
         void create_layers(size_t number_of_layers, size_t number_of_antigens);
+        void set_layers(layers_t&& layers); // each layer has a row for every antigen, entries of a row sorted by serum
         void titer(size_t aAntigenNo, size_t aSerumNo, size_t aLayerNo, const Titer& aTiter);
-        std::unique_ptr<titer_merge_report> set_from_layers(ChartModify& chart);
+        std::unique_ptr<titer_merge_report> set_from_layers(ChartModify& chart, int threads = 0);
 
         static std::pair<Titer, titer_merge> merge_titers(const std::vector<Titer>& titers, more_than_thresholded mtt, double standard_deviation_threshold);
         static std::string titer_merge_report_brief(titer_merge data);
@@ -458,18 +517,40 @@ namespace acmacs::chart
       private:
         // size_t number_of_antigens_;
         size_t number_of_sera_;
-        titers_t titers_;
-        layers_t layers_;
+        std::shared_ptr<titers_t> titers_; // never null, may be shared with copies of this
+        std::shared_ptr<layers_t> layers_; // never null, may be shared with copies of this
         bool layer_titer_modified_ = false; // force titer recalculation
 
+        titers_t& titers_to_modify()
+        {
+            if (titers_.use_count() > 1)
+                titers_ = std::make_shared<titers_t>(*titers_);
+            return *titers_;
+        }
+        layers_t& layers_to_modify()
+        {
+            if (layers_.use_count() > 1)
+                layers_ = std::make_shared<layers_t>(*layers_);
+            return *layers_;
+        }
+
         static Titer find_titer_for_serum(const sparse_row_t& aRow, size_t aSerumNo);
         static Titer titer_in_sparse_t(const sparse_t& aSparse, size_t aAntigenNo, size_t aSerumNo);
 
         void set_titer(dense_t& titers, size_t aAntigenNo, size_t aSerumNo, const Titer& aTiter) { titers[aAntigenNo * number_of_sera_ + aSerumNo] = aTiter; }
         void set_titer(sparse_t& titers, size_t aAntigenNo, size_t aSerumNo, const Titer& aTiter);
 
-        std::unique_ptr<titer_merge_report> set_titers_from_layers(more_than_thresholded mtt);
-        std::pair<Titer, titer_merge> titer_from_layers(size_t ag_no, size_t sr_no, more_than_thresholded mtt, double standard_deviation_threshold) const;
+        // cell-major view of the layers: for each antigen non-dont-care titers of all layers ordered by serum, then by layer
+        struct layer_titer_t
+        {
+            size_t serum;
+            size_t layer;
+            const Titer* titer; // in layers_
+        };
+        using layer_cells_t = std::vector<std::vector<layer_titer_t>>;
+
+        layer_cells_t layer_cells(int threads) const;
+        std::unique_ptr<titer_merge_report> set_titers_from_layers(const layer_cells_t& cells, more_than_thresholded mtt, int threads);
 
     }; // class TitersModify
 
@@ -596,6 +677,7 @@ namespace acmacs::chart
 
         void remove_antigens(const ReverseSortedIndexes& indexes);
         void remove_sera(const ReverseSortedIndexes& indexes, size_t number_of_antigens);
+        void remove_points(const IndexCompaction& compaction); // compaction of all points (antigens and sera)
         void insert_antigen(size_t before);
         void insert_serum(size_t before, size_t number_of_antigens);
 
@@ -793,14 +875,9 @@ namespace acmacs::chart
         void remove_all_except(size_t projection_no);
         void remove_except(size_t number_of_initial_projections_to_keep, ProjectionP projection_to_keep = {nullptr});
 
-        void remove_antigens(const ReverseSortedIndexes& indexes)
-        {
-            for_each(projections_.begin(), projections_.end(), [&](auto& projection) { projection->remove_antigens(indexes); });
-        }
-        void remove_sera(const ReverseSortedIndexes& indexes, size_t number_of_antigens)
-        {
-            for_each(projections_.begin(), projections_.end(), [&indexes, number_of_antigens](auto& projection) { projection->remove_sera(indexes, number_of_antigens); });
-        }
+        // projections are updated in parallel, threads: 0 - omp_get_max_threads(), 1 - sequential
+        void remove_antigens(const ReverseSortedIndexes& indexes, int threads = 0);
+        void remove_sera(const ReverseSortedIndexes& indexes, size_t number_of_antigens, int threads = 0);
         void insert_antigen(size_t before)
         {
             for_each(projections_.begin(), projections_.end(), [=](auto& projection) { projection->insert_antigen(before); });
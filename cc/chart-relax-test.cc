@@ -7,6 +7,7 @@
 #include "acmacs-chart-2/factory-export.hh"
 #include "acmacs-chart-2/chart-modify.hh"
 #include "acmacs-chart-2/randomizer.hh"
+#include "acmacs-chart-2/alglib.hh"
 
 // ----------------------------------------------------------------------
 
@@ -14,6 +15,8 @@ static void test_rough(acmacs::chart::ChartModify& chart, size_t attempts, std::
 static void test_randomization(acmacs::chart::ChartModify& chart, size_t attempts, std::string min_col_basis, acmacs::number_of_dimensions_t num_dims);
 static void test_dimension(acmacs::chart::ChartModify& chart, std::string min_col_basis);
 static void test_lbfgs_cg(acmacs::chart::ChartModify& chart, std::string min_col_basis, const acmacs::chart::dimension_schedule& schedule, acmacs::chart::optimization_precision precision);
+static void compare_native(acmacs::chart::ChartModify& chart, size_t attempts, std::string min_col_basis, acmacs::number_of_dimensions_t num_dims, acmacs::chart::optimization_precision precision);
+static void compare_pca(acmacs::chart::optimization_method method, acmacs::chart::ChartModify& chart, size_t attempts, std::string min_col_basis, acmacs::number_of_dimensions_t num_dims);
 static void optimize_n(acmacs::chart::optimization_method method, acmacs::chart::ChartModify& chart, size_t attempts, std::string min_col_basis, acmacs::number_of_dimensions_t num_dims, acmacs::chart::optimization_precision precision);
 static void optimize_n(acmacs::chart::optimization_method method, acmacs::chart::ChartModify& chart, size_t attempts, std::string min_col_basis, const acmacs::chart::dimension_schedule& schedule, acmacs::chart::optimization_precision precision);
 
@@ -34,6 +37,8 @@ int main(int argc, char* const argv[])
                 {"--test-randomization", false},
                 {"--test-dimension", false},
                 {"--test-lbfgs-cg", false},
+                {"--compare-native", false, "compare native and alglib optimizers (stress and time) starting from the same random layouts"},
+                {"--compare-pca", false, "compare alglib and jacobi pca used by dimension annealing (time and final stress) after the same 5d rough optimizations"},
                 {"--time", false, "report time of loading chart"},
                 {"--verbose", false},
                 {"-h", false},
@@ -64,6 +69,12 @@ int main(int argc, char* const argv[])
             else if (args["--test-lbfgs-cg"]) {
                 test_lbfgs_cg(chart, args["-m"].str(), schedule, precision);
             }
+            else if (args["--compare-native"]) {
+                compare_native(chart, args["-n"], args["-m"].str(), number_of_dimensions, precision);
+            }
+            else if (args["--compare-pca"]) {
+                compare_pca(method, chart, args["-n"], args["-m"].str(), number_of_dimensions);
+            }
             else {
                 optimize_n(method, chart, args["-n"], args["-m"].str(), schedule, precision);
                 chart.projections_modify().sort();
@@ -186,6 +197,111 @@ void test_lbfgs_cg(acmacs::chart::ChartModify& chart, std::string min_col_basis,
 
 // ----------------------------------------------------------------------
 
+void compare_native(acmacs::chart::ChartModify& chart, size_t attempts, std::string min_col_basis, acmacs::number_of_dimensions_t num_dims, acmacs::chart::optimization_precision precision)
+{
+    using namespace acmacs::chart;
+    constexpr std::array methods{optimization_method::alglib_lbfgs_pca, optimization_method::native_lbfgs_pca, optimization_method::alglib_cg_pca, optimization_method::native_cg_pca};
+
+    struct total_t
+    {
+        double stress{0};
+        std::chrono::microseconds time{0};
+        size_t iterations{0}, stress_calculations{0}, best{0};
+    };
+    std::array<total_t, methods.size()> totals;
+
+    auto projection = chart.projections_modify().new_from_scratch(num_dims, min_col_basis);
+    auto randomizer = randomizer_plain_with_table_max_distance(*projection);
+    for (size_t no = 0; no < attempts; ++no) {
+        projection->randomize_layout(randomizer);
+        const acmacs::Layout starting{*projection->layout()};
+        std::array<double, methods.size()> stresses;
+        for (size_t method_no = 0; method_no < methods.size(); ++method_no) {
+            projection->set_layout(starting);
+            const auto status = projection->relax(optimization_options(methods[method_no], precision));
+            fmt::print("{:3d} {:16s} {:.8f} time: {} iters: {} nstress: {} {}\n", no, fmt::format("{}", methods[method_no]), status.final_stress, acmacs::format_duration(status.time),
+                       status.number_of_iterations, status.number_of_stress_calculations, status.termination_report);
+            stresses[method_no] = status.final_stress;
+            totals[method_no].stress += status.final_stress;
+            totals[method_no].time += status.time;
+            totals[method_no].iterations += status.number_of_iterations;
+            totals[method_no].stress_calculations += status.number_of_stress_calculations;
+        }
+        const double best_stress = *std::min_element(stresses.begin(), stresses.end());
+        for (size_t method_no = 0; method_no < methods.size(); ++method_no) {
+            if ((stresses[method_no] - best_stress) < 1e-6)
+                ++totals[method_no].best;
+        }
+    }
+
+    fmt::print("\nattempts: {} precision: {} dimensions: {}\n", attempts, precision, acmacs::to_string(num_dims));
+    for (size_t method_no = 0; method_no < methods.size(); ++method_no) {
+        const auto& total = totals[method_no];
+        const auto num = static_cast<double>(attempts);
+        fmt::print("{:16s} stress avg: {:.8f} time total: {} avg iters: {:.1f} avg nstress: {:.1f} best: {}\n", fmt::format("{}", methods[method_no]), total.stress / num,
+                   acmacs::format_duration(total.time), static_cast<double>(total.iterations) / num, static_cast<double>(total.stress_calculations) / num, total.best);
+    }
+
+} // compare_native
+
+// ----------------------------------------------------------------------
+
+void compare_pca(acmacs::chart::optimization_method method, acmacs::chart::ChartModify& chart, size_t attempts, std::string min_col_basis, acmacs::number_of_dimensions_t num_dims)
+{
+    using namespace acmacs::chart;
+    using clock = std::chrono::high_resolution_clock;
+    const number_of_dimensions_t start_num_dim{5};
+    std::chrono::microseconds total_relax{0}, total_alglib{0}, total_jacobi{0};
+    double total_stress_alglib{0}, total_stress_jacobi{0};
+
+    auto projection = chart.projections_modify().new_from_scratch(start_num_dim, min_col_basis);
+    auto randomizer = randomizer_plain_with_table_max_distance(*projection);
+    auto stress = stress_factory(*projection, multiply_antigen_titer_until_column_adjust::yes);
+    for (size_t no = 0; no < attempts; ++no) {
+        projection->randomize_layout(randomizer);
+        acmacs::Layout rough{*projection->layout()};
+        stress.change_number_of_dimensions(start_num_dim);
+        const auto rough_status = optimize(method, stress, rough.data(), rough.data() + rough.size(), optimization_precision::rough);
+        total_relax += rough_status.time;
+
+        const auto anneal_and_relax = [&](auto&& do_pca, std::chrono::microseconds& pca_time, double& stress_sum) {
+            acmacs::Layout layout{rough};
+            stress.change_number_of_dimensions(start_num_dim);
+            const auto start = clock::now();
+            do_pca(layout);
+            const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - start);
+            pca_time += elapsed;
+            layout.change_number_of_dimensions(num_dims);
+            stress.change_number_of_dimensions(num_dims);
+            const auto status = optimize(method, stress, layout.data(), layout.data() + layout.size(), optimization_precision::fine);
+            total_relax += status.time;
+            stress_sum += status.final_stress;
+            return std::pair{status.final_stress, elapsed};
+        };
+
+        const auto [alglib_stress, alglib_time] = anneal_and_relax(
+            [&stress, num_dims, start_num_dim](acmacs::Layout& layout) {
+                OptimiserCallbackData callback_data(stress);
+                alglib::pca(callback_data, start_num_dim, num_dims, layout.data(), layout.data() + layout.size());
+            },
+            total_alglib, total_stress_alglib);
+        const auto [jacobi_stress, jacobi_time] = anneal_and_relax(
+            [&stress, num_dims, start_num_dim](acmacs::Layout& layout) { pca_truncated(stress, start_num_dim, num_dims, layout.data(), layout.data() + layout.size()); }, total_jacobi,
+            total_stress_jacobi);
+        fmt::print("{:3d} rough: {:.8f} alglib: {:.8f} pca time: {}  jacobi: {:.8f} pca time: {}\n", no, rough_status.final_stress, alglib_stress, acmacs::format_duration(alglib_time), jacobi_stress,
+                   acmacs::format_duration(jacobi_time));
+    }
+
+    const auto num = static_cast<double>(attempts);
+    fmt::print("\nattempts: {} method: {} dimensions: 5 -> {}\n", attempts, method, acmacs::to_string(num_dims));
+    fmt::print("alglib pca total: {} stress avg: {:.8f}\n", acmacs::format_duration(total_alglib), total_stress_alglib / num);
+    fmt::print("jacobi pca total: {} stress avg: {:.8f}\n", acmacs::format_duration(total_jacobi), total_stress_jacobi / num);
+    fmt::print("optimization total (both pipelines): {}\n", acmacs::format_duration(total_relax));
+
+} // compare_pca
+
+// ----------------------------------------------------------------------
+
 void optimize_n(acmacs::chart::optimization_method method, acmacs::chart::ChartModify& chart, size_t attempts, std::string min_col_basis, acmacs::number_of_dimensions_t num_dims, acmacs::chart::optimization_precision precision)
 {
     for (size_t no = 0; no < attempts; ++no) {
@@ -29,13 +29,18 @@ struct Options : public argv
     // option<bool>   export_pre_grid{*this, "export-pre-grid", desc{"export chart before running grid test (to help debugging crashes)"}};
     option<bool>   no_dimension_annealing{*this, "no-dimension-annealing"};
     option<bool>   dimension_annealing{*this, "dimension-annealing"};
-    option<str>    method{*this, "method", dflt{"alglib-cg"}, desc{"method: alglib-lbfgs, alglib-cg, optim-bfgs, optim-differential-evolution"}};
+    option<str>    method{*this, "method", dflt{"alglib-cg"}, desc{"method: alglib-lbfgs, alglib-cg, native-lbfgs, native-cg"}};
     option<double> randomization_diameter_multiplier{*this, "md", dflt{2.0}, desc{"randomization diameter multiplier"}};
     option<bool>   remove_original_projections{*this, "remove-original-projections", desc{"remove projections found in the source chart"}};
     option<size_t> keep_projections{*this, "keep-projections", dflt{0UL}, desc{"number of projections to keep, 0 - keep all"}};
+    option<bool>   distinct{*this, "distinct", desc{"keep just distinct minima (by procrustes), report number of optimizations converged to each"}};
+    option<double> distinct_rms{*this, "distinct-rms", dflt{0.05}, desc{"procrustes rms threshold for --distinct"}};
     option<bool>   no_disconnect_having_few_titers{*this, "no-disconnect-having-few-titers"};
     option<str>    disconnect_antigens{*this, "disconnect-antigens", dflt{""}, desc{"comma or space separated list of antigen/point indexes (0-based) to disconnect for the new projections"}};
     option<str>    disconnect_sera{*this, "disconnect-sera", dflt{""}, desc{"comma or space separated list of serum indexes (0-based) to disconnect for the new projections"}};
+    option<str>    checkpoint{*this, "checkpoint", desc{"periodically write the best layouts (--keep-projections, default 100) and the run state to this file"}};
+    option<size_t> checkpoint_every{*this, "checkpoint-every", dflt{100UL}, desc{"write checkpoint after every N optimizations"}};
+    option<bool>   resume{*this, "resume", desc{"requires --checkpoint, continue interrupted run (or extend a finished one with bigger -n)"}};
     option<int>    threads{*this, "threads", dflt{0}, desc{"number of threads to use for optimization (omp): 0 - autodetect, 1 - sequential"}};
     option<str_array> verbose{*this, 'v', "verbose", desc{"comma separated list (or multiple switches) of enablers"}};
     option<unsigned> seed{*this, "seed", desc{"seed for randomization, -n 1 implied"}};
@@ -71,6 +76,10 @@ int main(int argc, char* const argv[])
         const auto dimension_annealing =
             acmacs::chart::use_dimension_annealing_from_bool(opt.dimension_annealing); // && method != acmacs::chart::optimization_method::optimlib_differential_evolution);
 
+        if (opt.resume && !opt.checkpoint.has_value())
+            throw std::runtime_error{"--resume requires --checkpoint"};
+
+        bool fine_done{false};
         if (opt.seed.has_value()) {
             // --- seeded optimization ---
             if (opt.number_of_optimizations != 1ul)
@@ -88,6 +97,34 @@ int main(int argc, char* const argv[])
                 chart.relax_incremental(incremental_source_projection_no, acmacs::chart::number_of_optimizations_t{*opt.number_of_optimizations}, options,
                                         opt.remove_original_projections ? acmacs::chart::remove_source_projection::yes : acmacs::chart::remove_source_projection::no,
                                         opt.unmovable_non_nan_points ? acmacs::chart::unmovable_non_nan_points::yes : acmacs::chart::unmovable_non_nan_points::no);
+            else if (opt.checkpoint.has_value()) {
+                acmacs::chart::RelaxCheckpoint checkpoint{*opt.checkpoint, opt.keep_projections > 0 ? *opt.keep_projections : 100UL, opt.checkpoint_every};
+                if (opt.resume)
+                    checkpoint.read();
+                chart.relax_checkpointed(acmacs::chart::number_of_optimizations_t{*opt.number_of_optimizations}, *opt.minimum_column_basis,
+                                         acmacs::number_of_dimensions_t{*opt.number_of_dimensions}, dimension_annealing, options, checkpoint, disconnected);
+            }
+            else if (opt.distinct) {
+                // with --fine, distinct minima found by rough optimizations are then relaxed finely below
+                acmacs::chart::RelaxDistinctMinima::parameters_t distinct_parameters;
+                distinct_parameters.rms_threshold = opt.distinct_rms;
+                const auto hits = chart.relax_distinct(acmacs::chart::number_of_optimizations_t{*opt.number_of_optimizations}, *opt.minimum_column_basis,
+                                                       acmacs::number_of_dimensions_t{*opt.number_of_dimensions}, dimension_annealing, options,
+                                                       distinct_parameters, disconnected);
+                fmt::print("distinct minima: {} (optimizations: {})\n", hits.size(), *opt.number_of_optimizations);
+                for (size_t m_no = 0; m_no < std::min(hits.size(), 10UL); ++m_no)
+                    fmt::print("  {:3d} hits: {}\n", m_no, hits[m_no]);
+                if (const auto singletons = static_cast<size_t>(std::count(hits.begin(), hits.end(), 1UL)); singletons > 0)
+                    fmt::print("  minima found just once: {} (landscape is undersampled if this number is high)\n", singletons);
+            }
+            else if (opt.fine > 0) {
+                // rough optimizations, then dimension annealing and fine optimization of just opt.fine best ones
+                auto fine_options{options};
+                fine_options.precision = acmacs::chart::optimization_precision::fine;
+                chart.relax_rough_fine(acmacs::chart::number_of_optimizations_t{*opt.number_of_optimizations}, opt.fine, *opt.minimum_column_basis,
+                                       acmacs::number_of_dimensions_t{*opt.number_of_dimensions}, dimension_annealing, fine_options, disconnected);
+                fine_done = true;
+            }
             else
                 chart.relax(acmacs::chart::number_of_optimizations_t{*opt.number_of_optimizations}, *opt.minimum_column_basis, acmacs::number_of_dimensions_t{*opt.number_of_dimensions},
                             dimension_annealing, options, disconnected);
@@ -99,8 +136,8 @@ int main(int argc, char* const argv[])
         }
 
         projections.sort();
-        for (size_t p_no = 0; p_no < opt.fine; ++p_no)
-            chart.projection_modify(p_no)->relax(acmacs::chart::optimization_options(method, acmacs::chart::optimization_precision::fine));
+        if (opt.fine > 0 && !fine_done)
+            chart.relax_best_finely(opt.fine, acmacs::chart::optimization_options(method, acmacs::chart::optimization_precision::fine));
         if (const size_t keep_projections = opt.keep_projections; keep_projections > 0 && projections.size() > keep_projections)
             projections.keep_just(keep_projections);
         fmt::print("{}\n", chart.make_info());
@@ -6,6 +6,7 @@
 #include "acmacs-base/string.hh"
 #include "acmacs-chart-2/factory-import.hh"
 #include "acmacs-chart-2/chart.hh"
+#include "acmacs-chart-2/chart-archive-index.hh"
 
 // ----------------------------------------------------------------------
 
@@ -15,6 +16,8 @@ struct Options : public argv
     Options(int a_argc, const char* const a_argv[], on_error on_err = on_error::exit) : argv() { parse(a_argc, a_argv, on_err); }
 
     option<bool> verbose{*this, 'v', "verbose"};
+    option<str> index{*this, "index", desc{"chart archive index file to look up sera in, created if absent, updated with the charts whose files were changed"}};
+    option<int> threads{*this, "threads", dflt{0}, desc{"number of threads to use for updating index (omp): 0 - autodetect, 1 - sequential"}};
 
     argument<str_array> charts{*this, arg_name{"chart"}, mandatory};
 };
@@ -27,13 +30,28 @@ int main(int argc, char* const argv[])
         Options opt(argc, argv);
         std::vector<std::string> table_dates;
         std::map<std::string, std::vector<std::string>> serum_to_tables;
-        for (const auto& filename : *opt.charts) {
-            auto chart = acmacs::chart::import_from_file(filename);
-            const auto table_date = chart->info()->date();
-            table_dates.emplace_back(table_date);
-            auto sera = chart->sera();
-            for (auto serum : *sera)
-                serum_to_tables.try_emplace(serum->name_full(), std::vector<std::string>{}).first->second.emplace_back(table_date);
+        if (opt.index) {
+            const std::vector<std::string_view> chart_file_names(opt.charts->begin(), opt.charts->end());
+            const auto index = acmacs::chart::chart_archive_index(opt.index, chart_file_names, opt.threads);
+            for (const auto& filename : chart_file_names) {
+                const auto chart_no = index.find_chart(filename);
+                if (!chart_no.has_value())
+                    throw std::runtime_error{fmt::format("{}: not in the index", filename)};
+                const auto& chart = index.chart(*chart_no);
+                table_dates.push_back(chart.table_date);
+                for (const auto serum_id : chart.sera)
+                    serum_to_tables.try_emplace(std::string{index.name(serum_id)}, std::vector<std::string>{}).first->second.push_back(chart.table_date);
+            }
+        }
+        else {
+            for (const auto& filename : *opt.charts) {
+                auto chart = acmacs::chart::import_from_file(filename);
+                const auto table_date = chart->info()->date();
+                table_dates.emplace_back(table_date);
+                auto sera = chart->sera();
+                for (auto serum : *sera)
+                    serum_to_tables.try_emplace(serum->name_full(), std::vector<std::string>{}).first->second.emplace_back(table_date);
+            }
         }
 
         fmt::print("Total sera: {}\nTables: {}\n\n", serum_to_tables.size(), table_dates.size());
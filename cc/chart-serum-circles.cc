@@ -125,10 +125,23 @@ std::vector<SerumData> collect(const acmacs::chart::Chart& chart, size_t serum_n
     if (serum_no != static_cast<size_t>(-1)) {
         collect1(serum_no, sera->at(serum_no));
     }
-    else {
+    else if (verbose == acmacs::verbose::yes) { // report calculation details for each circle
         for (auto [sr_no, serum] : acmacs::enumerate(*sera))
             collect1(sr_no, serum);
     }
+    else {
+        const auto circles = acmacs::chart::serum_circles(chart, projection_no, 2.0);
+        for (auto [sr_no, serum] : acmacs::enumerate(*sera)) {
+            auto& serum_data = result.emplace_back(sr_no, serum, chart.column_basis(sr_no));
+            for (auto [index, ag_no] : acmacs::enumerate(serum->homologous_antigens())) {
+                auto& antigen_data = serum_data.antigens.emplace_back(ag_no, (*antigens)[ag_no], titers->titer(ag_no, sr_no));
+                if (antigen_data.titer.is_regular()) {
+                    antigen_data.theoretical = circles[sr_no].theoretical[index];
+                    antigen_data.empirical = circles[sr_no].empirical[index];
+                }
+            }
+        }
+    }
     return result;
 
 } // collect
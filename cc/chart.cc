@@ -4,6 +4,7 @@
 #include "acmacs-base/enumerate.hh"
 #include "acmacs-base/range-v3.hh"
 #include "acmacs-base/counter.hh"
+#include "acmacs-base/omp.hh"
 #include "acmacs-virus/virus-name-v1.hh"
 #include "acmacs-whocc-data/labs.hh"
 #include "acmacs-chart-2/chart.hh"
@@ -116,10 +117,13 @@ std::string acmacs::chart::Chart::description() const
 std::shared_ptr<acmacs::chart::ColumnBases> acmacs::chart::Chart::computed_column_bases(acmacs::chart::MinimumColumnBasis aMinimumColumnBasis, use_cache a_use_cache) const
 {
     if (a_use_cache == use_cache::yes) {
+        std::lock_guard<std::mutex> guard{*computed_column_bases_access_};
         if (auto found = computed_column_bases_.find(aMinimumColumnBasis); found != computed_column_bases_.end())
             return found->second;
     }
-    return computed_column_bases_[aMinimumColumnBasis] = titers()->computed_column_bases(aMinimumColumnBasis);
+    auto computed = titers()->computed_column_bases(aMinimumColumnBasis); // compute outside of the lock
+    std::lock_guard<std::mutex> guard{*computed_column_bases_access_};
+    return computed_column_bases_[aMinimumColumnBasis] = computed;
 
 } // acmacs::chart::Chart::computed_column_bases
 
@@ -498,27 +502,38 @@ std::vector<acmacs::chart::Date> acmacs::chart::Antigens::all_dates(include_refe
 static const std::regex sAnntotationToIgnore{"(CONC|RDE@|BOOST|BLEED|LAIV|^CDC$)"};
 #include "acmacs-base/diagnostics-pop.hh"
 
-bool acmacs::chart::Annotations::match_antigen_serum(const acmacs::chart::Annotations& antigen, const acmacs::chart::Annotations& serum)
+namespace
 {
-    std::vector<std::string_view> antigen_fixed(antigen->size());
-    auto antigen_fixed_end = antigen_fixed.begin();
-    for (const auto& anno : antigen) {
-        *antigen_fixed_end++ = anno;
+    // sorted annotations compared by Annotations::match_antigen_serum(), ignored serum annotations are excluded
+    inline std::vector<std::string_view> annotations_to_match(const acmacs::chart::Annotations& annotations, bool serum)
+    {
+        std::vector<std::string_view> result;
+        result.reserve(annotations->size());
+        for (const auto& anno : annotations) {
+            const std::string_view annos = static_cast<std::string_view>(anno);
+            if (!serum || !std::regex_search(std::begin(annos), std::end(annos), sAnntotationToIgnore))
+                result.push_back(annos);
+        }
+        std::sort(result.begin(), result.end());
+        return result;
     }
-    antigen_fixed.erase(antigen_fixed_end, antigen_fixed.end());
-    std::sort(antigen_fixed.begin(), antigen_fixed.end());
-
-    std::vector<std::string_view> serum_fixed(serum->size());
-    auto serum_fixed_end = serum_fixed.begin();
-    for (const auto& anno : serum) {
-        const std::string_view annos = static_cast<std::string_view>(anno);
-        if (!std::regex_search(std::begin(annos), std::end(annos), sAnntotationToIgnore))
-            *serum_fixed_end++ = anno;
+
+    // antigen and serum having the same key are homologous if their passages match
+    inline std::string homologous_key(const acmacs::chart::detail::AntigenSerum& ag_sr, bool serum)
+    {
+        const auto annotations = ag_sr.annotations();
+        std::string key{*ag_sr.name()};
+        key.append(1, '\0').append(*ag_sr.reassortant());
+        for (const auto anno : annotations_to_match(annotations, serum))
+            key.append(1, '\0').append(anno);
+        return key;
     }
-    serum_fixed.erase(serum_fixed_end, serum_fixed.end());
-    std::sort(serum_fixed.begin(), serum_fixed.end());
 
-    return antigen_fixed == serum_fixed;
+} // namespace
+
+bool acmacs::chart::Annotations::match_antigen_serum(const acmacs::chart::Annotations& antigen, const acmacs::chart::Annotations& serum)
+{
+    return annotations_to_match(antigen, false) == annotations_to_match(serum, true);
 
 } // acmacs::chart::Annotations::match_antigen_serum
 
@@ -533,25 +548,27 @@ acmacs::chart::Sera::homologous_canditates_t acmacs::chart::Sera::find_homologou
             return antigen_passage.is_egg() == serum_passage.is_egg();
     };
 
-    std::map<std::string, std::vector<size_t>, std::less<>> antigen_name_index;
+    // antigens indexed by name, reassortant and annotations, each serum finds its candidates in O(1), passages are compared just for the candidates
+    std::unordered_map<std::string, std::vector<size_t>> antigen_index;
     for (auto [ag_no, antigen] : acmacs::enumerate(aAntigens))
-        antigen_name_index.emplace(antigen->name(), std::vector<size_t>{}).first->second.push_back(ag_no);
-
-    acmacs::chart::Sera::homologous_canditates_t result(size());
-    for (auto [sr_no, serum] : acmacs::enumerate(*this)) {
-        if (auto ags = antigen_name_index.find(*serum->name()); ags != antigen_name_index.end()) {
-            for (auto ag_no : ags->second) {
-                auto antigen = aAntigens[ag_no];
+        antigen_index[homologous_key(*antigen, false)].push_back(ag_no);
+
+    const auto number_of_sera = size();
+    acmacs::chart::Sera::homologous_canditates_t result(number_of_sera);
+    // debugging output is sequential
+#pragma omp parallel for default(none) shared(aAntigens, antigen_index, result, number_of_sera, match_passage, dbg) schedule(dynamic, 16) if(dbg == acmacs::debug::no)
+    for (size_t sr_no = 0; sr_no < number_of_sera; ++sr_no) {
+        const auto serum = operator[](sr_no);
+        if (const auto ags = antigen_index.find(homologous_key(*serum, true)); ags != antigen_index.end()) {
+            const auto serum_passage = serum->passage();
+            for (const auto ag_no : ags->second) {
+                const auto antigen_passage = aAntigens[ag_no]->passage();
+                const auto passage_match = match_passage(antigen_passage, serum_passage, *serum);
                 if (dbg == debug::yes)
-                    fmt::print(stderr, "DEBUG: SR {} {} R:{} A:{} P:{} -- AG {} {} R:{} A:{} P:{} -- A_match:{} R_match: {} P_match:{}\n",
-                               sr_no, *serum->name(), serum->annotations(), *serum->reassortant(), *serum->passage(),
-                               ag_no, *antigen->name(), antigen->annotations(), *antigen->reassortant(), *antigen->passage(),
-                               Annotations::match_antigen_serum(antigen->annotations(), serum->annotations()), antigen->reassortant() == serum->reassortant(),
-                               match_passage(antigen->passage(), serum->passage(), *serum));
-                if (Annotations::match_antigen_serum(antigen->annotations(), serum->annotations()) && antigen->reassortant() == serum->reassortant() &&
-                    match_passage(antigen->passage(), serum->passage(), *serum)) {
+                    fmt::print(stderr, "DEBUG: SR {} {} R:{} A:{} P:{} -- AG {} P:{} -- P_match:{}\n", sr_no, *serum->name(), *serum->reassortant(), serum->annotations(), *serum_passage, ag_no,
+                               *antigen_passage, passage_match);
+                if (passage_match)
                     result[sr_no].insert(ag_no);
-                }
             }
         }
     }
@@ -581,8 +598,8 @@ void acmacs::chart::Sera::set_homologous(find_homologous options, const Antigens
     const auto homologous_canditates = find_homologous_canditates(aAntigens, dbg);
 
     if (options == find_homologous::all) {
-        for (auto [sr_no, serum] : acmacs::enumerate(*this))
-            serum->set_homologous(*homologous_canditates[sr_no], dbg);
+        for (size_t sr_no = 0; sr_no < size(); ++sr_no)
+            to_modify(sr_no)->set_homologous(*homologous_canditates[sr_no], dbg);
     }
     else {
         std::vector<std::optional<size_t>> homologous(size()); // for each serum
@@ -625,9 +642,9 @@ void acmacs::chart::Sera::set_homologous(find_homologous options, const Antigens
             }
         }
 
-        for (auto [sr_no, serum] : acmacs::enumerate(*this))
+        for (size_t sr_no = 0; sr_no < size(); ++sr_no)
             if (const auto homol = homologous[sr_no]; homol)
-                serum->set_homologous({*homol}, dbg);
+                to_modify(sr_no)->set_homologous({*homol}, dbg);
     }
 
 } // acmacs::chart::Sera::set_homologous
@@ -1,8 +1,11 @@
 #pragma once
 
 #include <memory>
+#include <mutex>
+#include <atomic>
 #include <cmath>
 #include <optional>
+#include <unordered_map>
 #include <type_traits>
 
 #include "acmacs-base/timeit.hh"
@@ -296,18 +299,16 @@ namespace acmacs::chart
 
         void remove_points(const ReverseSortedIndexes& to_remove, size_t base_index = 0)
         {
-            for (const auto index : to_remove) {
-                const auto real_index = index + base_index;
-                remove(real_index);
-                // if (const auto found = std::find(begin(), end(), real_index); found != end())
-                //     erase(found);
-                std::for_each(begin(), end(), [real_index](size_t& point_no) {
-                    if (point_no > real_index)
-                        --point_no;
-                });
-            }
+            size_t number_of_points{0};
+            for (const auto point_no : *this)
+                number_of_points = std::max(number_of_points, point_no + 1);
+            for (const auto index : to_remove)
+                number_of_points = std::max(number_of_points, index + base_index + 1);
+            IndexCompaction(number_of_points, to_remove, base_index).renumber(*this);
         }
 
+        void remove_points(const IndexCompaction& compaction) { compaction.renumber(*this); }
+
     }; // class DrawingOrder
 
     // ----------------------------------------------------------------------
@@ -600,10 +601,11 @@ namespace acmacs::chart
 
             virtual std::optional<size_t> find_by_full_name(std::string_view aFullName) const
             {
-                if (const auto found = std::find_if(begin(), end(), [aFullName](const auto& antigen) -> bool { return antigen->name_full() == aFullName; }); found == end())
+                const auto index = name_index();
+                if (const auto found = index->full_name.find(aFullName); found == index->full_name.end())
                     return std::nullopt;
                 else
-                    return found.index();
+                    return found->second;
             }
 
             // if aName starts with ~, then search by regex in full name
@@ -612,18 +614,17 @@ namespace acmacs::chart
                 if (!aName.empty() && aName[0] == '~')
                     return find_by_name(std::regex{std::next(std::begin(aName), 1), std::end(aName), acmacs::regex::icase});
 
-                auto find = [this](auto name) {
-                    Indexes indexes;
-                    for (auto iter = begin(); iter != end(); ++iter) {
-                        if ((*iter)->name() == acmacs::virus::name_t{name})
-                            indexes.insert(iter.index());
-                    }
-                    return indexes;
+                const auto index = name_index();
+                auto find = [&index](const std::string& name) {
+                    if (const auto found = index->name.find(name); found != index->name.end())
+                        return found->second;
+                    else
+                        return Indexes{};
                 };
 
                 const auto name{::string::upper(aName)};
                 auto indexes = find(name);
-                if (indexes->empty() && name.size() > 2) {
+                if (indexes->empty() && name.size() > 2 && size() > 0) {
                     if (const auto first_name = (*begin())->name(); first_name.size() > 2) {
                         // handle names with "A/" instead of "A(HxNx)/" or without subtype prefix (for A and B)
                         if ((name[0] == 'A' && name[1] == '/' && first_name[0] == 'A' && first_name[1] == '(' && first_name.find(")/") != std::string::npos) || (name[0] == 'B' && name[1] == '/'))
@@ -638,10 +639,11 @@ namespace acmacs::chart
             // regex search in full name
             virtual Indexes find_by_name(const std::regex& re_name) const
             {
+                const auto index = name_index();
                 Indexes indexes;
-                for (auto iter = begin(); iter != end(); ++iter) {
-                    if (std::regex_search((*iter)->name_full(), re_name))
-                        indexes.insert(iter.index());
+                for (size_t no = 0; no < index->full_names.size(); ++no) {
+                    if (std::regex_search(index->full_names[no], re_name))
+                        indexes.insert(no);
                 }
                 return indexes;
             }
@@ -664,6 +666,46 @@ namespace acmacs::chart
             }
 
           protected:
+            // Index used by find_by_full_name() and find_by_name(), built on the first use.
+            // Derived classes changing the list of the entries must call invalidate_name_index(),
+            // entries changing their names set name_index_outdated() flag, index is rebuilt on the next use.
+            struct NameIndex
+            {
+                std::vector<std::string> full_names;                     // by entry index
+                std::unordered_map<std::string_view, size_t> full_name; // views into full_names, the first entry having the full name
+                std::unordered_map<std::string, Indexes> name;
+            };
+
+            std::shared_ptr<const NameIndex> name_index() const
+            {
+                std::lock_guard<std::mutex> lock{name_index_access_};
+                if (name_index_outdated_->exchange(false) || !name_index_) {
+                    auto index = std::make_shared<NameIndex>();
+                    index->full_names.reserve(size());
+                    for (size_t no = 0; no < size(); ++no) {
+                        const auto ag_sr = at(no);
+                        index->full_names.push_back(ag_sr->name_full());
+                        index->name[*ag_sr->name()].insert(no);
+                    }
+                    for (size_t no = 0; no < index->full_names.size(); ++no)
+                        index->full_name.emplace(index->full_names[no], no); // does not replace, the first one is kept
+                    name_index_ = std::move(index);
+                }
+                return name_index_;
+            }
+
+            void invalidate_name_index()
+            {
+                std::lock_guard<std::mutex> lock{name_index_access_};
+                name_index_.reset();
+            }
+
+            const std::shared_ptr<std::atomic<bool>>& name_index_outdated() const { return name_index_outdated_; }
+
+            // entry to be changed through its const interface (e.g. Serum::set_homologous()),
+            // derived classes sharing entries with other collections return an unshared one
+            virtual std::shared_ptr<AgSr> to_modify(size_t aIndex) { return operator[](aIndex); }
+
             template <typename F> Indexes make_indexes(F&& test, std::shared_ptr<Titers> titers = nullptr) const
             {
                 const auto call = [&](size_t no, const std::shared_ptr<AgSr>& ptr) -> bool {
@@ -699,6 +741,11 @@ namespace acmacs::chart
                 }
                 return result;
             }
+
+          private:
+            mutable std::mutex name_index_access_;
+            mutable std::shared_ptr<const NameIndex> name_index_;
+            const std::shared_ptr<std::atomic<bool>> name_index_outdated_{std::make_shared<std::atomic<bool>>(false)};
         };
 
     } // namespace detail
@@ -968,6 +1015,7 @@ namespace acmacs::chart
 
       private:
         mutable std::map<MinimumColumnBasis, std::shared_ptr<ColumnBases>> computed_column_bases_; // cache, computing might be slow for big charts
+        std::unique_ptr<std::mutex> computed_column_bases_access_{std::make_unique<std::mutex>()}; // stress_factory() is called from parallel relax, cache access must be serialized (unique_ptr to keep Chart movable)
 
     }; // class Chart
 
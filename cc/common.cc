@@ -1,3 +1,5 @@
+#include <tuple>
+
 #include "acmacs-base/string.hh"
 #include "acmacs-base/range-v3.hh"
 #include "acmacs-chart-2/log.hh"
@@ -35,6 +37,47 @@ template <> struct fmt::formatter<score_t> : fmt::formatter<acmacs::fmt_helper::
 
 // ----------------------------------------------------------------------
 
+namespace
+{
+    // Interning table: after rank(), equal strings have equal ids and ids are ordered the same way as strings.
+    // Stored string_views must outlive the table.
+    class StringRanks
+    {
+      public:
+        void add(std::string_view str) { strings_.push_back(str); }
+
+        void rank()
+        {
+            std::sort(strings_.begin(), strings_.end());
+            strings_.erase(std::unique(strings_.begin(), strings_.end()), strings_.end());
+        }
+
+        uint32_t operator[](std::string_view str) const { return static_cast<uint32_t>(std::lower_bound(strings_.begin(), strings_.end(), str) - strings_.begin()); }
+
+      private:
+        std::vector<std::string_view> strings_;
+    };
+
+    inline std::string_view passage_serum_id(const common::AntigenEntry& entry) { return *entry.passage; }
+    inline std::string_view passage_serum_id(const common::SerumEntry& entry) { return *entry.serum_id; }
+
+    // the same order as CoreEntry::less, used by std::equal_range
+    inline bool less_by_keys(const common::CoreEntry& lhs, const common::CoreEntry& rhs)
+    {
+        return std::tie(lhs.keys.name, lhs.keys.reassortant, lhs.keys.annotations) < std::tie(rhs.keys.name, rhs.keys.reassortant, rhs.keys.annotations);
+    }
+
+    // the same order as AntigenEntry::operator< and SerumEntry::operator<, used to sort primary entries
+    inline bool less_by_all_keys(const common::CoreEntry& lhs, const common::CoreEntry& rhs)
+    {
+        return std::tie(lhs.keys.name, lhs.keys.reassortant, lhs.keys.annotations, lhs.keys.passage_serum_id) <
+               std::tie(rhs.keys.name, rhs.keys.reassortant, rhs.keys.annotations, rhs.keys.passage_serum_id);
+    }
+
+} // namespace
+
+// ----------------------------------------------------------------------
+
 class CommonAntigensSera::Impl
 {
  public:
@@ -99,6 +142,7 @@ class CommonAntigensSera::Impl
                 }
             }
 
+        void intern_and_sort();
         void match(match_level_t match_level);
         score_t match(const AgSrEntry& primary, const AgSrEntry& secondary, match_level_t match_level) const;
         score_t match_not_ignored(const AgSrEntry& primary, const AgSrEntry& secondary) const;
@@ -123,8 +167,8 @@ template <> CommonAntigensSera::Impl::ChartData<common::AntigenEntry>::ChartData
       min_number_{std::min(primary_.size(), secondary_.size())}
 {
     make(primary_, *primary.antigens());
-    std::sort(primary_.begin(), primary_.end());
     make(secondary_, *secondary.antigens());
+    intern_and_sort();
     match(match_level);
 
 } // CommonAntigensSera::Impl::ChartData<CommonAntigensSera::Impl::AntigenEntry>::ChartData
@@ -137,8 +181,8 @@ template <> template <> CommonAntigensSera::Impl::ChartData<common::AntigenEntry
       min_number_{std::min(primary_.size(), secondary_.size())}
 {
     make(primary_, selector, *primary.antigens());
-    std::sort(primary_.begin(), primary_.end());
     make(secondary_, selector, *secondary.antigens());
+    intern_and_sort();
     match(match_level);
 
 } // CommonAntigensSera::Impl::ChartData<CommonAntigensSera::Impl::AntigenEntry>::ChartData
@@ -148,8 +192,7 @@ template <> template <> CommonAntigensSera::Impl::ChartData<common::AntigenEntry
 template <> CommonAntigensSera::Impl::ChartData<common::AntigenEntry>::ChartData(const acmacs::chart::Chart& primary)
     : primary_(primary.number_of_antigens()), secondary_(primary.number_of_antigens()), match_(primary.number_of_antigens()), primary_base_{0}, secondary_base_{0}
 {
-    make(primary_, *primary.antigens());
-    std::sort(primary_.begin(), primary_.end());
+    make(primary_, *primary.antigens()); // not matched, primary_ is not sorted
     make(secondary_, *primary.antigens());
     for (const auto antigen_no : range_from_0_to(match_.size())) {
         match_[antigen_no].primary_index = match_[antigen_no].secondary_index = antigen_no;
@@ -168,8 +211,8 @@ template <> CommonAntigensSera::Impl::ChartData<common::SerumEntry>::ChartData(c
       min_number_{std::min(primary_.size(), secondary_.size())}
 {
     make(primary_, *primary.sera());
-    std::sort(primary_.begin(), primary_.end());
     make(secondary_, *secondary.sera());
+    intern_and_sort();
     match(match_level);
 
 } // CommonAntigensSera::Impl::ChartData<CommonAntigensSera::Impl::SerumEntry>::ChartData
@@ -182,8 +225,8 @@ template <> template <> CommonAntigensSera::Impl::ChartData<common::SerumEntry>:
       min_number_{std::min(primary_.size(), secondary_.size())}
 {
     make(primary_, selector, *primary.sera());
-    std::sort(primary_.begin(), primary_.end());
     make(secondary_, selector, *secondary.sera());
+    intern_and_sort();
     match(match_level);
 
 } // CommonAntigensSera::Impl::ChartData<CommonAntigensSera::Impl::SerumEntry>::ChartData
@@ -194,8 +237,7 @@ template <> CommonAntigensSera::Impl::ChartData<common::SerumEntry>::ChartData(c
     : primary_(primary.number_of_sera()), secondary_(primary.number_of_sera()),
       match_(primary.number_of_sera()), primary_base_{primary.number_of_antigens()}, secondary_base_{primary.number_of_antigens()}
 {
-    make(primary_, *primary.sera());
-    std::sort(primary_.begin(), primary_.end());
+    make(primary_, *primary.sera()); // not matched, primary_ is not sorted
     make(secondary_, *primary.sera());
     for (const auto serum_no : range_from_0_to(match_.size())) {
         match_[serum_no].primary_index = match_[serum_no].secondary_index = serum_no;
@@ -208,13 +250,50 @@ template <> CommonAntigensSera::Impl::ChartData<common::SerumEntry>::ChartData(c
 
 // ----------------------------------------------------------------------
 
+template <typename AgSrEntry> void CommonAntigensSera::Impl::ChartData<AgSrEntry>::intern_and_sort()
+{
+    // annotations are compared by their formatted representation (see CoreEntry::compare)
+    std::vector<std::string> annotations(primary_.size() + secondary_.size());
+    StringRanks name_ranks, reassortant_ranks, annotations_ranks, passage_serum_id_ranks;
+    size_t entry_no{0};
+    for (auto* entries : {&primary_, &secondary_}) {
+        for (const auto& entry : *entries) {
+            name_ranks.add(*entry.name);
+            reassortant_ranks.add(*entry.reassortant);
+            annotations[entry_no] = fmt::format("{: }", entry.annotations);
+            annotations_ranks.add(annotations[entry_no]);
+            passage_serum_id_ranks.add(passage_serum_id(entry));
+            ++entry_no;
+        }
+    }
+    for (auto* ranks : {&name_ranks, &reassortant_ranks, &annotations_ranks, &passage_serum_id_ranks})
+        ranks->rank();
+
+    entry_no = 0;
+    for (auto* entries : {&primary_, &secondary_}) {
+        for (auto& entry : *entries) {
+            entry.keys.name = name_ranks[*entry.name];
+            entry.keys.reassortant = reassortant_ranks[*entry.reassortant];
+            entry.keys.annotations = annotations_ranks[annotations[entry_no]];
+            entry.keys.passage_serum_id = passage_serum_id_ranks[passage_serum_id(entry)];
+            ++entry_no;
+        }
+    }
+    std::sort(primary_.begin(), primary_.end(), less_by_all_keys);
+
+} // CommonAntigensSera::Impl::ChartData::intern_and_sort
+
+// ----------------------------------------------------------------------
+
 template <typename AgSrEntry> void CommonAntigensSera::Impl::ChartData<AgSrEntry>::match(CommonAntigensSera::match_level_t match_level)
 {
+    const auto log_enabled = acmacs::log::is_enabled(acmacs::log::common);
     for (const auto& secondary: secondary_) {
-        const auto [first, last] = std::equal_range(primary_.begin(), primary_.end(), secondary, AgSrEntry::less);
+        const auto [first, last] = std::equal_range(primary_.begin(), primary_.end(), secondary, less_by_keys);
         for (auto p_e = first; p_e != last; ++p_e) {
             if (const auto score = match(*p_e, secondary, match_level); score != score_t::no_match) {
-                AD_LOG(acmacs::log::common, "{} {:25s} -- \"{}\" <> \"{}\"", p_e->ag_sr(), fmt::format("{}", score), p_e->full_name(), secondary.full_name());
+                if (log_enabled) // full names are formatted only when logging
+                    AD_LOG(acmacs::log::common, "{} {:25s} -- \"{}\" <> \"{}\"", p_e->ag_sr(), fmt::format("{}", score), p_e->full_name(), secondary.full_name());
                 // match_.emplace_back(p_e->index, secondary.index, score);
                 match_.push_back({p_e->index, secondary.index, score});
             }
@@ -290,8 +369,8 @@ score_t CommonAntigensSera::Impl::ChartData<AgSrEntry>::match(const AgSrEntry& p
             return report;
     };
 
-    const auto name_neq = match_report(primary.name == secondary.name, "name"), reassortant_neq = match_report(primary.reassortant == secondary.reassortant, "reassortant"),
-               annotations_neq = match_report(primary.annotations == secondary.annotations, "annotations"), primary_distict = match_report(!primary.annotations.distinct(), "primary-distinct"),
+    const auto name_neq = match_report(primary.keys.name == secondary.keys.name, "name"), reassortant_neq = match_report(primary.keys.reassortant == secondary.keys.reassortant, "reassortant"),
+               annotations_neq = match_report(primary.keys.annotations == secondary.keys.annotations, "annotations"), primary_distict = match_report(!primary.annotations.distinct(), "primary-distinct"),
                secondary_distict = match_report(!secondary.annotations.distinct(), "secondary-distinct");
 
     if (name_neq.empty() && reassortant_neq.empty() && annotations_neq.empty() && primary_distict.empty() && secondary_distict.empty()) {
@@ -306,10 +385,12 @@ score_t CommonAntigensSera::Impl::ChartData<AgSrEntry>::match(const AgSrEntry& p
         }
     }
 
-    AD_LOG(acmacs::log::common, "{} \"{} {} {}\" != \"{} {} {}\": {} {} {} {} {}", primary.ag_sr(), //
-           primary.name, primary.reassortant, primary.annotations,                                  //
-           secondary.name, secondary.reassortant, secondary.annotations,                            //
-           name_neq, reassortant_neq, annotations_neq, primary_distict, secondary_distict);
+    if (acmacs::log::is_enabled(acmacs::log::common)) {
+        AD_LOG(acmacs::log::common, "{} \"{} {} {}\" != \"{} {} {}\": {} {} {} {} {}", primary.ag_sr(), //
+               primary.name, primary.reassortant, primary.annotations,                                  //
+               secondary.name, secondary.reassortant, secondary.annotations,                            //
+               name_neq, reassortant_neq, annotations_neq, primary_distict, secondary_distict);
+    }
     return score_t::no_match;
 
 } // CommonAntigensSera::Impl::ChartData::match
@@ -320,10 +401,10 @@ template <> score_t CommonAntigensSera::Impl::ChartData<common::AntigenEntry>::m
 {
     auto result = score_t::passage_serum_id_ignored;
     if (primary.passage.empty() || secondary.passage.empty()) {
-        if (primary.passage == secondary.passage && !primary.reassortant.empty() && !secondary.reassortant.empty()) // reassortant assumes egg passage
+        if (primary.keys.passage_serum_id == secondary.keys.passage_serum_id && !primary.reassortant.empty() && !secondary.reassortant.empty()) // reassortant assumes egg passage
             result = score_t::egg;
     }
-    else if (primary.passage == secondary.passage)
+    else if (primary.keys.passage_serum_id == secondary.keys.passage_serum_id)
         result = score_t::full_match;
     else if (primary.passage.without_date() == secondary.passage.without_date())
         result = score_t::without_date;
@@ -338,7 +419,7 @@ template <> score_t CommonAntigensSera::Impl::ChartData<common::AntigenEntry>::m
 template <> score_t CommonAntigensSera::Impl::ChartData<common::SerumEntry>::match_not_ignored(const common::SerumEntry& primary, const common::SerumEntry& secondary) const
 {
     auto result = score_t::passage_serum_id_ignored;
-    if (primary.serum_id == secondary.serum_id && !primary.serum_id.empty())
+    if (primary.keys.passage_serum_id == secondary.keys.passage_serum_id && !primary.serum_id.empty())
         result = score_t::full_match;
     else if (!primary.passage.empty() && !secondary.passage.empty() && primary.passage.is_egg() == secondary.passage.is_egg())
         result = score_t::egg;
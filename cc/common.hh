@@ -33,6 +33,17 @@ namespace acmacs::chart
             Annotations annotations;
             std::string orig_full_name_;
 
+            // set by CommonAntigensSera: ranks of the strings among entries of both charts being matched,
+            // equal strings have equal keys, keys are ordered the same way as strings
+            struct keys_t
+            {
+                uint32_t name{0};
+                uint32_t reassortant{0};
+                uint32_t annotations{0};
+                uint32_t passage_serum_id{0}; // passage for antigens, serum_id for sera
+            };
+            keys_t keys;
+
             void make_orig()    // to report if fields were updated by antigen_selector_t or serum_selector_t (in acmacs-py)
             {
                 if (orig_full_name_.empty())
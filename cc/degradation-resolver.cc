@@ -0,0 +1,128 @@
+#include <queue>
+
+#include "acmacs-base/log.hh"
+#include "acmacs-base/omp.hh"
+#include "acmacs-base/timeit.hh"
+#include "acmacs-chart-2/degradation-resolver.hh"
+#include "acmacs-chart-2/chart-modify.hh"
+#include "acmacs-chart-2/log.hh"
+#include "acmacs-chart-2/serum-line.hh"
+#include "acmacs-chart-2/randomizer.hh"
+#include "acmacs-chart-2/procrustes.hh"
+#include "acmacs-chart-2/optimize.hh"
+#include "acmacs-chart-2/stress.hh"
+
+// ----------------------------------------------------------------------
+
+namespace
+{
+    struct SplitData
+    {
+        SplitData(const acmacs::Layout& layout, size_t number_of_antigens) : serum_line(layout, number_of_antigens)
+        {
+            auto antigens_relative_to_line = serum_line.antigens_relative_to_line(layout, number_of_antigens);
+            if (antigens_relative_to_line.negative->size() < antigens_relative_to_line.positive->size()) {
+                good_side = acmacs::LineSide::side::positive;
+                on_the_wrong_side = std::move(antigens_relative_to_line.negative);
+            }
+            else {
+                good_side = acmacs::LineSide::side::negative;
+                on_the_wrong_side = std::move(antigens_relative_to_line.positive);
+            }
+        }
+
+        acmacs::chart::SerumLine serum_line;
+        acmacs::LineSide::side good_side;
+        acmacs::chart::PointIndexList on_the_wrong_side;
+    };
+
+    struct Node
+    {
+        std::shared_ptr<const acmacs::Layout> layout;
+        double stress;
+        size_t on_the_wrong_side;
+        size_t level;
+        std::string path;
+        double rms_to_parent{0.0};
+    };
+
+    // fewer antigens on the wrong side first, then lower stress
+    inline bool better(const Node& n1, const Node& n2) { return n1.on_the_wrong_side < n2.on_the_wrong_side || (n1.on_the_wrong_side == n2.on_the_wrong_side && n1.stress < n2.stress); }
+
+} // namespace
+
+// ----------------------------------------------------------------------
+
+acmacs::chart::DegradationResolverResult acmacs::chart::resolve_degradation(const ProjectionModify& projection, const DegradationResolverParameters& parameters, const optimization_options& options)
+{
+    const auto number_of_antigens = projection.chart().number_of_antigens();
+    const auto original_layout = std::make_shared<const acmacs::Layout>(*projection.layout());
+    if (const SerumLine serum_line(*original_layout, number_of_antigens); serum_line.standard_deviation() > parameters.serum_line_sd_threshold)
+        throw std::runtime_error{AD_FORMAT("serum line sd {} > {}", serum_line.standard_deviation(), parameters.serum_line_sd_threshold)};
+
+    const auto start = acmacs::timestamp();
+    const auto stress = stress_factory(projection, options.mult); // shared by all threads
+    std::vector<CommonAntigensSera::common_t> all_points;
+    for (size_t point_no = 0; point_no < original_layout->number_of_points(); ++point_no)
+        all_points.emplace_back(point_no, point_no);
+    std::mt19937 seed_generator{std::random_device{}()};
+    const int num_threads = options.num_threads <= 0 ? omp_get_max_threads() : options.num_threads;
+    const size_t number_of_attempts = parameters.number_of_attempts;
+
+    const auto best_on_top = [](const Node& n1, const Node& n2) { return better(n2, n1); };
+    std::priority_queue<Node, std::vector<Node>, decltype(best_on_top)> to_expand(best_on_top);
+    to_expand.push(Node{original_layout, projection.stress(), SplitData(*original_layout, number_of_antigens).on_the_wrong_side->size(), 0, {}});
+    std::optional<Node> best;
+    size_t number_of_relaxations{0};
+
+    for (size_t expansion = 0; expansion < parameters.max_expansions && !to_expand.empty(); ++expansion) {
+        const auto parent = to_expand.top();
+        to_expand.pop();
+        const SplitData split_data(*parent.layout, number_of_antigens);
+        const acmacs::LineSide line_side{split_data.serum_line.line(), split_data.good_side};
+        const auto diameter = layout_area_diameter(*parent.layout); // the same area as used by randomizer_border_with_current_layout_area()
+        // seeds are generated sequentially, each attempt has its own randomizer
+        std::vector<std::uint_fast32_t> seeds(number_of_attempts);
+        std::generate(seeds.begin(), seeds.end(), [&seed_generator]() { return seed_generator(); });
+
+        std::vector<std::optional<Node>> children(number_of_attempts);
+#pragma omp parallel for default(none) shared(parent, split_data, line_side, diameter, seeds, children, stress, options, all_points, number_of_antigens, number_of_attempts) num_threads(num_threads) schedule(dynamic)
+        for (size_t attempt = 0; attempt < number_of_attempts; ++attempt) {
+            LayoutRandomizerWithLineBorder randomizer{diameter, line_side, seeds[attempt]};
+            auto layout = std::make_shared<acmacs::Layout>(*parent.layout);
+            for (auto point_no : split_data.on_the_wrong_side)
+                layout->update(point_no, randomizer.get(layout->number_of_dimensions()));
+            const auto status = optimize(options.method, stress, layout->data(), layout->data() + layout->size(), optimization_precision::rough);
+            children[attempt].emplace(Node{layout, status.final_stress, SplitData(*layout, number_of_antigens).on_the_wrong_side->size(), parent.level + 1,
+                                           parent.path + (parent.path.empty() ? "" : "-") + std::to_string(attempt + 1), procrustes_rms(*parent.layout, *layout, all_points, procrustes_scaling_t::no)});
+        }
+        number_of_relaxations += number_of_attempts;
+
+        for (auto& child : children) {
+            AD_LOG(acmacs::log::relax, "resolver {} wrong-side: {} stress: {:.4f} rms: {:.4f}", child->path, child->on_the_wrong_side, child->stress, child->rms_to_parent);
+            if (std::isnan(child->stress))
+                continue;
+            if (!best || better(*child, *best))
+                best = *child;
+            // children having more antigens on the wrong side than the current best are not expanded
+            if (child->rms_to_parent > parameters.rms_threshold && child->level < parameters.max_levels && child->on_the_wrong_side <= best->on_the_wrong_side)
+                to_expand.push(std::move(*child));
+        }
+    }
+
+    if (!best)
+        throw std::runtime_error{"degradation resolver: no layout found"};
+
+    DegradationResolverResult result{.layout = *best->layout, .stress = 0.0, .on_the_wrong_side = 0, .path = best->path, .number_of_relaxations = number_of_relaxations};
+    result.stress = optimize(options.method, stress, result.layout.data(), result.layout.data() + result.layout.size(), optimization_precision::fine).final_stress;
+    result.on_the_wrong_side = SplitData(result.layout, number_of_antigens).on_the_wrong_side->size();
+    AD_LOG(acmacs::log::relax, "resolver: {} relaxations, best {} wrong-side: {} stress: {:.4f}, time: {:.1f}s", number_of_relaxations, result.path, result.on_the_wrong_side, result.stress,
+           acmacs::elapsed_seconds(start));
+    return result;
+
+} // acmacs::chart::resolve_degradation
+
+// ----------------------------------------------------------------------
+/// Local Variables:
+/// eval: (if (fboundp 'eu-rename-buffer) (eu-rename-buffer))
+/// End:
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+
+#include "acmacs-base/layout.hh"
+#include "acmacs-chart-2/optimize-options.hh"
+
+// ----------------------------------------------------------------------
+
+namespace acmacs::chart
+{
+    class ProjectionModify;
+
+    // Resolves degraded (folded) 2D maps where some antigens were found on the wrong side of
+    // the serum line: coordinates of these antigens are randomized on the good side and the
+    // layout is relaxed. Nodes of the search are layouts, each node is expanded by
+    // number_of_attempts parallel randomizations, children moved by more than rms_threshold
+    // (procrustes to the parent) are expanded further, the best node (fewer antigens on the wrong side,
+    // then lower stress) first. max_expansions == 1 is just a parallel random search from the original layout.
+    struct DegradationResolverParameters
+    {
+        size_t number_of_attempts{1};          // randomizations per expanded node
+        double serum_line_sd_threshold{0.4};   // do not run resolver if serum line sd is higher
+        double rms_threshold{0.1};             // expand child if procrustes rms between it and its parent is bigger
+        size_t max_levels{20};                 // depth limit of the search
+        size_t max_expansions{1};              // number of nodes to expand
+    };
+
+    struct DegradationResolverResult
+    {
+        acmacs::Layout layout;
+        double stress;
+        size_t on_the_wrong_side; // number of antigens on the wrong side of the serum line
+        std::string path;         // attempt numbers from the original layout, e.g. "3-1-7"
+        size_t number_of_relaxations;
+    };
+
+    // Returns the best found layout finely relaxed, it is not oriented and not attached to the chart.
+    // Throws if serum line sd of the projection is bigger than serum_line_sd_threshold.
+    DegradationResolverResult resolve_degradation(const ProjectionModify& projection, const DegradationResolverParameters& parameters, const optimization_options& options);
+
+} // namespace acmacs::chart
+
+// ----------------------------------------------------------------------
+/// Local Variables:
+/// eval: (if (fboundp 'eu-rename-buffer) (eu-rename-buffer))
+/// End:
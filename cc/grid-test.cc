@@ -7,6 +7,7 @@
 #include "acmacs-base/range-v3.hh"
 #include "acmacs-base/read-file.hh"
 #include "acmacs-base/data-formatter.hh"
+#include "acmacs-base/sigmoid.hh"
 #include "acmacs-chart-2/grid-test.hh"
 #include "acmacs-chart-2/name-format.hh"
 #include "acmacs-chart-2/log.hh"
@@ -34,27 +35,122 @@ std::string acmacs::chart::GridTest::point_name(size_t point_no) const
 
 // ----------------------------------------------------------------------
 
-acmacs::Area acmacs::chart::GridTest::area_for(const Stress::TableDistancesForPoint& table_distances_for_point) const
+// Contribution of a point to the stress when the point is placed at the nodes of a grid and
+// the other points stay at their original positions. Coordinates of the points having table
+// distances to the tested one are hoisted into per dimension arrays, the grid is processed
+// row by row along the first dimension and the innermost loop (row nodes for one neighbour)
+// is vectorizable.
+
+namespace
 {
-    size_t another_point;
-    if (!table_distances_for_point.regular.empty())
-        another_point = table_distances_for_point.regular.front().another_point;
-    else if (!table_distances_for_point.less_than.empty())
-        another_point = table_distances_for_point.less_than.front().another_point;
-    else
-        throw std::runtime_error("acmacs::chart::GridTest::area_for: table_distances_for_point has neither regulr nor less_than entries");
-    acmacs::Area result(original_layout_.at(another_point));
-    auto extend = [&result,this](const auto& entry) {
-        const auto coord = this->original_layout_.at(entry.another_point);
-        const auto radius = entry.distance; // + 1;
-        result.extend(coord - radius);
-        result.extend(coord + radius);
-    };
-    std::for_each(table_distances_for_point.regular.begin(), table_distances_for_point.regular.end(), extend);
-    std::for_each(table_distances_for_point.less_than.begin(), table_distances_for_point.less_than.end(), extend);
-    return result;
+    class ContributionGrid
+    {
+      public:
+        ContributionGrid(const acmacs::chart::Stress::TableDistancesForPoint& table_distances_for_point, const acmacs::Layout& layout)
+            : number_of_dimensions_{*layout.number_of_dimensions()}, regular_{number_of_dimensions_, table_distances_for_point.regular, layout},
+              less_than_{number_of_dimensions_, table_distances_for_point.less_than, layout}
+        {
+        }
+
+        // area containing all neighbours extended by the corresponding table distances
+        void area(std::vector<double>& min, std::vector<double>& max) const
+        {
+            min.assign(number_of_dimensions_, std::numeric_limits<double>::max());
+            max.assign(number_of_dimensions_, std::numeric_limits<double>::lowest());
+            for (const auto* neighbours : {&regular_, &less_than_}) {
+                for (size_t nb = 0; nb < neighbours->distance.size(); ++nb) {
+                    for (size_t dim = 0; dim < number_of_dimensions_; ++dim) {
+                        min[dim] = std::min(min[dim], neighbours->coordinates[dim][nb] - neighbours->distance[nb]);
+                        max[dim] = std::max(max[dim], neighbours->coordinates[dim][nb] + neighbours->distance[nb]);
+                    }
+                }
+            }
+        }
+
+        // calls visitor(const double* node, double contribution) for every node of the grid with the given step in [min, max]
+        template <typename Visitor> void scan(const std::vector<double>& min, const std::vector<double>& max, double step, Visitor&& visitor) const
+        {
+            std::vector<size_t> nodes(number_of_dimensions_); // number of nodes in each dimension
+            for (size_t dim = 0; dim < number_of_dimensions_; ++dim) {
+                if (!(max[dim] >= min[dim]))
+                    return;
+                nodes[dim] = static_cast<size_t>(std::floor((max[dim] - min[dim]) / step)) + 1;
+            }
+            const size_t row_size = nodes[0];
+            std::vector<double> row_x(row_size), row_contribution(row_size), node(number_of_dimensions_);
+            for (size_t node_no = 0; node_no < row_size; ++node_no)
+                row_x[node_no] = min[0] + static_cast<double>(node_no) * step;
+
+            std::vector<size_t> outer(number_of_dimensions_, 0); // index of the row node in dimensions 1..
+            for (;;) {
+                for (size_t dim = 1; dim < number_of_dimensions_; ++dim)
+                    node[dim] = min[dim] + static_cast<double>(outer[dim]) * step;
+                std::fill(row_contribution.begin(), row_contribution.end(), 0.0);
+                accumulate(regular_, node, row_x, row_contribution, [](double diff) { return diff * diff; });
+                accumulate(less_than_, node, row_x, row_contribution, [](double diff) {
+                    diff += 1.0;
+                    return diff * diff * acmacs::sigmoid(diff * acmacs::chart::SigmoidMutiplier());
+                });
+                for (size_t node_no = 0; node_no < row_size; ++node_no) {
+                    node[0] = row_x[node_no];
+                    visitor(node.data(), row_contribution[node_no]);
+                }
+
+                size_t dim = 1;
+                for (; dim < number_of_dimensions_; ++dim) {
+                    if (++outer[dim] < nodes[dim])
+                        break;
+                    outer[dim] = 0;
+                }
+                if (dim >= number_of_dimensions_)
+                    break;
+            }
+        }
+
+      private:
+        struct neighbours_t
+        {
+            neighbours_t(size_t number_of_dimensions, const acmacs::chart::TableDistances::entries_for_point_t& entries, const acmacs::Layout& layout)
+                : coordinates(number_of_dimensions, std::vector<double>(entries.size())), distance(entries.size())
+            {
+                for (size_t nb = 0; nb < entries.size(); ++nb) {
+                    distance[nb] = entries[nb].distance;
+                    for (size_t dim = 0; dim < number_of_dimensions; ++dim)
+                        coordinates[dim][nb] = layout.data()[entries[nb].another_point * number_of_dimensions + dim];
+                }
+            }
+
+            std::vector<std::vector<double>> coordinates; // [dim][neighbour]
+            std::vector<double> distance;                 // table distance
+        };
+
+        const size_t number_of_dimensions_;
+        const neighbours_t regular_, less_than_;
+
+        // diff_contribution(table_distance - map_distance) -> contribution
+        template <typename DiffContribution>
+        void accumulate(const neighbours_t& neighbours, const std::vector<double>& node, const std::vector<double>& row_x, std::vector<double>& row_contribution, DiffContribution diff_contribution) const
+        {
+            const size_t row_size = row_x.size();
+            const double* xs = row_x.data();
+            double* contribution = row_contribution.data();
+            for (size_t nb = 0; nb < neighbours.distance.size(); ++nb) {
+                double offset2{0.0}; // squared distance in dimensions 1.., the same for the whole row
+                for (size_t dim = 1; dim < number_of_dimensions_; ++dim) {
+                    const auto diff = node[dim] - neighbours.coordinates[dim][nb];
+                    offset2 += diff * diff;
+                }
+                const double x0 = neighbours.coordinates[0][nb], table_distance = neighbours.distance[nb];
+                for (size_t node_no = 0; node_no < row_size; ++node_no) {
+                    const double dx = xs[node_no] - x0;
+                    contribution[node_no] += diff_contribution(table_distance - std::sqrt(dx * dx + offset2));
+                }
+            }
+        }
 
-} // acmacs::chart::GridTest::area_for
+    }; // class ContributionGrid
+
+} // namespace
 
 // ----------------------------------------------------------------------
 
@@ -82,35 +178,69 @@ void acmacs::chart::GridTest::test(Result& result)
         acmacs::Layout layout(original_layout_);
         const auto target_contribution = stress_.contribution(result.point_no, table_distances_for_point, layout.data());
         const auto original_pos = original_layout_.at(result.point_no);
+        const auto number_of_dimensions = *original_pos.number_of_dimensions();
+        const double* original_coord = original_layout_.data() + result.point_no * number_of_dimensions;
+        const auto far_from_original = [number_of_dimensions, original_coord, this](const double* node) {
+            double dist2{0.0};
+            for (size_t dim = 0; dim < number_of_dimensions; ++dim)
+                dist2 += (node[dim] - original_coord[dim]) * (node[dim] - original_coord[dim]);
+            return dist2 > (hemisphering_distance_threshold_ * hemisphering_distance_threshold_);
+        };
+
         auto best_contribution = target_contribution;
-        PointCoordinates best_coord(original_pos.number_of_dimensions()),
-                hemisphering_coord(original_pos.number_of_dimensions());
-        const auto hemisphering_stress_threshold_rough = hemisphering_stress_threshold_ * 2;
-        auto hemisphering_contribution = target_contribution + hemisphering_stress_threshold_rough;
-        const auto area = area_for(table_distances_for_point);
-        for (auto it = area.begin(grid_step_), last = area.end(); it != last; ++it) {
-            layout.update(result.point_no, *it);
-            const auto contribution = stress_.contribution(result.point_no, table_distances_for_point, layout.data());
+        const auto hemisphering_contribution_threshold = target_contribution + hemisphering_stress_threshold_ * 2;
+        auto hemisphering_contribution = hemisphering_contribution_threshold;
+        std::vector<double> best_node, hemisphering_node; // empty - not found
+        const auto visit = [&](const double* node, double contribution) {
             if (contribution < best_contribution) {
                 best_contribution = contribution;
-                best_coord = *it;
+                best_node.assign(node, node + number_of_dimensions);
             }
-            else if (!best_coord.exists() && contribution < hemisphering_contribution && distance(original_pos, *it) > hemisphering_distance_threshold_) {
+            else if (contribution < hemisphering_contribution && far_from_original(node)) {
                 hemisphering_contribution = contribution;
-                hemisphering_coord = *it;
+                hemisphering_node.assign(node, node + number_of_dimensions);
+            }
+        };
+
+        const ContributionGrid grid(table_distances_for_point, original_layout_);
+        std::vector<double> area_min, area_max;
+        grid.area(area_min, area_max);
+        if (coarse_step_ > grid_step_) {
+            std::vector<double> candidates; // coarse nodes within hemisphering threshold, number_of_dimensions values per node
+            grid.scan(area_min, area_max, coarse_step_, [&](const double* node, double contribution) {
+                visit(node, contribution);
+                if (contribution < hemisphering_contribution_threshold)
+                    candidates.insert(candidates.end(), node, node + number_of_dimensions);
+            });
+            std::vector<double> cell_min(number_of_dimensions), cell_max(number_of_dimensions);
+            for (auto candidate = candidates.begin(); candidate != candidates.end(); candidate += static_cast<std::ptrdiff_t>(number_of_dimensions)) {
+                for (size_t dim = 0; dim < number_of_dimensions; ++dim) {
+                    cell_min[dim] = std::max(area_min[dim], candidate[static_cast<std::ptrdiff_t>(dim)] - coarse_step_);
+                    cell_max[dim] = std::min(area_max[dim], candidate[static_cast<std::ptrdiff_t>(dim)] + coarse_step_);
+                }
+                grid.scan(cell_min, cell_max, grid_step_, visit);
             }
         }
-        if (best_coord.exists()) {
-            layout.update(result.point_no, best_coord);
+        else
+            grid.scan(area_min, area_max, grid_step_, visit);
+
+        const auto to_coordinates = [&original_pos](const std::vector<double>& node) {
+            PointCoordinates coord(original_pos.number_of_dimensions());
+            std::copy(node.begin(), node.end(), coord.begin());
+            return coord;
+        };
+
+        if (!best_node.empty()) {
+            layout.update(result.point_no, to_coordinates(best_node));
             const auto status = acmacs::chart::optimize(optimization_method_, stress_, layout.data(), layout.data() + layout.size(), acmacs::chart::optimization_precision::rough);
             result.pos = layout.at(result.point_no);
             result.distance = distance(original_pos, result.pos);
             result.contribution_diff = status.final_stress - projection_->stress();
             result.diagnosis = std::abs(result.contribution_diff) > hemisphering_stress_threshold_ ? Result::trapped : Result::hemisphering;
         }
-        else if (hemisphering_coord.exists()) {
+        else if (!hemisphering_node.empty()) {
             // relax to find real contribution
-            layout.update(result.point_no, hemisphering_coord);
+            layout.update(result.point_no, to_coordinates(hemisphering_node));
             auto status = acmacs::chart::optimize(optimization_method_, stress_, layout.data(), layout.data() + layout.size(), acmacs::chart::optimization_precision::rough);
             result.pos = layout.at(result.point_no);
             result.distance = distance(original_pos, result.pos);
@@ -129,7 +259,6 @@ void acmacs::chart::GridTest::test(Result& result)
                 }
             }
         }
-        // AD_DEBUG("GridTest {} area: {:8.1f} units^{}  grid-step: {:5.3f}", result.report(chart_), area.area(), area.num_dim(), grid_step_);
     }
 
 } // acmacs::chart::GridTest::test
@@ -166,23 +295,86 @@ acmacs::chart::GridTest::Results acmacs::chart::GridTest::test_all([[maybe_unuse
 
 // ----------------------------------------------------------------------
 
-acmacs::chart::ProjectionModifyP acmacs::chart::GridTest::make_new_projection_and_relax(const Results& results, verbose verb)
+acmacs::chart::ProjectionModifyP acmacs::chart::GridTest::make_new_projection_and_relax(const Results& results, verbose verb, int threads)
 {
-    auto projection = chart_.projections_modify().new_by_cloning(*projection_);
-    auto layout = projection->layout_modified();
+    std::vector<const Result*> moves;
     for (const auto& result : results) {
-        if (result && result.contribution_diff < 0) {
-            layout->update(result.point_no, result.pos);
-        }
+        if (result && result.contribution_diff < 0)
+            moves.push_back(&result);
+    }
+    std::sort(moves.begin(), moves.end(), [](const auto* r1, const auto* r2) { return r1->contribution_diff < r2->contribution_diff; });
+
+    const auto make_candidate = [this](auto first, auto last) {
+        acmacs::Layout layout(original_layout_);
+        for (; first != last; ++first)
+            layout.update((*first)->point_no, (*first)->pos);
+        return layout;
+    };
+
+    const auto max_candidates = static_cast<size_t>(threads <= 0 ? omp_get_max_threads() : threads);
+    std::vector<acmacs::Layout> candidates{make_candidate(moves.begin(), moves.end())};
+    if (moves.size() > 1 && candidates.size() < max_candidates) {
+        std::vector<const Result*> trapped;
+        std::copy_if(moves.begin(), moves.end(), std::back_inserter(trapped), [](const auto* result) { return result->diagnosis == Result::trapped; });
+        if (!trapped.empty() && trapped.size() < moves.size())
+            candidates.push_back(make_candidate(trapped.begin(), trapped.end()));
+        for (auto move = moves.begin(); move != moves.end() && candidates.size() < max_candidates; ++move)
+            candidates.push_back(make_candidate(move, std::next(move)));
     }
-    const auto status = acmacs::chart::optimize(optimization_method_, stress_, layout->data(), layout->data() + layout->size(), acmacs::chart::optimization_precision::fine);
-    AD_INFO(verb, "stress: {} --> {}", projection_->stress(), status.final_stress);
+
+    std::vector<double> stresses(candidates.size());
+#pragma omp parallel for default(none) shared(candidates, stresses) num_threads(threads <= 0 ? omp_get_max_threads() : threads) schedule(dynamic)
+    for (size_t candidate_no = 0; candidate_no < candidates.size(); ++candidate_no) {
+        auto& layout = candidates[candidate_no];
+        stresses[candidate_no] = acmacs::chart::optimize(optimization_method_, stress_, layout.data(), layout.data() + layout.size(), acmacs::chart::optimization_precision::fine).final_stress;
+    }
+    size_t best = 0;
+    for (size_t candidate_no = 1; candidate_no < candidates.size(); ++candidate_no) {
+        if (stresses[candidate_no] < stresses[best])
+            best = candidate_no;
+    }
+
+    auto projection = chart_.projections_modify().new_by_cloning(*projection_);
+    projection->set_layout(candidates[best]);
+    AD_INFO(verb, "stress: {} --> {} (candidate {} of {})", projection_->stress(), stresses[best], best, candidates.size());
     return projection;
 
 } // acmacs::chart::GridTest::make_new_projection_and_relax
 
 // ----------------------------------------------------------------------
 
+std::vector<size_t> acmacs::chart::GridTest::points_to_retest(const acmacs::Layout& previous_layout, const Results& previous_results) const
+{
+    // contribution of a point depends on its own position and positions of points it has table distances to,
+    // movement below grid step cannot change grid test result
+    const auto number_of_points = original_layout_.number_of_points();
+    std::vector<bool> moved(number_of_points, false), retest(number_of_points, false);
+    for (size_t point_no = 0; point_no < number_of_points; ++point_no) {
+        if (distance(original_layout_.at(point_no), previous_layout.at(point_no)) > grid_step_)
+            moved[point_no] = retest[point_no] = true;
+    }
+    const auto mark = [&moved, &retest](const auto& entries) {
+        for (const auto& entry : entries) {
+            if (moved[entry.point_1])
+                retest[entry.point_2] = true;
+            if (moved[entry.point_2])
+                retest[entry.point_1] = true;
+        }
+    };
+    mark(stress_.table_distances().regular());
+    mark(stress_.table_distances().less_than());
+
+    std::vector<size_t> points;
+    for (const auto& result : previous_results) {
+        if (result || retest[result.point_no])
+            points.push_back(result.point_no);
+    }
+    return points;
+
+} // acmacs::chart::GridTest::points_to_retest
+
+// ----------------------------------------------------------------------
+
 std::string acmacs::chart::GridTest::Results::report() const
 {
     size_t trapped = 0, hemi = 0;
@@ -246,6 +438,18 @@ std::string acmacs::chart::GridTest::Result::diagnosis_str(bool brief) const
 
 // ----------------------------------------------------------------------
 
+void acmacs::chart::GridTest::Results::update(const Results& source)
+{
+    // this is made by test_all() and ordered by point_no, source is in any order
+    for (const auto& result : source) {
+        if (const auto found = std::lower_bound(begin(), end(), result.point_no, [](const auto& en, size_t point_no) { return en.point_no < point_no; }); found != end() && found->point_no == result.point_no)
+            *found = result;
+    }
+
+} // acmacs::chart::GridTest::Results::update
+
+// ----------------------------------------------------------------------
+
 acmacs::chart::GridTest::Results::Results(const acmacs::chart::Projection& projection)
     : std::vector<Result>(projection.number_of_points(), Result(0, projection.number_of_dimensions()))
 {
@@ -388,30 +592,48 @@ std::string acmacs::chart::GridTest::Results::export_to_layout_csv(const ChartMo
 
 // ----------------------------------------------------------------------
 
-std::pair<acmacs::chart::GridTest::Results, size_t> acmacs::chart::grid_test(ChartModify& chart, size_t projection_no, double grid_step, int threads, size_t relax_attempts, std::string_view export_filename, verbose verb)
+std::pair<acmacs::chart::GridTest::Results, size_t> acmacs::chart::grid_test(ChartModify& chart, size_t projection_no, double grid_step, int threads, size_t relax_attempts, std::string_view export_filename, verbose verb,
+                                                                             double coarse_step)
 {
     const Timeit ti_grid("grid test: ", verb == verbose::yes ? report_time::yes : report_time::no);
     const size_t total_attempts = relax_attempts ? relax_attempts : 1;
     size_t grid_projections = 0;
     GridTest::Results results;
+    std::optional<acmacs::Layout> previous_layout; // layout tested in the previous round
     for (size_t attempt = 0; attempt < total_attempts; ++attempt) {
-        GridTest test{chart, projection_no, grid_step};
-        results = test.test_all(threads);
+        const auto test_start = acmacs::timestamp();
+        GridTest test{chart, projection_no, grid_step, coarse_step};
+        size_t tested = 0;
+        if (previous_layout.has_value()) {
+            const auto to_retest = test.points_to_retest(*previous_layout, results);
+            results.update(test.test(to_retest, threads));
+            tested = to_retest.size();
+        }
+        else {
+            results = test.test_all(threads);
+            tested = results.size();
+        }
+        const auto test_time = acmacs::elapsed_seconds(test_start);
         AD_INFO(verb, "{}", results.report());
         for (const auto& result : results) {
             if (result)
                 AD_LOG(acmacs::log::report_stresses, "{}", result.report(chart));
         }
         if (relax_attempts) {
-            auto projection = test.make_new_projection_and_relax(results, verb);
+            const auto relax_start = acmacs::timestamp();
+            previous_layout = *chart.projection(projection_no)->layout();
+            auto projection = test.make_new_projection_and_relax(results, verb, threads);
             ++grid_projections;
             projection->comment("grid-test-" + acmacs::to_string(attempt));
             projection_no = projection->projection_no();
+            AD_INFO(verb, "grid test round {}: tested {} of {} points in {:.1f}s, relaxed in {:.1f}s", attempt, tested, results.size(), test_time, acmacs::elapsed_seconds(relax_start));
             if (ranges::all_of(results, [](const auto& result) { return result.diagnosis != acmacs::chart::GridTest::Result::trapped; }))
                 break;
             // if (std::all_of(results.begin(), results.end(), [](const auto& result) { return result.diagnosis != acmacs::chart::GridTest::Result::trapped; }))
             //     break;
         }
+        else
+            AD_INFO(verb, "grid test: tested {} points in {:.1f}s", tested, test_time);
     }
     chart.projections_modify().sort();
 
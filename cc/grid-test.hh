@@ -9,8 +9,10 @@ namespace acmacs::chart
     class GridTest
     {
       public:
-        GridTest(ChartModify& chart, size_t projection_no, double grid_step)
-            : chart_(chart), projection_(chart.projection_modify(projection_no)), grid_step_(grid_step), original_layout_(*projection_->layout()), stress_(chart.make_stress(projection_no)) {}
+        // coarse_step > grid_step: grid is first scanned with coarse_step, then just cells around nodes
+        // having contribution within hemisphering threshold are scanned with grid_step
+        GridTest(ChartModify& chart, size_t projection_no, double grid_step, double coarse_step = 0.0)
+            : chart_(chart), projection_(chart.projection_modify(projection_no)), grid_step_(grid_step), coarse_step_(coarse_step), original_layout_(*projection_->layout()), stress_(chart.make_stress(projection_no)) {}
         void reset(acmacs::chart::ProjectionModifyP projection) { projection_ = projection; original_layout_ = *projection_->layout(); stress_ = chart_.make_stress(projection_->projection_no()); }
 
         struct Result
@@ -46,6 +48,7 @@ namespace acmacs::chart
             std::string report(const ChartModify& chart, std::string_view pattern = "{ag_sr} {no0:{num_digits}d} {name_full_passage:<60s}") const; // detailed
             std::string export_to_json(const ChartModify& chart, size_t number_of_relaxations = 0) const;
             std::string export_to_layout_csv(const ChartModify& chart, const acmacs::chart::Projection& projection) const;
+            void update(const Results& source); // replace entries for the points tested in source, entries of this must be ordered by point_no (e.g. made by test_all())
             auto count_trapped_hemisphering() const { return std::count_if(begin(), end(), [](const auto& r) { return r.diagnosis == Result::trapped || r.diagnosis == Result::hemisphering; }); }
             number_of_dimensions_t num_dimensions() const { return front().pos.number_of_dimensions(); }
 
@@ -71,12 +74,16 @@ namespace acmacs::chart
         Result test(size_t point_no);
         Results test(const std::vector<size_t>& points, int threads = 0);
         Results test_all(int threads = 0);
-        acmacs::chart::ProjectionModifyP make_new_projection_and_relax(const Results& results, verbose verb);
+        // candidate layouts (all improving moves, trapped moves only, each move alone) are relaxed concurrently, the best one is kept
+        acmacs::chart::ProjectionModifyP make_new_projection_and_relax(const Results& results, verbose verb, int threads = 1);
+        // points that moved in the current layout compared to previous_layout or having table distances to moved ones, and points found trapped/hemisphering in previous_results
+        std::vector<size_t> points_to_retest(const acmacs::Layout& previous_layout, const Results& previous_results) const;
 
       private:
         ChartModify& chart_;
         acmacs::chart::ProjectionModifyP projection_;
         const double grid_step_;                             // acmacs-c2: 0.01
+        const double coarse_step_;                           // 0 - no coarse-to-fine refinement
         const double hemisphering_distance_threshold_ = 1.0; // from acmacs-c2 hemi-local test: 1.0
         const double hemisphering_stress_threshold_ = 0.25;  // stress diff within threshold -> hemisphering, from acmacs-c2 hemi-local test: 0.25
         acmacs::Layout original_layout_;
@@ -86,15 +93,15 @@ namespace acmacs::chart
         void test(Result& result);
         bool antigen(size_t point_no) const { return point_no < chart_.number_of_antigens(); }
         size_t antigen_serum_no(size_t point_no) const { return antigen(point_no) ? point_no : (point_no - chart_.number_of_antigens()); }
-        // acmacs::Area area_for(size_t point_no) const;
-        acmacs::Area area_for(const Stress::TableDistancesForPoint& table_distances_for_point) const;
 
     }; // class GridTest::chart
 
     // if relax_attempts > 1, move trapped points and relax, test again, repeat while there are trapped points
+    // just points affected by the relaxation are tested again in the subsequent rounds
     // if export_filename is not empty, exports in the json format
     // returns last grid test result and the number of grid test projections
-    std::pair<GridTest::Results, size_t> grid_test(ChartModify& chart, size_t projection_no, double grid_step, int threads, size_t relax_attempts, std::string_view export_filename, verbose verb = verbose::yes);
+    std::pair<GridTest::Results, size_t> grid_test(ChartModify& chart, size_t projection_no, double grid_step, int threads, size_t relax_attempts, std::string_view export_filename, verbose verb = verbose::yes,
+                                                   double coarse_step = 0.0);
 
 } // namespace acmacs
 
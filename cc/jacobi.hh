@@ -0,0 +1,184 @@
+#pragma once
+
+#include <array>
+#include <algorithm>
+#include <cmath>
+
+// ----------------------------------------------------------------------
+// Eigen decomposition of small symmetric matrices and SVD of small square
+// matrices (number of dimensions of a layout) by cyclic Jacobi rotations, no allocation.
+// ----------------------------------------------------------------------
+
+namespace acmacs::chart::jacobi
+{
+    constexpr const size_t max_dimensions{8};
+
+    // row major, leading dimension is max_dimensions regardless of the actual size
+    using matrix_t = std::array<double, max_dimensions * max_dimensions>;
+    using vector_t = std::array<double, max_dimensions>;
+
+    constexpr inline double& at(matrix_t& matrix, size_t row, size_t column) { return matrix[row * max_dimensions + column]; }
+    constexpr inline double at(const matrix_t& matrix, size_t row, size_t column) { return matrix[row * max_dimensions + column]; }
+
+    // symmetric (size x size) matrix is destroyed, eigenvalues are sorted in descending order,
+    // eigenvectors are columns of eigenvectors matrix in the same order
+    inline void eigen(matrix_t& matrix, size_t size, vector_t& eigenvalues, matrix_t& eigenvectors)
+    {
+        constexpr const size_t max_sweeps{50};
+
+        eigenvectors.fill(0.0);
+        for (size_t row = 0; row < size; ++row)
+            at(eigenvectors, row, row) = 1.0;
+
+        for (size_t sweep = 0; sweep < max_sweeps; ++sweep) {
+            double off_diagonal{0.0}, diagonal{0.0};
+            for (size_t row = 0; row < size; ++row) {
+                diagonal += at(matrix, row, row) * at(matrix, row, row);
+                for (size_t column = row + 1; column < size; ++column)
+                    off_diagonal += at(matrix, row, column) * at(matrix, row, column);
+            }
+            if (off_diagonal <= diagonal * 1e-30 || off_diagonal == 0.0)
+                break;
+
+            for (size_t p = 0; p < size; ++p) {
+                for (size_t q = p + 1; q < size; ++q) {
+                    const auto apq = at(matrix, p, q);
+                    if (apq == 0.0)
+                        continue;
+                    // rotation annihilating matrix(p, q), Numerical Recipes 11.1
+                    const auto theta = (at(matrix, q, q) - at(matrix, p, p)) / (2.0 * apq);
+                    const auto t = (theta >= 0.0 ? 1.0 : -1.0) / (std::abs(theta) + std::sqrt(theta * theta + 1.0));
+                    const auto c = 1.0 / std::sqrt(t * t + 1.0), s = t * c;
+                    for (size_t k = 0; k < size; ++k) { // columns p and q
+                        const auto akp = at(matrix, k, p), akq = at(matrix, k, q);
+                        at(matrix, k, p) = c * akp - s * akq;
+                        at(matrix, k, q) = s * akp + c * akq;
+                    }
+                    for (size_t k = 0; k < size; ++k) { // rows p and q
+                        const auto apk = at(matrix, p, k), aqk = at(matrix, q, k);
+                        at(matrix, p, k) = c * apk - s * aqk;
+                        at(matrix, q, k) = s * apk + c * aqk;
+                    }
+                    for (size_t k = 0; k < size; ++k) {
+                        const auto vkp = at(eigenvectors, k, p), vkq = at(eigenvectors, k, q);
+                        at(eigenvectors, k, p) = c * vkp - s * vkq;
+                        at(eigenvectors, k, q) = s * vkp + c * vkq;
+                    }
+                }
+            }
+        }
+
+        // sort by eigenvalue, descending (insertion sort, size is tiny)
+        std::array<size_t, max_dimensions> order;
+        for (size_t no = 0; no < size; ++no) {
+            size_t ins = no;
+            for (; ins > 0 && at(matrix, order[ins - 1], order[ins - 1]) < at(matrix, no, no); --ins)
+                order[ins] = order[ins - 1];
+            order[ins] = no;
+        }
+        const auto unsorted_vectors = eigenvectors;
+        for (size_t column = 0; column < size; ++column) {
+            eigenvalues[column] = at(matrix, order[column], order[column]);
+            for (size_t row = 0; row < size; ++row)
+                at(eigenvectors, row, column) = at(unsorted_vectors, row, order[column]);
+        }
+    }
+
+    // ----------------------------------------------------------------------
+
+    // one-sided (Hestenes) Jacobi SVD of (size x size) matrix: matrix = U * diag(singular_values) * V^T
+    // matrix is replaced with U, singular values are not sorted. Columns of U for zero
+    // singular values are completed to an orthonormal basis.
+    inline void svd(matrix_t& matrix, size_t size, vector_t& singular_values, matrix_t& v)
+    {
+        constexpr const size_t max_sweeps{60};
+        constexpr const double tolerance{1e-15};
+
+        v.fill(0.0);
+        for (size_t row = 0; row < size; ++row)
+            at(v, row, row) = 1.0;
+
+        for (size_t sweep = 0; sweep < max_sweeps; ++sweep) {
+            bool rotated{false};
+            for (size_t p = 0; p < size; ++p) {
+                for (size_t q = p + 1; q < size; ++q) {
+                    double alpha{0.0}, beta{0.0}, gamma{0.0};
+                    for (size_t k = 0; k < size; ++k) {
+                        alpha += at(matrix, k, p) * at(matrix, k, p);
+                        beta += at(matrix, k, q) * at(matrix, k, q);
+                        gamma += at(matrix, k, p) * at(matrix, k, q);
+                    }
+                    if (gamma == 0.0 || std::abs(gamma) <= tolerance * std::sqrt(alpha * beta))
+                        continue;
+                    rotated = true;
+                    const auto zeta = (beta - alpha) / (2.0 * gamma);
+                    const auto t = (zeta >= 0.0 ? 1.0 : -1.0) / (std::abs(zeta) + std::sqrt(zeta * zeta + 1.0));
+                    const auto c = 1.0 / std::sqrt(t * t + 1.0), s = t * c;
+                    for (size_t k = 0; k < size; ++k) {
+                        const auto akp = at(matrix, k, p), akq = at(matrix, k, q);
+                        at(matrix, k, p) = c * akp - s * akq;
+                        at(matrix, k, q) = s * akp + c * akq;
+                        const auto vkp = at(v, k, p), vkq = at(v, k, q);
+                        at(v, k, p) = c * vkp - s * vkq;
+                        at(v, k, q) = s * vkp + c * vkq;
+                    }
+                }
+            }
+            if (!rotated)
+                break;
+        }
+
+        // normalize columns, U = matrix * V * diag(1/singular_values)
+        double largest{0.0};
+        for (size_t column = 0; column < size; ++column) {
+            double norm{0.0};
+            for (size_t k = 0; k < size; ++k)
+                norm += at(matrix, k, column) * at(matrix, k, column);
+            singular_values[column] = std::sqrt(norm);
+            largest = std::max(largest, singular_values[column]);
+        }
+        std::array<bool, max_dimensions> degenerate;
+        for (size_t column = 0; column < size; ++column) {
+            degenerate[column] = singular_values[column] <= largest * 1e-12 || singular_values[column] == 0.0;
+            if (!degenerate[column]) {
+                for (size_t k = 0; k < size; ++k)
+                    at(matrix, k, column) /= singular_values[column];
+            }
+        }
+
+        // complete U for degenerate columns by Gram-Schmidt over unit vectors
+        size_t unit{0};
+        for (size_t column = 0; column < size; ++column) {
+            if (!degenerate[column])
+                continue;
+            for (; unit < size; ++unit) {
+                for (size_t k = 0; k < size; ++k)
+                    at(matrix, k, column) = k == unit ? 1.0 : 0.0;
+                for (size_t other = 0; other < size; ++other) {
+                    if (other == column || degenerate[other])
+                        continue;
+                    const auto projection = at(matrix, unit, other);
+                    for (size_t k = 0; k < size; ++k)
+                        at(matrix, k, column) -= projection * at(matrix, k, other);
+                }
+                double norm{0.0};
+                for (size_t k = 0; k < size; ++k)
+                    norm += at(matrix, k, column) * at(matrix, k, column);
+                if (norm > 1e-6) {
+                    norm = std::sqrt(norm);
+                    for (size_t k = 0; k < size; ++k)
+                        at(matrix, k, column) /= norm;
+                    degenerate[column] = false;
+                    ++unit;
+                    break;
+                }
+            }
+        }
+    }
+
+} // namespace acmacs::chart::jacobi
+
+// ----------------------------------------------------------------------
+/// Local Variables:
+/// eval: (if (fboundp 'eu-rename-buffer) (eu-rename-buffer))
+/// End:
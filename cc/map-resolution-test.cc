@@ -1,80 +1,170 @@
 #include "acmacs-base/read-file.hh"
 #include "acmacs-base/filesystem.hh"
+#include "acmacs-base/omp.hh"
 #include "acmacs-chart-2/map-resolution-test.hh"
 #include "acmacs-chart-2/chart-modify.hh"
 #include "acmacs-chart-2/factory-export.hh"
 
-static void relax(acmacs::chart::ChartModify& chart, acmacs::number_of_dimensions_t number_of_dimensions, const acmacs::chart::map_resolution_test_data::Parameters& parameters);
-static acmacs::chart::map_resolution_test_data::Predictions relax_with_proportion_dontcared(acmacs::chart::ChartModify& chart, acmacs::number_of_dimensions_t number_of_dimensions, double proportion_to_dont_care, size_t replicate_no, const acmacs::chart::map_resolution_test_data::Parameters& parameters);
-static acmacs::chart::map_resolution_test_data::ReplicateStat collect_errors(acmacs::chart::ChartModify& master_chart, acmacs::chart::ChartModify& prediction_chart, const acmacs::chart::map_resolution_test_data::Parameters& parameters);
+namespace
+{
+    // master chart data shared by all replicates
+    struct MasterData
+    {
+        struct titer_distance_t
+        {
+            size_t antigen;
+            size_t serum;
+            double distance; // column basis - logged titer
+        };
+
+        MasterData(acmacs::chart::ChartModify& master_chart, const acmacs::chart::map_resolution_test_data::Parameters& parameters)
+            : chart{master_chart}, number_of_antigens{master_chart.number_of_antigens()}, column_bases{master_chart.column_bases(parameters.minimum_column_basis)},
+              relaxed_from_full_table(parameters.number_of_dimensions.size())
+        {
+            for (const auto& titer_ref : master_chart.titers()->titers_regular())
+                regular_titers.push_back(titer_distance_t{titer_ref.antigen, titer_ref.serum, column_bases->column_basis(titer_ref.serum) - titer_ref.titer.logged()});
+        }
+
+        acmacs::chart::ChartModify& chart;
+        const size_t number_of_antigens;
+        const std::shared_ptr<acmacs::chart::ColumnBases> column_bases;
+        std::vector<titer_distance_t> regular_titers;
+        std::vector<acmacs::chart::ProjectionModifyP> relaxed_from_full_table; // best master projection for each entry of parameters.number_of_dimensions (relax_from_full_table::yes), null if not relaxed
+    };
+} // namespace
+
+static void relax(acmacs::chart::ChartModify& chart, acmacs::number_of_dimensions_t number_of_dimensions, const acmacs::chart::map_resolution_test_data::Parameters& parameters, int threads = 0);
+static acmacs::chart::map_resolution_test_data::Predictions relax_with_proportion_dontcared(const MasterData& master, size_t dimensions_no, double proportion_to_dont_care, size_t replicate_no, const acmacs::chart::map_resolution_test_data::Parameters& parameters, int threads);
+static acmacs::chart::map_resolution_test_data::ReplicateStat collect_errors(const MasterData& master, acmacs::chart::ChartModify& prediction_chart);
 static void create_directory_for_intermediate_charts(const acmacs::chart::map_resolution_test_data::Parameters& parameters);
 
 // ----------------------------------------------------------------------
 
-acmacs::chart::map_resolution_test_data::Results acmacs::chart::map_resolution_test(ChartModify& chart, const map_resolution_test_data::Parameters& parameters)
+acmacs::chart::map_resolution_test_data::Results acmacs::chart::map_resolution_test(ChartModify& chart, const map_resolution_test_data::Parameters& parameters, const map_resolution_test_data::summary_callback_t& on_summary)
 {
     create_directory_for_intermediate_charts(parameters);
     map_resolution_test_data::Results results(parameters);
     chart.projections_modify().remove_all();
+    // replicate clones share antigens, sera and titers of the master (copy on write) if the master has them as modify objects
+    chart.antigens_modify();
+    chart.sera_modify();
+    chart.titers_modify();
     // std::cout << "master dot-cares: " << (1.0 - chart.titers()->percent_of_non_dont_cares()) << '\n' << chart.titers()->print() << '\n';
-    for (auto number_of_dimensions : parameters.number_of_dimensions) {
-        for (auto proportion_to_dont_care : parameters.proportions_to_dont_care) {
-            if (parameters.relax_from_full_table == map_resolution_test_data::relax_from_full_table::yes)
-                relax(chart, number_of_dimensions, parameters);
-            std::vector<double> av_abs_error(parameters.number_of_random_replicates_for_each_proportion), sd_error(parameters.number_of_random_replicates_for_each_proportion),
-                correlations(parameters.number_of_random_replicates_for_each_proportion), r2(parameters.number_of_random_replicates_for_each_proportion);
-            size_t number_of_samples = 0;
-            for (auto replicate_no : range(parameters.number_of_random_replicates_for_each_proportion)) {
-                const auto predictions = relax_with_proportion_dontcared(chart, number_of_dimensions, proportion_to_dont_care, replicate_no + 1, parameters);
-                av_abs_error[replicate_no] = predictions.av_abs_error;
-                sd_error[replicate_no] = predictions.sd_error;
-                correlations[replicate_no] = predictions.correlation;
-                r2[replicate_no] = predictions.linear_regression.r2();
-                number_of_samples += predictions.number_of_samples;
-            }
 
-            results.predictions().emplace_back(number_of_dimensions, proportion_to_dont_care, statistics::standard_deviation(av_abs_error), statistics::standard_deviation(sd_error),
-                                 statistics::standard_deviation(correlations), statistics::standard_deviation(r2), number_of_samples);
+    MasterData master{chart, parameters};
+    if (parameters.relax_from_full_table == map_resolution_test_data::relax_from_full_table::yes) {
+        for (size_t dimensions_no = 0; dimensions_no < parameters.number_of_dimensions.size(); ++dimensions_no) {
+            const auto number_of_dimensions = parameters.number_of_dimensions[dimensions_no];
+            relax(chart, number_of_dimensions, parameters);
+            chart.projections_modify().sort();
+            const auto& projections = chart.projections_modify();
+            for (size_t projection_no = 0; projection_no < projections.size(); ++projection_no) {
+                if (auto projection = chart.projection_modify(projection_no); projection->number_of_dimensions() == number_of_dimensions) {
+                    master.relaxed_from_full_table[dimensions_no] = projection;
+                    break;
+                }
+            }
+        }
+    }
 
-            // std::cout << results.predictions().back() << '\n';
+    // replicates of all dimensions and proportions are run in parallel, each replicate relaxation uses the rest of the thread budget (nested parallelism)
+    const auto number_of_replicates = parameters.number_of_random_replicates_for_each_proportion;
+    const auto number_of_proportions = parameters.proportions_to_dont_care.size();
+    const auto number_of_groups = parameters.number_of_dimensions.size() * number_of_proportions;
+    std::vector<std::optional<map_resolution_test_data::Predictions>> predictions(number_of_groups * number_of_replicates);
+    std::vector<size_t> replicates_completed(number_of_groups, 0);
+    // summaries are reported in dimensions x proportions order regardless of the order groups are completed in
+    std::vector<std::optional<map_resolution_test_data::PredictionsSummary>> summaries(number_of_groups);
+    size_t summaries_reported{0};
+    const int thread_budget = parameters.threads <= 0 ? omp_get_max_threads() : parameters.threads;
+    const int replicate_threads = std::max(1, std::min(thread_budget, static_cast<int>(predictions.size())));
+    const int relax_threads = std::max(1, thread_budget / replicate_threads);
+#ifdef _OPENMP
+    const int max_active_levels = omp_get_max_active_levels();
+    if (relax_threads > 1)
+        omp_set_max_active_levels(std::max(max_active_levels, 2));
+#endif
+
+#pragma omp parallel for default(none) shared(master, parameters, predictions, replicates_completed, summaries, summaries_reported, results, on_summary, number_of_replicates, number_of_proportions, number_of_groups, relax_threads) num_threads(replicate_threads) schedule(dynamic)
+    for (size_t task_no = 0; task_no < predictions.size(); ++task_no) {
+        const auto group_no = task_no / number_of_replicates;
+        const auto dimensions_no = group_no / number_of_proportions;
+        const auto proportion_to_dont_care = parameters.proportions_to_dont_care[group_no % number_of_proportions];
+        predictions[task_no] = relax_with_proportion_dontcared(master, dimensions_no, proportion_to_dont_care, task_no % number_of_replicates + 1, parameters, relax_threads);
+
+#pragma omp critical(map_resolution_test_results)
+        if (++replicates_completed[group_no] == number_of_replicates) {
+            std::vector<double> av_abs_error(number_of_replicates), sd_error(number_of_replicates), correlations(number_of_replicates), r2(number_of_replicates);
+            size_t number_of_samples = 0;
+            for (size_t replicate_no = 0; replicate_no < number_of_replicates; ++replicate_no) {
+                const auto& replicate_predictions = *predictions[group_no * number_of_replicates + replicate_no];
+                av_abs_error[replicate_no] = replicate_predictions.av_abs_error;
+                sd_error[replicate_no] = replicate_predictions.sd_error;
+                correlations[replicate_no] = replicate_predictions.correlation;
+                r2[replicate_no] = replicate_predictions.linear_regression.r2();
+                number_of_samples += replicate_predictions.number_of_samples;
+            }
+            summaries[group_no].emplace(parameters.number_of_dimensions[dimensions_no], proportion_to_dont_care, statistics::standard_deviation(av_abs_error), statistics::standard_deviation(sd_error),
+                                        statistics::standard_deviation(correlations), statistics::standard_deviation(r2), number_of_samples);
+            for (; summaries_reported < number_of_groups && summaries[summaries_reported].has_value(); ++summaries_reported) {
+                results.predictions().push_back(*summaries[summaries_reported]);
+                if (on_summary)
+                    on_summary(results.predictions().back());
+            }
         }
     }
 
+#ifdef _OPENMP
+    omp_set_max_active_levels(max_active_levels);
+#endif
     return results;
 
 } // acmacs::chart::map_resolution_test
 
 // ----------------------------------------------------------------------
 
-void relax(acmacs::chart::ChartModify& chart, acmacs::number_of_dimensions_t number_of_dimensions, const acmacs::chart::map_resolution_test_data::Parameters& parameters)
+void relax(acmacs::chart::ChartModify& chart, acmacs::number_of_dimensions_t number_of_dimensions, const acmacs::chart::map_resolution_test_data::Parameters& parameters, int threads)
 {
-    chart.relax(parameters.number_of_optimizations, parameters.minimum_column_basis, number_of_dimensions, acmacs::chart::use_dimension_annealing::yes, {parameters.optimization_precision});
+    acmacs::chart::optimization_options options{parameters.optimization_precision};
+    options.num_threads = threads;
+    chart.relax(parameters.number_of_optimizations, parameters.minimum_column_basis, number_of_dimensions, acmacs::chart::use_dimension_annealing::yes, options);
 
 } // relax
 
 // ----------------------------------------------------------------------
 
-acmacs::chart::map_resolution_test_data::Predictions relax_with_proportion_dontcared(acmacs::chart::ChartModify& master_chart, acmacs::number_of_dimensions_t number_of_dimensions,
-                                                                                     double proportion_to_dont_care, size_t replicate_no,
-                                                                                     const acmacs::chart::map_resolution_test_data::Parameters& parameters)
+acmacs::chart::map_resolution_test_data::Predictions relax_with_proportion_dontcared(const MasterData& master, size_t dimensions_no, double proportion_to_dont_care, size_t replicate_no,
+                                                                                     const acmacs::chart::map_resolution_test_data::Parameters& parameters, int threads)
 {
-    acmacs::chart::ChartClone chart(master_chart, acmacs::chart::ChartClone::clone_data::titers);
+    const auto number_of_dimensions = parameters.number_of_dimensions[dimensions_no];
+    const bool from_full_table = parameters.relax_from_full_table == acmacs::chart::map_resolution_test_data::relax_from_full_table::yes && master.relaxed_from_full_table[dimensions_no];
+    std::unique_ptr<acmacs::chart::ChartClone> chart_ptr;
+    acmacs::chart::ProjectionModifyP projection_from_full_table;
+#pragma omp critical(map_resolution_test_master_chart)
+    {
+        // master chart and its projections may populate their caches while being cloned
+        chart_ptr = std::make_unique<acmacs::chart::ChartClone>(master.chart, acmacs::chart::ChartClone::clone_data::titers);
+        if (from_full_table)
+            projection_from_full_table = chart_ptr->projections_modify().new_by_cloning(*master.relaxed_from_full_table[dimensions_no], true);
+    }
+    auto& chart = *chart_ptr;
     chart.info_modify().name_append(acmacs::string::concat(proportion_to_dont_care, "-dont-cared"));
     chart.titers_modify().remove_layers();
     chart.titers_modify().set_proportion_of_titers_to_dont_care(proportion_to_dont_care);
     if (parameters.column_bases_from_master == acmacs::chart::map_resolution_test_data::column_bases_from_master::yes)
-        chart.forced_column_bases_modify(*master_chart.column_bases(parameters.minimum_column_basis));
-    if (parameters.relax_from_full_table == acmacs::chart::map_resolution_test_data::relax_from_full_table::yes) {
-        auto projection = chart.projections_modify().new_by_cloning(*master_chart.projections_modify().at(0), true);
-        projection->set_forced_column_bases(master_chart.column_bases(parameters.minimum_column_basis));
-        projection->comment("relaxed-from-full-table-best");
-        projection->relax(acmacs::chart::optimization_options{parameters.optimization_precision});
+        chart.forced_column_bases_modify(*master.column_bases);
+    if (projection_from_full_table) {
+        projection_from_full_table->set_forced_column_bases(master.column_bases);
+        projection_from_full_table->comment("relaxed-from-full-table-best");
+        acmacs::chart::optimization_options options{parameters.optimization_precision};
+        options.num_threads = threads;
+        projection_from_full_table->relax(options);
     }
-    relax(chart, number_of_dimensions, parameters);
+    relax(chart, number_of_dimensions, parameters, threads);
     chart.projections_modify().sort();
 
     // collect statistics
-    const auto replicate_stat = collect_errors(master_chart, chart, parameters);
+    const auto replicate_stat = collect_errors(master, chart);
     std::vector<double> prediction_errors(replicate_stat.prediction_errors_for_titers.size());
     std::transform(std::begin(replicate_stat.prediction_errors_for_titers), std::end(replicate_stat.prediction_errors_for_titers), std::begin(prediction_errors),
                    [=](const auto& entry) -> double {
@@ -110,25 +200,18 @@ acmacs::chart::map_resolution_test_data::Predictions relax_with_proportion_dontc
 
 // ----------------------------------------------------------------------
 
-acmacs::chart::map_resolution_test_data::ReplicateStat collect_errors(acmacs::chart::ChartModify& master_chart, acmacs::chart::ChartModify& prediction_chart, const acmacs::chart::map_resolution_test_data::Parameters& parameters)
+acmacs::chart::map_resolution_test_data::ReplicateStat collect_errors(const MasterData& master, acmacs::chart::ChartModify& prediction_chart)
 {
-    const auto number_of_antigens = master_chart.number_of_antigens();
-    auto prediction_projection = prediction_chart.projection(0);
-    auto prediction_layout = prediction_projection->layout();
+    auto prediction_layout = prediction_chart.projection(0)->layout();
     auto prediction_chart_titers = prediction_chart.titers();
-    auto master_chart_titers = master_chart.titers();
-    auto master_column_bases = master_chart.column_bases(parameters.minimum_column_basis);
 
     acmacs::chart::map_resolution_test_data::ReplicateStat replicate_stat;
 
-    for (const auto& master_titer_ref : master_chart_titers->titers_regular()) {
-        // std::cout << ' ' << master_titer_ref << '\n';
-        if (prediction_chart_titers->titer(master_titer_ref.antigen, master_titer_ref.serum).is_dont_care()) {
-            // std::cout << master_titer_ref << '\n';
-            const auto predicted_distance = prediction_layout->distance(master_titer_ref.antigen, master_titer_ref.serum + number_of_antigens);
-            const auto master_distance = master_column_bases->column_basis(master_titer_ref.serum) - master_titer_ref.titer.logged();
-            replicate_stat.prediction_errors_for_titers.emplace_back(master_titer_ref.antigen, master_titer_ref.serum, master_distance - predicted_distance);
-            replicate_stat.master_distances.push_back(master_distance);
+    for (const auto& master_titer : master.regular_titers) {
+        if (prediction_chart_titers->titer(master_titer.antigen, master_titer.serum).is_dont_care()) {
+            const auto predicted_distance = prediction_layout->distance(master_titer.antigen, master_titer.serum + master.number_of_antigens);
+            replicate_stat.prediction_errors_for_titers.emplace_back(master_titer.antigen, master_titer.serum, master_titer.distance - predicted_distance);
+            replicate_stat.master_distances.push_back(master_titer.distance);
             replicate_stat.predicted_distances.push_back(predicted_distance);
         }
     }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <vector>
+#include <functional>
 #include <iostream>
 
 #include "acmacs-base/statistics.hh"
@@ -40,6 +41,7 @@ namespace acmacs
                 enum optimization_precision optimization_precision { optimization_precision::rough };
                 enum relax_from_full_table relax_from_full_table { relax_from_full_table::no };
                 std::string save_charts_to;
+                int threads{0}; // total thread budget for replicates and their relaxations, 0 - omp_get_max_threads()
             };
 
             // ----------------------------------------------------------------------
@@ -112,7 +114,15 @@ namespace acmacs
 
         } // namespace map_resolution_test_data
 
-        map_resolution_test_data::Results map_resolution_test(ChartModify& chart, const map_resolution_test_data::Parameters& parameters);
+        namespace map_resolution_test_data
+        {
+            // called (serialized) for each number of dimensions and proportion in dimensions x proportions order,
+            // i.e. when all its replicates and replicates of all preceding ones are completed
+            using summary_callback_t = std::function<void(const PredictionsSummary&)>;
+        }
+
+        // replicates are run in parallel, summaries are added to the results in dimensions x proportions order
+        map_resolution_test_data::Results map_resolution_test(ChartModify& chart, const map_resolution_test_data::Parameters& parameters, const map_resolution_test_data::summary_callback_t& on_summary = {});
 
 
     } // namespace chart
@@ -164,7 +174,8 @@ template <> struct fmt::formatter<acmacs::chart::map_resolution_test_data::Param
         format_to(ctx.out(), "  column_bases_from_master:                        {}\n", param.column_bases_from_master);
         format_to(ctx.out(), "  optimization_precision:                          {}\n", param.optimization_precision);
         format_to(ctx.out(), "  relax_from_full_table:                           {}\n",   param.relax_from_full_table);
-        format_to(ctx.out(), "  save_charts_to:                                  {}",   param.relax_from_full_table);
+        format_to(ctx.out(), "  save_charts_to:                                  {}\n",   param.relax_from_full_table);
+        format_to(ctx.out(), "  threads:                                         {}",   param.threads);
         return ctx.out();
     }
 };
@@ -1,11 +1,13 @@
 #include "acmacs-base/date.hh"
 #include "acmacs-base/enumerate.hh"
+#include "acmacs-base/omp.hh"
 #include "acmacs-chart-2/merge.hh"
 #include "acmacs-chart-2/procrustes.hh"
 
 // ----------------------------------------------------------------------
 
 static void merge_info(acmacs::chart::ChartModify& target, const acmacs::chart::Chart& chart1, const acmacs::chart::Chart& chart2);
+static void add_sources(acmacs::chart::InfoModify& target, const acmacs::chart::Chart& source);
 static void merge_titers(acmacs::chart::ChartModify& result, const acmacs::chart::Chart& chart1, const acmacs::chart::Chart& chart2, acmacs::chart::MergeReport& report);
 static void merge_plot_spec(acmacs::chart::ChartModify& result, const acmacs::chart::Chart& chart1, const acmacs::chart::Chart& chart2, const acmacs::chart::MergeReport& report);
 static void merge_projections_type2(acmacs::chart::ChartModify& result, const acmacs::chart::Chart& chart1, const acmacs::chart::Chart& chart2, acmacs::chart::MergeReport& report);
@@ -254,6 +256,209 @@ std::pair<acmacs::chart::ChartModifyP, acmacs::chart::MergeReport> acmacs::chart
 
 // ----------------------------------------------------------------------
 
+namespace
+{
+    constexpr const size_t not_merged = static_cast<size_t>(-1);
+
+    struct SourceMapping
+    {
+        std::vector<size_t> antigens; // source antigen index -> target index or not_merged
+        std::vector<size_t> sera;
+    };
+
+    // chart and its antigen/serum that brought a target point, its plot style is used
+    struct Origin
+    {
+        size_t chart_no;
+        size_t index;
+    };
+
+    // primary of the report is the merge so far, if some of its entries are not in the new target (remove_distinct),
+    // remove them and update mappings of the already merged charts
+    template <typename AgSrModify>
+    void remap_primary(AgSrModify& merged, const acmacs::chart::MergeReport::index_mapping_t& primary_target, std::vector<Origin>& origins, std::vector<SourceMapping>& mappings,
+                       std::vector<size_t> SourceMapping::*mapping)
+    {
+        if (primary_target.size() == merged.size())
+            return; // all kept in the same order
+
+        std::vector<size_t> old_to_new(merged.size(), not_merged);
+        std::vector<size_t> to_remove;
+        std::vector<Origin> kept_origins;
+        for (size_t no = 0; no < merged.size(); ++no) {
+            if (const auto found = primary_target.find(no); found != primary_target.end()) {
+                old_to_new[no] = found->second.index;
+                kept_origins.push_back(origins[no]);
+            }
+            else
+                to_remove.push_back(no);
+        }
+        merged.remove(acmacs::ReverseSortedIndexes{to_remove});
+        origins = std::move(kept_origins);
+        for (auto& chart_mapping : mappings) {
+            for (auto& target_no : chart_mapping.*mapping) {
+                if (target_no != not_merged)
+                    target_no = old_to_new[target_no];
+            }
+        }
+    }
+
+    // the same as merge_antigens_sera above, source mapping and origins of the entries are recorded
+    template <typename AgSrModify, typename AgSr>
+    void merge_in(AgSrModify& merged, const AgSr& source, const acmacs::chart::MergeReport::index_mapping_t& to_target, size_t target_size, bool always_replace, size_t chart_no,
+                  std::vector<Origin>& origins, std::vector<size_t>& mapping)
+    {
+        while (merged.size() < target_size)
+            merged.append();
+        origins.resize(target_size);
+        mapping.assign(source.size(), not_merged);
+        for (size_t no = 0; no < source.size(); ++no) {
+            if (const auto entry = to_target.find(no); entry != to_target.end()) {
+                if (!always_replace && entry->second.common) {
+                    merged.at(entry->second.index).update_with(*source.at(no));
+                }
+                else {
+                    merged.at(entry->second.index).replace_with(*source.at(no));
+                    origins[entry->second.index] = Origin{chart_no, no};
+                }
+                mapping[no] = entry->second.index;
+            }
+        }
+    }
+
+    // layers of the source chart (or its titers if it has no layers) with target antigen and serum indexes
+    void make_layers(const acmacs::chart::Chart& source, const SourceMapping& mapping, size_t number_of_antigens, acmacs::chart::TitersModify::sparse_t* target_layers)
+    {
+        const auto copy_titers = [&mapping, number_of_antigens](const auto& titer_iterator, acmacs::chart::TitersModify::sparse_t& layer) {
+            layer.resize(number_of_antigens);
+            for (const auto& titer_ref : titer_iterator) {
+                if (const auto ag_no = mapping.antigens[titer_ref.antigen], sr_no = mapping.sera[titer_ref.serum]; ag_no != not_merged && sr_no != not_merged)
+                    layer[ag_no].emplace_back(sr_no, titer_ref.titer);
+            }
+            for (auto& row : layer)
+                std::sort(row.begin(), row.end(), [](const auto& e1, const auto& e2) { return e1.first < e2.first; });
+        };
+
+        auto titers = source.titers();
+        if (const auto source_layers = titers->number_of_layers(); source_layers) {
+            for (size_t layer_no = 0; layer_no < source_layers; ++layer_no)
+                copy_titers(titers->titers_existing_from_layer(layer_no), target_layers[layer_no]);
+        }
+        else
+            copy_titers(titers->titers_existing(), target_layers[0]);
+    }
+
+} // namespace
+
+// ----------------------------------------------------------------------
+
+std::pair<acmacs::chart::ChartModifyP, std::vector<acmacs::chart::MergeReport>> acmacs::chart::merge(const std::vector<const Chart*>& charts, const MergeSettings& settings, int threads)
+{
+    if (charts.size() < 2)
+        throw merge_error{"too few charts to merge"};
+
+    std::vector<MergeReport> reports;
+    reports.reserve(charts.size() - 1);
+
+    if (settings.projection_merge != projection_merge_t::type1 || settings.combine_cheating_assays_ == combine_cheating_assays::yes) {
+        auto merged = merge(*charts[0], *charts[1], settings);
+        auto result = std::move(merged.first);
+        reports.push_back(std::move(merged.second));
+        for (size_t chart_no = 2; chart_no < charts.size(); ++chart_no) {
+            auto next = merge(*result, *charts[chart_no], settings);
+            result = std::move(next.first);
+            reports.push_back(std::move(next.second));
+        }
+        return {std::move(result), std::move(reports)};
+    }
+
+    for (const auto* chart : charts) {
+        if (const auto dupa = chart->antigens()->find_duplicates(), dups = chart->sera()->find_duplicates(); !dupa.empty() || !dups.empty())
+            throw merge_error{acmacs::string::concat(chart->description(), " has duplicates among antigens or sera: ", to_string(dupa), ' ', to_string(dups))};
+    }
+
+    // antigens, sera and info of the charts merged so far, primary for matching the next chart
+    ChartNew merged(0, 0);
+    auto& merged_antigens = merged.antigens_modify();
+    auto& merged_sera = merged.sera_modify();
+    std::vector<SourceMapping> mappings(charts.size());
+    std::vector<Origin> antigen_origins, serum_origins;
+
+    merged.info_modify().virus(charts[0]->info()->virus());
+    add_sources(merged.info_modify(), *charts[0]);
+    for (size_t chart_no = 1; chart_no < charts.size(); ++chart_no) {
+        const auto& source = *charts[chart_no];
+        const auto& report = reports.emplace_back(chart_no == 1 ? *charts[0] : static_cast<const Chart&>(merged), source, settings);
+        if (chart_no == 1) {
+            merge_in(merged_antigens, *charts[0]->antigens(), report.antigens_primary_target, report.target_antigens, true, 0, antigen_origins, mappings[0].antigens);
+            merge_in(merged_sera, *charts[0]->sera(), report.sera_primary_target, report.target_sera, true, 0, serum_origins, mappings[0].sera);
+        }
+        else {
+            remap_primary(merged_antigens, report.antigens_primary_target, antigen_origins, mappings, &SourceMapping::antigens);
+            remap_primary(merged_sera, report.sera_primary_target, serum_origins, mappings, &SourceMapping::sera);
+        }
+        merge_in(merged_antigens, *source.antigens(), report.antigens_secondary_target, report.target_antigens, false, chart_no, antigen_origins, mappings[chart_no].antigens);
+        merge_in(merged_sera, *source.sera(), report.sera_secondary_target, report.target_sera, false, chart_no, serum_origins, mappings[chart_no].sera);
+        add_sources(merged.info_modify(), source);
+    }
+
+    if (const auto rda = merged_antigens.find_duplicates(), rds = merged_sera.find_duplicates(); !rda.empty() || !rds.empty()) {
+        fmt::memory_buffer msg;
+        fmt::format_to(msg, "Merge has duplicates: AG:{} SR:{}\n", rda, rds);
+        for (const auto& dups : rda) {
+            for (const auto ag_no : dups)
+                fmt::format_to(msg, "  AG {:5d} {}\n", ag_no, merged_antigens.at(ag_no).name_full());
+            fmt::format_to(msg, "\n");
+        }
+        for (const auto& dups : rds) {
+            for (const auto sr_no : dups)
+                fmt::format_to(msg, "  SR {:5d} {}\n", sr_no, merged_sera.at(sr_no).name_full());
+            fmt::format_to(msg, "\n");
+        }
+        throw merge_error{fmt::to_string(msg)};
+    }
+
+    const size_t number_of_antigens = merged_antigens.size(), number_of_sera = merged_sera.size(), number_of_charts = charts.size();
+    ChartModifyP result = std::make_shared<ChartNew>(number_of_antigens, number_of_sera);
+    result->info_modify().virus(charts[0]->info()->virus());
+    for (const auto* chart : charts)
+        add_sources(result->info_modify(), *chart);
+
+    auto& result_antigens = result->antigens_modify();
+    auto& result_sera = result->sera_modify();
+    auto& result_plot_spec = result->plot_spec_modify();
+    std::vector<PlotSpecP> plot_specs(number_of_charts);
+    std::transform(charts.begin(), charts.end(), plot_specs.begin(), [](const auto* chart) { return chart->plot_spec(); });
+    for (size_t ag_no = 0; ag_no < number_of_antigens; ++ag_no) {
+        const auto& origin = antigen_origins[ag_no];
+        result_antigens.at(ag_no).replace_with(merged_antigens.at(ag_no));
+        result_plot_spec.modify(ag_no, plot_specs[origin.chart_no]->style(origin.index));
+    }
+    for (size_t sr_no = 0; sr_no < number_of_sera; ++sr_no) {
+        const auto& origin = serum_origins[sr_no];
+        result_sera.at(sr_no).replace_with(merged_sera.at(sr_no));
+        result_plot_spec.modify_serum(sr_no, plot_specs[origin.chart_no]->style(origin.index + charts[origin.chart_no]->number_of_antigens()));
+    }
+
+    // target layers of each chart: its layers or one layer if it has no layers
+    std::vector<size_t> first_layer(number_of_charts + 1, 0);
+    for (size_t chart_no = 0; chart_no < number_of_charts; ++chart_no)
+        first_layer[chart_no + 1] = first_layer[chart_no] + std::max(charts[chart_no]->titers()->number_of_layers(), size_t{1});
+    TitersModify::layers_t layers(first_layer.back());
+
+#pragma omp parallel for default(none) shared(charts, mappings, first_layer, layers, number_of_antigens, number_of_charts) num_threads(threads <= 0 ? omp_get_max_threads() : threads) schedule(dynamic)
+    for (size_t chart_no = 0; chart_no < number_of_charts; ++chart_no)
+        make_layers(*charts[chart_no], mappings[chart_no], number_of_antigens, layers.data() + first_layer[chart_no]);
+
+    auto& titers = result->titers_modify();
+    titers.set_layers(std::move(layers));
+    reports.back().titer_report = titers.set_from_layers(*result, threads);
+    return {std::move(result), std::move(reports)};
+
+} // acmacs::chart::merge
+
+// ----------------------------------------------------------------------
+
 void merge_titers(acmacs::chart::ChartModify& result, const acmacs::chart::Chart& chart1, const acmacs::chart::Chart& chart2, acmacs::chart::MergeReport& report)
 {
     auto& titers = result.titers_modify();
@@ -479,22 +684,24 @@ void copy_layout(const acmacs::Layout& source, acmacs::Layout& target, size_t so
 void merge_info(acmacs::chart::ChartModify& target, const acmacs::chart::Chart& chart1, const acmacs::chart::Chart& chart2)
 {
     target.info_modify().virus(chart1.info()->virus());
-    if (chart1.info()->number_of_sources() == 0) {
-        target.info_modify().add_source(chart1.info());
-    }
-    else {
-        for (size_t s_no = 0; s_no < chart1.info()->number_of_sources(); ++s_no)
-            target.info_modify().add_source(chart1.info()->source(s_no));
-    }
-    if (chart2.info()->number_of_sources() == 0) {
-        target.info_modify().add_source(chart2.info());
+    add_sources(target.info_modify(), chart1);
+    add_sources(target.info_modify(), chart2);
+
+} // merge_info
+
+// ----------------------------------------------------------------------
+
+void add_sources(acmacs::chart::InfoModify& target, const acmacs::chart::Chart& source)
+{
+    if (source.info()->number_of_sources() == 0) {
+        target.add_source(source.info());
     }
     else {
-        for (size_t s_no = 0; s_no < chart2.info()->number_of_sources(); ++s_no)
-            target.info_modify().add_source(chart2.info()->source(s_no));
+        for (size_t s_no = 0; s_no < source.info()->number_of_sources(); ++s_no)
+            target.add_source(source.info()->source(s_no));
     }
 
-} // merge_info
+} // add_sources
 
 // ----------------------------------------------------------------------
 
@@ -596,10 +803,13 @@ std::string acmacs::chart::MergeReport::titer_merge_diagnostics(const ChartModif
 
         fmt::format_to(output, "{:<{}s}", "Report (see below)", max_field_size + 2);
         for (auto sr_no : sera) {
-            if (const auto found = std::find_if(titer_report->begin(), titer_report->end(), [ag_no=ag_no,sr_no](const auto& entry) { return entry.antigen == ag_no && entry.serum == sr_no; }); found != titer_report->end())
+            // report is ordered by antigen and serum, cells without titers in layers are not in the report
+            if (const auto found = std::lower_bound(titer_report->begin(), titer_report->end(), std::pair{ag_no, sr_no},
+                                                    [](const auto& entry, const auto& cell) { return std::pair{entry.antigen, entry.serum} < cell; });
+                found != titer_report->end() && found->antigen == ag_no && found->serum == sr_no)
                 fmt::format_to(output, "{:>7s}", TitersModify::titer_merge_report_brief(found->report));
             else
-                fmt::format_to(output, "       ");
+                fmt::format_to(output, "{:>7s}", TitersModify::titer_merge_report_brief(TitersModify::titer_merge::all_dontcare));
         }
         fmt::format_to(output, "\n\n");
     }
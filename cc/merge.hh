@@ -58,6 +58,13 @@ namespace acmacs::chart
     };
 
     std::pair<ChartModifyP, MergeReport> merge(const Chart& chart1, const Chart& chart2, const MergeSettings& settings = {});
+
+    // Merges all charts in one pass, the result is the same as of merge(merge(merge(chart1, chart2), chart3), ...):
+    // each chart is matched against antigens and sera merged so far, titers and layers are copied once (in
+    // parallel per source chart) and merged once. Report i is for merging chart i+1 in, titer_report is in the last one.
+    // Merging projections (projection_merge other than type1) and combining cheating assays need intermediate
+    // merges, chained merge is performed for them.
+    std::pair<ChartModifyP, std::vector<MergeReport>> merge(const std::vector<const Chart*>& charts, const MergeSettings& settings = {}, int threads = 0);
 }
 
 template <> struct fmt::formatter<acmacs::chart::MergeReport::target_index_common_t> : fmt::formatter<acmacs::fmt_helper::default_formatter> {
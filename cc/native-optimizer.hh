@@ -0,0 +1,399 @@
+#pragma once
+
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <algorithm>
+
+#include "acmacs-chart-2/optimization-precision.hh"
+
+// ----------------------------------------------------------------------
+// L-BFGS and nonlinear conjugate gradient minimizers templated on the objective.
+// Objective: double func(const double* arg_first, const double* arg_last, double* gradient_first)
+// returns function value and fills gradient in the same call (e.g. Stress::value_gradient).
+// Termination follows alglib setup used in alglib.cc (see optimization_epsilon()).
+// ----------------------------------------------------------------------
+
+namespace acmacs::chart::native
+{
+    enum class termination { gradient, step, max_iterations, no_progress };
+
+    struct result_t
+    {
+        size_t iterations{0};
+        size_t number_of_evaluations{0};
+        termination reason{termination::no_progress};
+    };
+
+    struct parameters_t
+    {
+        double epsg;
+        double epsx;
+        size_t max_iterations{0};              // 0 - unlimited
+        size_t lbfgs_memory{1};                // the same as in alglib::lbfgs_optimize
+        double step_max{0.0};                  // max norm of step, 0 - unlimited
+        double c1{1e-4};                       // sufficient decrease (Wolfe)
+        double c2{0.9};                        // curvature (strong Wolfe)
+        size_t max_line_search_evaluations{20};
+    };
+
+    inline parameters_t lbfgs_parameters(optimization_precision precision)
+    {
+        const auto [epsg, epsx] = optimization_epsilon(precision);
+        return {epsg, epsx, 0, 1, 0.1, 1e-4, 0.9, 20};
+    }
+
+    inline parameters_t cg_parameters(optimization_precision precision)
+    {
+        const auto [epsg, epsx] = optimization_epsilon(precision);
+        return {epsg, epsx, 0, 1, 0.0, 1e-4, 0.1, 20};
+    }
+
+    inline const char* termination_report(termination reason)
+    {
+        switch (reason) {
+            case termination::gradient:
+                return "(4) gradient norm is no more than EpsG";
+            case termination::step:
+                return "(2) relative step is no more than EpsX.";
+            case termination::max_iterations:
+                return "(5) Max iteration steps were taken";
+            case termination::no_progress:
+                return "(7) stopping conditions are too stringent, further improvement is impossible.";
+        }
+        return "unknown termination type";
+    }
+
+    // buffers reused between optimizations, one workspace per thread
+    struct workspace_t
+    {
+        void resize(size_t number_of_args, size_t memory)
+        {
+            gradient.resize(number_of_args);
+            direction.resize(number_of_args);
+            start.resize(number_of_args);
+            start_gradient.resize(number_of_args);
+            s.resize(number_of_args * memory);
+            y.resize(number_of_args * memory);
+            rho.resize(memory);
+            alpha.resize(memory);
+        }
+
+        std::vector<double> gradient, direction, start, start_gradient, s, y, rho, alpha;
+    };
+
+    // ----------------------------------------------------------------------
+
+    namespace detail
+    {
+        inline double dot(const double* first1, const double* first2, size_t size) { return std::inner_product(first1, first1 + size, first2, 0.0); }
+        inline double norm(const double* first, size_t size) { return std::sqrt(dot(first, first, size)); }
+
+        // minimizer of the cubic interpolating values and derivatives at a and b, safeguarded to stay inside the interval
+        inline double interpolate(double a, double fa, double da, double b, double fb, double db)
+        {
+            const double lo = std::min(a, b), hi = std::max(a, b), margin = 0.1 * (hi - lo);
+            double result = 0.5 * (a + b);
+            const double d1 = da + db - 3.0 * (fa - fb) / (a - b);
+            if (const double radicand = d1 * d1 - da * db; radicand >= 0.0) {
+                const double d2 = std::copysign(std::sqrt(radicand), b - a);
+                if (const double denominator = db - da + 2.0 * d2; denominator != 0.0)
+                    result = b - (b - a) * (db + d2 - d1) / denominator;
+            }
+            if (!std::isfinite(result) || result < (lo + margin) || result > (hi - margin))
+                result = 0.5 * (a + b);
+            return result;
+        }
+
+        // Strong Wolfe line search along direction (Nocedal & Wright, algorithms 3.5 and 3.6).
+        // On success returns step > 0 and arg, gradient, value correspond to the accepted point.
+        // On failure returns 0 and arg, gradient, value are restored to the start point.
+        template <typename Func>
+        double line_search(Func& func, size_t size, const double* start, double start_value, const double* start_gradient, const double* direction, double start_slope, double step,
+                           double* arg, double* gradient, double& value, const parameters_t& parameters, size_t& number_of_evaluations)
+        {
+            double last_evaluated{0.0};
+            const auto evaluate = [&](double at) {
+                for (size_t no = 0; no < size; ++no)
+                    arg[no] = start[no] + at * direction[no];
+                value = func(arg, arg + size, gradient);
+                ++number_of_evaluations;
+                last_evaluated = at;
+                return dot(gradient, direction, size);
+            };
+            // NaN value is treated as failed sufficient decrease
+            const auto insufficient_decrease = [&](double at, double at_value) { return !(at_value <= (start_value + parameters.c1 * at * start_slope)); };
+            const double curvature = parameters.c2 * std::abs(start_slope);
+            const double step_max = parameters.step_max > 0.0 ? parameters.step_max / norm(direction, size) : std::numeric_limits<double>::max();
+
+            double lo{0.0}, lo_value{start_value}, lo_slope{start_slope}, hi{0.0}, hi_value{0.0}, hi_slope{0.0};
+            double at = std::min(step, step_max);
+            size_t evaluations = 0;
+            bool bracketed = false;
+            while (!bracketed && evaluations < parameters.max_line_search_evaluations) {
+                ++evaluations;
+                const double slope = evaluate(at);
+                if (insufficient_decrease(at, value) || (lo > 0.0 && value >= lo_value)) {
+                    hi = at;
+                    hi_value = value;
+                    hi_slope = slope;
+                    bracketed = true;
+                }
+                else if (std::abs(slope) <= curvature)
+                    return at;
+                else if (slope >= 0.0) {
+                    hi = lo;
+                    hi_value = lo_value;
+                    hi_slope = lo_slope;
+                    lo = at;
+                    lo_value = value;
+                    lo_slope = slope;
+                    bracketed = true;
+                }
+                else if (at >= step_max)
+                    return at; // the longest allowed step satisfies sufficient decrease
+                else {
+                    lo = at;
+                    lo_value = value;
+                    lo_slope = slope;
+                    at = std::min(at * 4.0, step_max);
+                }
+            }
+
+            while (bracketed && evaluations < parameters.max_line_search_evaluations) {
+                if (std::abs(hi - lo) <= std::numeric_limits<double>::epsilon() * std::max(lo, hi))
+                    break;
+                ++evaluations;
+                at = interpolate(lo, lo_value, lo_slope, hi, hi_value, hi_slope);
+                const double slope = evaluate(at);
+                if (insufficient_decrease(at, value) || value >= lo_value) {
+                    hi = at;
+                    hi_value = value;
+                    hi_slope = slope;
+                }
+                else {
+                    if (std::abs(slope) <= curvature)
+                        return at;
+                    if (slope * (hi - lo) >= 0.0) {
+                        hi = lo;
+                        hi_value = lo_value;
+                        hi_slope = lo_slope;
+                    }
+                    lo = at;
+                    lo_value = value;
+                    lo_slope = slope;
+                }
+            }
+
+            if (lo > 0.0) { // curvature condition not reached but lo gives sufficient decrease
+                if (last_evaluated != lo)
+                    evaluate(lo);
+                return lo;
+            }
+            std::copy(start, start + size, arg);
+            std::copy(start_gradient, start_gradient + size, gradient);
+            value = start_value;
+            return 0.0;
+        }
+
+        // relative decrease below machine precision, further iterations cannot improve
+        inline bool no_progress(double previous_value, double value) { return (previous_value - value) <= std::numeric_limits<double>::epsilon() * std::max(1.0, std::abs(previous_value)); }
+
+    } // namespace detail
+
+    // ----------------------------------------------------------------------
+
+    // report(const double* arg_first, const double* arg_last, double value) is called after each iteration
+    template <typename Func, typename Report>
+    result_t lbfgs(Func&& func, Report&& report, double* arg_first, double* arg_last, const parameters_t& parameters, workspace_t& workspace)
+    {
+        using namespace detail;
+        const auto size = static_cast<size_t>(arg_last - arg_first);
+        const size_t memory = std::max(parameters.lbfgs_memory, size_t{1});
+        workspace.resize(size, memory);
+        double* gradient = workspace.gradient.data();
+        double* direction = workspace.direction.data();
+
+        result_t result;
+        double value = func(arg_first, arg_last, gradient);
+        ++result.number_of_evaluations;
+        if (norm(gradient, size) <= parameters.epsg) {
+            result.reason = termination::gradient;
+            return result;
+        }
+
+        size_t stored = 0, newest = 0; // newest: slot for the next (s, y) pair
+        double gamma = 1.0;
+        for (;;) {
+            if (parameters.max_iterations > 0 && result.iterations >= parameters.max_iterations) {
+                result.reason = termination::max_iterations;
+                break;
+            }
+
+            // two-loop recursion: direction = -H * gradient
+            std::copy(gradient, gradient + size, direction);
+            for (size_t no = 0; no < stored; ++no) {
+                const size_t slot = (newest + memory - 1 - no) % memory;
+                workspace.alpha[slot] = workspace.rho[slot] * dot(&workspace.s[slot * size], direction, size);
+                const double* y = &workspace.y[slot * size];
+                for (size_t ar = 0; ar < size; ++ar)
+                    direction[ar] -= workspace.alpha[slot] * y[ar];
+            }
+            if (stored > 0)
+                std::for_each(direction, direction + size, [gamma](double& val) { val *= gamma; });
+            for (size_t no = stored; no > 0; --no) {
+                const size_t slot = (newest + memory - no) % memory;
+                const double beta = workspace.rho[slot] * dot(&workspace.y[slot * size], direction, size);
+                const double* s = &workspace.s[slot * size];
+                for (size_t ar = 0; ar < size; ++ar)
+                    direction[ar] += s[ar] * (workspace.alpha[slot] - beta);
+            }
+            std::for_each(direction, direction + size, [](double& val) { val = -val; });
+
+            double slope = dot(gradient, direction, size);
+            if (!(slope < 0.0)) { // not a descent direction, restart with steepest descent
+                std::transform(gradient, gradient + size, direction, [](double val) { return -val; });
+                slope = -dot(gradient, gradient, size);
+                stored = 0;
+            }
+            const bool steepest_descent = stored == 0;
+
+            std::copy(arg_first, arg_last, workspace.start.begin());
+            std::copy(gradient, gradient + size, workspace.start_gradient.begin());
+            const double start_value = value;
+            const double step = line_search(func, size, workspace.start.data(), start_value, workspace.start_gradient.data(), direction, slope,
+                                            steepest_descent ? 1.0 / norm(direction, size) : 1.0, arg_first, gradient, value, parameters, result.number_of_evaluations);
+            if (step == 0.0) {
+                if (steepest_descent) {
+                    result.reason = termination::no_progress;
+                    break;
+                }
+                stored = 0; // drop curvature pairs and retry with steepest descent
+                continue;
+            }
+            ++result.iterations;
+            report(static_cast<const double*>(arg_first), static_cast<const double*>(arg_last), value);
+
+            double* s = &workspace.s[newest * size];
+            double* y = &workspace.y[newest * size];
+            for (size_t ar = 0; ar < size; ++ar) {
+                s[ar] = arg_first[ar] - workspace.start[ar];
+                y[ar] = gradient[ar] - workspace.start_gradient[ar];
+            }
+            const double sy = dot(s, y, size), yy = dot(y, y, size), step_norm = norm(s, size);
+            if (sy > std::numeric_limits<double>::epsilon() * yy) { // keep pair only if curvature is positive
+                workspace.rho[newest] = 1.0 / sy;
+                gamma = sy / yy;
+                newest = (newest + 1) % memory;
+                stored = std::min(stored + 1, memory);
+            }
+
+            if (norm(gradient, size) <= parameters.epsg) {
+                result.reason = termination::gradient;
+                break;
+            }
+            if (step_norm <= parameters.epsx) {
+                result.reason = termination::step;
+                break;
+            }
+            if (no_progress(start_value, value)) {
+                result.reason = termination::no_progress;
+                break;
+            }
+        }
+        return result;
+
+    } // acmacs::chart::native::lbfgs
+
+    // ----------------------------------------------------------------------
+
+    // hybrid Dai-Yuan/Hestenes-Stiefel conjugate gradient (alglib mincg default)
+    template <typename Func, typename Report>
+    result_t cg(Func&& func, Report&& report, double* arg_first, double* arg_last, const parameters_t& parameters, workspace_t& workspace)
+    {
+        using namespace detail;
+        const auto size = static_cast<size_t>(arg_last - arg_first);
+        workspace.resize(size, 1);
+        double* gradient = workspace.gradient.data();
+        double* direction = workspace.direction.data();
+        double* y = workspace.y.data();
+
+        result_t result;
+        double value = func(arg_first, arg_last, gradient);
+        ++result.number_of_evaluations;
+        if (norm(gradient, size) <= parameters.epsg) {
+            result.reason = termination::gradient;
+            return result;
+        }
+
+        std::transform(gradient, gradient + size, direction, [](double val) { return -val; });
+        bool steepest_descent = true;
+        double previous_step{0.0}, previous_slope{0.0};
+        for (;;) {
+            if (parameters.max_iterations > 0 && result.iterations >= parameters.max_iterations) {
+                result.reason = termination::max_iterations;
+                break;
+            }
+
+            double slope = dot(gradient, direction, size);
+            if (!(slope < 0.0)) {
+                std::transform(gradient, gradient + size, direction, [](double val) { return -val; });
+                slope = -dot(gradient, gradient, size);
+                steepest_descent = true;
+            }
+            // initial step: 1/|g| for steepest descent, otherwise keep the same first-order change as on the previous iteration
+            const double initial_step = (steepest_descent || previous_step == 0.0) ? 1.0 / norm(direction, size) : previous_step * previous_slope / slope;
+
+            std::copy(arg_first, arg_last, workspace.start.begin());
+            std::copy(gradient, gradient + size, workspace.start_gradient.begin());
+            const double start_value = value;
+            const double step = line_search(func, size, workspace.start.data(), start_value, workspace.start_gradient.data(), direction, slope, initial_step, arg_first, gradient, value,
+                                            parameters, result.number_of_evaluations);
+            if (step == 0.0) {
+                if (steepest_descent) {
+                    result.reason = termination::no_progress;
+                    break;
+                }
+                std::transform(gradient, gradient + size, direction, [](double val) { return -val; });
+                steepest_descent = true;
+                continue;
+            }
+            ++result.iterations;
+            report(static_cast<const double*>(arg_first), static_cast<const double*>(arg_last), value);
+            const double step_norm = step * norm(direction, size);
+            previous_step = step;
+            previous_slope = slope;
+
+            for (size_t ar = 0; ar < size; ++ar)
+                y[ar] = gradient[ar] - workspace.start_gradient[ar];
+            double beta{0.0};
+            if (const double dy = dot(direction, y, size); dy != 0.0)
+                beta = std::max(0.0, std::min(dot(gradient, y, size) / dy, dot(gradient, gradient, size) / dy));
+            for (size_t ar = 0; ar < size; ++ar)
+                direction[ar] = beta * direction[ar] - gradient[ar];
+            steepest_descent = beta == 0.0;
+
+            if (norm(gradient, size) <= parameters.epsg) {
+                result.reason = termination::gradient;
+                break;
+            }
+            if (step_norm <= parameters.epsx) {
+                result.reason = termination::step;
+                break;
+            }
+            if (no_progress(start_value, value)) {
+                result.reason = termination::no_progress;
+                break;
+            }
+        }
+        return result;
+
+    } // acmacs::chart::native::cg
+
+} // namespace acmacs::chart::native
+
+// ----------------------------------------------------------------------
+/// Local Variables:
+/// eval: (if (fboundp 'eu-rename-buffer) (eu-rename-buffer))
+/// End:
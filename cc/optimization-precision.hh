@@ -1,10 +1,26 @@
 #pragma once
 
+#include <utility>
+
 // ----------------------------------------------------------------------
 
 namespace acmacs::chart
 {
     enum class optimization_precision { rough, very_rough, fine };
+
+    // {epsg, epsx}: stop when gradient norm <= epsg or step norm <= epsx, used by both alglib and native optimizers
+    constexpr inline std::pair<double, double> optimization_epsilon(optimization_precision precision)
+    {
+        switch (precision) {
+            case optimization_precision::rough:
+                return {0.5, 1e-3};
+            case optimization_precision::very_rough:
+                return {1.0, 0.1};
+            case optimization_precision::fine:
+                return {1e-10, 0.0};
+        }
+        return {1e-10, 0.0};
+    }
 }
 
 // ----------------------------------------------------------------------
@@ -15,6 +15,8 @@ namespace acmacs::chart
     enum class optimization_method {
         alglib_lbfgs_pca,
         alglib_cg_pca,
+        native_lbfgs_pca,
+        native_cg_pca,
         // optimlib_bfgs_pca,
         // optimlib_differential_evolution,
     };
@@ -88,6 +90,10 @@ template <> struct fmt::formatter<acmacs::chart::optimization_method> : public f
               return format_to(ctx.out(), "alglib_lbfgs_pca");
           case optimization_method::alglib_cg_pca:
               return format_to(ctx.out(), "alglib_cg_pca");
+          case optimization_method::native_lbfgs_pca:
+              return format_to(ctx.out(), "native_lbfgs_pca");
+          case optimization_method::native_cg_pca:
+              return format_to(ctx.out(), "native_cg_pca");
           // case optimization_method::optimlib_bfgs_pca:
           //     return format_to(ctx.out(), "optimlib_bfgs_pca");
           // case optimization_method::optimlib_differential_evolution:
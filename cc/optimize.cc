@@ -7,6 +7,9 @@
 #include "acmacs-chart-2/randomizer.hh"
 #include "acmacs-chart-2/disconnected-points-handler.hh"
 #include "acmacs-chart-2/alglib.hh"
+#include "acmacs-chart-2/native-optimizer.hh"
+#include "acmacs-chart-2/jacobi.hh"
+#include "acmacs-chart-2/parallel-chunks.hh"
 // #include "acmacs-chart-2/optim.hh"
 
 // ----------------------------------------------------------------------
@@ -14,6 +17,7 @@
 namespace acmacs::chart
 {
     static acmacs::chart::optimization_status optimize(acmacs::chart::optimization_method optimization_method, OptimiserCallbackData& callback_data, double* arg_first, double* arg_last, acmacs::chart::optimization_precision precision);
+    static void native_optimize(optimization_method optimization_method, optimization_status& status, OptimiserCallbackData& callback_data, double* arg_first, double* arg_last, optimization_precision precision);
 }
 
 // ----------------------------------------------------------------------
@@ -25,12 +29,16 @@ acmacs::chart::optimization_method acmacs::chart::optimization_method_from_strin
         method = optimization_method::alglib_lbfgs_pca;
     else if (source == "alglib-cg")
         method = optimization_method::alglib_cg_pca;
+    else if (source == "native-lbfgs")
+        method = optimization_method::native_lbfgs_pca;
+    else if (source == "native-cg")
+        method = optimization_method::native_cg_pca;
     // else if (source == "optim-bfgs")
     //     method = optimization_method::optimlib_bfgs_pca;
     // else if (source == "optim-differential-evolution")
     //     method = optimization_method::optimlib_differential_evolution;
     else
-        throw std::runtime_error{fmt::format("unrecognized method: \"{}\", expected: alglib-lbfgs, alglib-cg", source)};
+        throw std::runtime_error{fmt::format("unrecognized method: \"{}\", expected: alglib-lbfgs, alglib-cg, native-lbfgs, native-cg", source)};
     return method;
 
 } // acmacs::chart::optimization_method_from_string
@@ -129,6 +137,10 @@ acmacs::chart::optimization_status acmacs::chart::optimize(acmacs::chart::optimi
         case optimization_method::alglib_cg_pca:
             alglib::cg_optimize(status, callback_data, arg_first, arg_last, precision);
             break;
+        case optimization_method::native_lbfgs_pca:
+        case optimization_method::native_cg_pca:
+            native_optimize(optimization_method, status, callback_data, arg_first, arg_last, precision);
+            break;
         // case optimization_method::optimlib_bfgs_pca:
         //     optim::bfgs(status, callback_data, arg_first, arg_last, precision);
         //     break;
@@ -145,27 +157,70 @@ acmacs::chart::optimization_status acmacs::chart::optimize(acmacs::chart::optimi
 
 // ----------------------------------------------------------------------
 
+void acmacs::chart::native_optimize(optimization_method optimization_method, optimization_status& status, OptimiserCallbackData& callback_data, double* arg_first, double* arg_last, optimization_precision precision)
+{
+    thread_local native::workspace_t workspace; // reused by subsequent optimizations in the same (omp) thread
+
+    const auto value_gradient = [&stress = callback_data.stress](const double* first, const double* last, double* gradient_first) { return stress.value_gradient(first, last, gradient_first); };
+    const auto report = [&callback_data](const double* first, const double* last, double value) {
+        ++callback_data.iteration_no;
+        if (callback_data.intermediate_layouts)
+            callback_data.intermediate_layouts->emplace_back(callback_data.stress.number_of_dimensions(), first, last - first, value);
+    };
+
+    native::result_t result;
+    if (optimization_method == optimization_method::native_lbfgs_pca)
+        result = native::lbfgs(value_gradient, report, arg_first, arg_last, native::lbfgs_parameters(precision), workspace);
+    else
+        result = native::cg(value_gradient, report, arg_first, arg_last, native::cg_parameters(precision), workspace);
+
+    status.termination_report = native::termination_report(result.reason);
+    status.number_of_iterations = result.iterations;
+    status.number_of_stress_calculations = result.number_of_evaluations;
+
+} // acmacs::chart::native_optimize
+
+// ----------------------------------------------------------------------
+
 acmacs::chart::ErrorLines acmacs::chart::error_lines(const acmacs::chart::Projection& projection)
 {
-    auto layout = projection.layout();
-    auto stress = stress_factory(projection, multiply_antigen_titer_until_column_adjust::yes);
-    const auto& table_distances = stress.table_distances();
-    const MapDistances map_distances(*layout, table_distances);
     ErrorLines result;
-    for (auto td = table_distances.regular().begin(), md = map_distances.regular().begin(); td != table_distances.regular().end(); ++td, ++md) {
-        result.emplace_back(td->point_1, td->point_2, td->distance - md->distance);
-    }
-    for (auto td = table_distances.less_than().begin(), md = map_distances.less_than().begin(); td != table_distances.less_than().end(); ++td, ++md) {
-        auto diff = td->distance - md->distance + 1;
-        diff *= std::sqrt(acmacs::sigmoid(diff * SigmoidMutiplier())); // see Derek's message Thu, 10 Mar 2016 16:32:20 +0000 (Re: acmacs error line error)
-        result.emplace_back(td->point_1, td->point_2, diff);
-    }
+    error_lines(projection, [&result](const ErrorLines& chunk) { result.insert(result.end(), chunk.begin(), chunk.end()); });
     return result;
 
 } // acmacs::chart::error_lines
 
 // ----------------------------------------------------------------------
 
+void acmacs::chart::error_lines(const Projection& projection, const error_lines_sink_t& sink, size_t chunk_size, int threads)
+{
+    // map distances are computed on the fly, no MapDistances copy of all pairs
+    const auto layout = projection.layout();
+    const auto stress = stress_factory(projection, multiply_antigen_titer_until_column_adjust::yes);
+    const auto& regular = stress.table_distances().regular();
+    const auto& less_than = stress.table_distances().less_than();
+    const auto number_of_regular = regular.size();
+    const auto produce = [&layout, &regular, &less_than, number_of_regular](size_t first, size_t last, ErrorLines& chunk) {
+        chunk.reserve(last - first);
+        for (size_t no = first; no < last; ++no) {
+            if (no < number_of_regular) {
+                const auto& td = regular[no];
+                chunk.emplace_back(td.point_1, td.point_2, td.distance - layout->distance(td.point_1, td.point_2));
+            }
+            else {
+                const auto& td = less_than[no - number_of_regular];
+                auto diff = td.distance - layout->distance(td.point_1, td.point_2) + 1;
+                diff *= std::sqrt(acmacs::sigmoid(diff * SigmoidMutiplier())); // see Derek's message Thu, 10 Mar 2016 16:32:20 +0000 (Re: acmacs error line error)
+                chunk.emplace_back(td.point_1, td.point_2, diff);
+            }
+        }
+    };
+    process_in_chunks<ErrorLines>(number_of_regular + less_than.size(), chunk_size, threads, produce, sink);
+
+} // acmacs::chart::error_lines
+
+// ----------------------------------------------------------------------
+
 acmacs::chart::DimensionAnnelingStatus acmacs::chart::dimension_annealing(optimization_method optimization_method, const Stress& stress, number_of_dimensions_t source_number_of_dimensions,
                                                                           number_of_dimensions_t target_number_of_dimensions, double* arg_first, double* arg_last)
 {
@@ -176,8 +231,13 @@ acmacs::chart::DimensionAnnelingStatus acmacs::chart::dimension_annealing(optimi
     switch (optimization_method) {
         case optimization_method::alglib_lbfgs_pca:
         case optimization_method::alglib_cg_pca:
+        case optimization_method::native_lbfgs_pca:
+        case optimization_method::native_cg_pca:
             // case optimization_method::optimlib_bfgs_pca:
-            alglib::pca(callback_data, source_number_of_dimensions, target_number_of_dimensions, arg_first, arg_last);
+            if (*source_number_of_dimensions <= jacobi::max_dimensions)
+                pca_truncated(stress, source_number_of_dimensions, target_number_of_dimensions, arg_first, arg_last);
+            else
+                alglib::pca(callback_data, source_number_of_dimensions, target_number_of_dimensions, arg_first, arg_last);
             break;
             // case optimization_method::optimlib_differential_evolution:
             //     throw std::runtime_error{"optimlib_differential_evolution method does not support dimension annealing"};
@@ -197,6 +257,71 @@ void acmacs::chart::pca(const Stress& stress, number_of_dimensions_t number_of_d
 
 } // acmacs::chart::pca
 
+// ----------------------------------------------------------------------
+
+void acmacs::chart::pca_truncated(const Stress& stress, number_of_dimensions_t source_number_of_dimensions, number_of_dimensions_t target_number_of_dimensions, double* arg_first, double* arg_last)
+{
+    const auto source_dims = *source_number_of_dimensions, target_dims = *target_number_of_dimensions;
+    if (source_dims > jacobi::max_dimensions || target_dims > source_dims)
+        throw optimization_error{fmt::format("pca_truncated: unsupported number of dimensions: {} -> {}", source_dims, target_dims)};
+    const auto number_of_points = static_cast<size_t>(arg_last - arg_first) / source_dims;
+    const auto& disconnected = stress.parameters().disconnected; // sorted
+
+    // covariance of connected points in one pass, coordinates are shifted by the first connected point for numerical stability
+    jacobi::vector_t shift{}, sum{};
+    jacobi::matrix_t covariance{};
+    size_t number_of_connected{0};
+    auto next_disconnected = disconnected.begin();
+    for (size_t p_no = 0; p_no < number_of_points; ++p_no) {
+        if (next_disconnected != disconnected.end() && *next_disconnected == p_no) {
+            ++next_disconnected;
+            continue;
+        }
+        const double* coord = arg_first + p_no * source_dims;
+        if (number_of_connected == 0)
+            std::copy(coord, coord + source_dims, shift.begin());
+        ++number_of_connected;
+        for (size_t row = 0; row < source_dims; ++row) {
+            const auto vr = coord[row] - shift[row];
+            sum[row] += vr;
+            for (size_t col = row; col < source_dims; ++col)
+                jacobi::at(covariance, row, col) += vr * (coord[col] - shift[col]);
+        }
+    }
+    if (number_of_connected < 2)
+        throw optimization_error{fmt::format("pca_truncated: too few connected points: {}", number_of_connected)};
+    const auto num = static_cast<double>(number_of_connected);
+    for (size_t row = 0; row < source_dims; ++row) {
+        for (size_t col = row; col < source_dims; ++col)
+            jacobi::at(covariance, col, row) = jacobi::at(covariance, row, col) = (jacobi::at(covariance, row, col) - sum[row] * sum[col] / num) / (num - 1.0);
+    }
+
+    jacobi::vector_t variance;
+    jacobi::matrix_t basis;
+    jacobi::eigen(covariance, source_dims, variance, basis);
+
+    // project in place onto target_dims principal axes (like alglib::pca, coordinates are not centered),
+    // target point p_no never overlaps source points after p_no
+    next_disconnected = disconnected.begin();
+    jacobi::vector_t source;
+    for (size_t p_no = 0; p_no < number_of_points; ++p_no) {
+        double* target = arg_first + p_no * target_dims;
+        if (next_disconnected != disconnected.end() && *next_disconnected == p_no) {
+            ++next_disconnected;
+            std::fill(target, target + target_dims, std::numeric_limits<double>::quiet_NaN());
+            continue;
+        }
+        std::copy(arg_first + p_no * source_dims, arg_first + (p_no + 1) * source_dims, source.begin());
+        for (size_t col = 0; col < target_dims; ++col) {
+            double value{0.0};
+            for (size_t row = 0; row < source_dims; ++row)
+                value += source[row] * jacobi::at(basis, row, col);
+            target[col] = value;
+        }
+    }
+
+} // acmacs::chart::pca_truncated
+
 // ----------------------------------------------------------------------
 /// Local Variables:
 /// eval: (if (fboundp 'eu-rename-buffer) (eu-rename-buffer))
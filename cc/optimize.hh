@@ -2,6 +2,7 @@
 
 #include <stdexcept>
 #include <chrono>
+#include <functional>
 
 #include "acmacs-base/layout.hh"
 #include "acmacs-chart-2/optimize-options.hh"
@@ -85,6 +86,10 @@ namespace acmacs::chart
     // replaces layout in (arg_first, arg_last)
     void pca(const Stress& stress, number_of_dimensions_t number_of_dimensions, double* arg_first, double* arg_last);
 
+    // pca for small number of dimensions (source_number_of_dimensions <= jacobi::max_dimensions) without alglib, used by dimension_annealing
+    // disconnected points do not contribute and get NaN coordinates, layout in (arg_first, arg_last) is replaced with target_number_of_dimensions one
+    void pca_truncated(const Stress& stress, number_of_dimensions_t source_number_of_dimensions, number_of_dimensions_t target_number_of_dimensions, double* arg_first, double* arg_last);
+
     // ----------------------------------------------------------------------
 
     struct ErrorLine
@@ -99,6 +104,11 @@ namespace acmacs::chart
 
     ErrorLines error_lines(const Projection& projection);
 
+    // streaming variant for big charts: error lines are computed in parallel in chunks of chunk_size and passed to sink sequentially
+    // in the same order as error_lines() above returns them
+    using error_lines_sink_t = std::function<void(const ErrorLines&)>;
+    void error_lines(const Projection& projection, const error_lines_sink_t& sink, size_t chunk_size = 100000, int threads = 0);
+
     // ----------------------------------------------------------------------
 
     struct OptimiserCallbackData
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+#include "acmacs-base/omp.hh"
+
+// ----------------------------------------------------------------------
+
+namespace acmacs::chart
+{
+    // Splits [0, number_of_items) into consecutive ranges of items_per_chunk, calls produce(first, last, chunk)
+    // for up to number-of-threads ranges in parallel, then consume(chunk) sequentially in the order of ranges.
+    // Chunk buffers (e.g. std::string) are cleared and reused, i.e. memory is bounded by items_per_chunk * threads.
+    template <typename Chunk, typename Produce, typename Consume> void process_in_chunks(size_t number_of_items, size_t items_per_chunk, int threads, Produce produce, Consume consume)
+    {
+        items_per_chunk = std::max(items_per_chunk, size_t{1});
+        const int num_threads = threads <= 0 ? omp_get_max_threads() : threads;
+        std::vector<Chunk> chunks(static_cast<size_t>(num_threads));
+        for (size_t batch_first = 0; batch_first < number_of_items; batch_first += items_per_chunk * chunks.size()) {
+            const size_t number_of_chunks = std::min(chunks.size(), (number_of_items - batch_first + items_per_chunk - 1) / items_per_chunk);
+#pragma omp parallel for default(none) shared(chunks, number_of_chunks, batch_first, items_per_chunk, number_of_items, produce) num_threads(num_threads) schedule(static, 1)
+            for (size_t chunk_no = 0; chunk_no < number_of_chunks; ++chunk_no) {
+                const auto first = batch_first + chunk_no * items_per_chunk;
+                chunks[chunk_no].clear();
+                produce(first, std::min(first + items_per_chunk, number_of_items), chunks[chunk_no]);
+            }
+            for (size_t chunk_no = 0; chunk_no < number_of_chunks; ++chunk_no)
+                consume(chunks[chunk_no]);
+        }
+    }
+
+} // namespace acmacs::chart
+
+// ----------------------------------------------------------------------
+/// Local Variables:
+/// eval: (if (fboundp 'eu-rename-buffer) (eu-rename-buffer))
+/// End:
@@ -139,6 +139,120 @@ namespace acmacs::chart
         DisconnectedPoints(PointIndexList&& src) : PointIndexList(std::move(src)) {}
     };
 
+    // ----------------------------------------------------------------------
+
+    // dense bitset of point indexes: O(1) membership test and insertion, memory is proportional to the largest index
+    class PointIndexSet
+    {
+      public:
+        PointIndexSet() = default;
+        explicit PointIndexSet(size_t number_of_points) : data_(number_of_points, false) {}
+        PointIndexSet(const PointIndexList& source, size_t number_of_points) : data_(number_of_points, false)
+        {
+            for (const auto no : source)
+                insert(no);
+        }
+
+        bool contains(size_t val) const { return val < data_.size() && data_[val]; }
+        bool empty() const { return size_ == 0; }
+        size_t size() const { return size_; } // number of indexes in the set
+
+        void insert(size_t val)
+        {
+            if (val >= data_.size())
+                data_.resize(val + 1, false);
+            if (!data_[val]) {
+                data_[val] = true;
+                ++size_;
+            }
+        }
+
+        void extend(const PointIndexList& source)
+        {
+            for (const auto no : source)
+                insert(no);
+        }
+
+        void clear()
+        {
+            std::fill(data_.begin(), data_.end(), false);
+            size_ = 0;
+        }
+
+        PointIndexList to_list() const
+        {
+            PointIndexList result;
+            for (size_t no = 0; no < data_.size(); ++no) {
+                if (data_[no])
+                    result.insert(no); // appended, indexes come in ascending order
+            }
+            return result;
+        }
+
+      private:
+        std::vector<bool> data_;
+        size_t size_{0};
+
+    }; // class PointIndexSet
+
+    // ----------------------------------------------------------------------
+
+    // old -> new index map for removing indexes from a sequence of size elements, all affected containers
+    // are compacted in a single pass each instead of erasing and renumbering for every removed index.
+    // base is added to indexes, e.g. number of antigens when removing sera from the points
+    class IndexCompaction
+    {
+      public:
+        static constexpr const size_t removed = static_cast<size_t>(-1);
+
+        IndexCompaction(size_t size, const ReverseSortedIndexes& indexes, size_t base = 0) : new_index_(size, 0)
+        {
+            for (const auto index : indexes)
+                new_index_.at(index + base) = removed;
+            for (auto& new_index : new_index_) {
+                if (new_index != removed)
+                    new_index = new_size_++;
+            }
+        }
+
+        size_t old_size() const { return new_index_.size(); }
+        size_t new_size() const { return new_size_; }
+        size_t operator[](size_t old_index) const { return new_index_[old_index]; }
+        bool is_removed(size_t old_index) const { return new_index_[old_index] == removed; }
+
+        // data consists of old_size() groups of group_size consecutive elements, removed groups are dropped
+        template <typename Container> void apply(Container& data, size_t group_size = 1) const
+        {
+            auto target = data.begin();
+            for (size_t old_index = 0; old_index < new_index_.size(); ++old_index) {
+                const auto source = data.begin() + static_cast<typename Container::difference_type>(old_index * group_size);
+                if (!is_removed(old_index)) {
+                    if (target != source)
+                        std::move(source, source + static_cast<typename Container::difference_type>(group_size), target);
+                    target += static_cast<typename Container::difference_type>(group_size);
+                }
+            }
+            data.erase(target, data.begin() + static_cast<typename Container::difference_type>(new_index_.size() * group_size));
+        }
+
+        // removed indexes are dropped from the list, the rest is renumbered, order is preserved
+        template <typename List> void renumber(List& list) const
+        {
+            list->erase(std::remove_if(list->begin(), list->end(), [this](size_t index) { return index < old_size() && is_removed(index); }), list->end());
+            for (auto& index : *list) {
+                if (index < old_size())
+                    index = new_index_[index];
+                else
+                    index -= old_size() - new_size_;
+            }
+        }
+
+      private:
+        std::vector<size_t> new_index_;
+        size_t new_size_{0};
+
+    }; // class IndexCompaction
+
 } // namespace acmacs::chart
 
 // namespace acmacs
@@ -1,7 +1,11 @@
+#include <numeric>
+
 #include "acmacs-base/range-v3.hh"
 #include "acmacs-base/float.hh"
+#include "acmacs-base/omp.hh"
 #include "acmacs-chart-2/procrustes.hh"
 #include "acmacs-chart-2/chart.hh"
+#include "acmacs-chart-2/jacobi.hh"
 
 #pragma GCC diagnostic push
 #ifdef __clang__
@@ -16,336 +20,304 @@
 
 using namespace acmacs::chart;
 
-using aint_t = alglib::ae_int_t;
-template <typename T> constexpr inline aint_t cint(T src) { return static_cast<aint_t>(src); };
-constexpr inline aint_t cint(acmacs::number_of_dimensions_t src) { return static_cast<aint_t>(*src); };
-
-// ----------------------------------------------------------------------
-
-class MatrixJ
-{
- public:
-    template <typename S> MatrixJ(S size) : size_(cint(size)) {}
-    virtual ~MatrixJ() {}
-
-    constexpr aint_t rows() const { return size_; }
-    constexpr aint_t cols() const { return size_; }
-    virtual double operator()(aint_t row, aint_t col) const = 0;
-
- private:
-    const aint_t size_;
-};
-
-class MatrixJProcrustes : public MatrixJ
-{
- public:
-    template <typename S> MatrixJProcrustes(S size) : MatrixJ(size), diagonal_(1.0 - 1.0 / static_cast<double>(size)), non_diagonal_(-1.0 / static_cast<double>(size)) {}
-    double operator()(aint_t row, aint_t column) const override { return row == column ? diagonal_ : non_diagonal_; }
-
- private:
-    const double diagonal_, non_diagonal_;
-
-}; // class MatrixJProcrustes
-
-class MatrixJProcrustesScaling : public MatrixJ
-{
- public:
-    template <typename S> MatrixJProcrustesScaling(S size)
-        : MatrixJ(size),
-          diagonal_0_(1.0 - 1.0 / static_cast<double>(size)), non_diagonal_0_(-1.0 / static_cast<double>(size)),
-          diagonal_(non_diagonal_0_ * non_diagonal_0_ * static_cast<double>(size - 1) + diagonal_0_ * diagonal_0_),
-          non_diagonal_(non_diagonal_0_ * non_diagonal_0_ * static_cast<double>(size - 2) + non_diagonal_0_ * diagonal_0_ * 2)
-        {}
-    double operator()(aint_t row, aint_t column) const override { return row == column ? diagonal_ : non_diagonal_; }
-
- private:
-    const double diagonal_0_, non_diagonal_0_;
-    const double diagonal_, non_diagonal_;
-
-}; // class MatrixJProcrustesScaling
-
 // ----------------------------------------------------------------------
-
-static alglib::real_2d_array multiply(const MatrixJ& left, const alglib::real_2d_array& right);
-static alglib::real_2d_array multiply(const alglib::real_2d_array& left, const alglib::real_2d_array& right);
-static void multiply(alglib::real_2d_array& matrix, double scale);
-static void multiply_add(alglib::real_2d_array& matrix, double scale, const alglib::real_2d_array& to_add);
-static alglib::real_2d_array multiply_left_transposed(const alglib::real_2d_array& left, const alglib::real_2d_array& right);
-static alglib::real_2d_array multiply_both_transposed(const alglib::real_2d_array& left, const alglib::real_2d_array& right);
-static alglib::real_2d_array transpose(const alglib::real_2d_array& matrix);
-static void singular_value_decomposition(const alglib::real_2d_array& matrix, alglib::real_2d_array& u, alglib::real_2d_array& vt);
-
-inline bool has_nan(const alglib::real_2d_array& data)
-{
-    for (int row = 0; row < data.rows(); ++row)
-        for (int col = 0; col < data.cols(); ++col)
-            if (std::isnan(data(row, col)))
-                return true;
-    return false;
-}
-
-// inline bool has_nan(const alglib::real_2d_array& data)
-// {
-//     bool has_nan = false;
-//     for (int row = 0; row < data.rows(); ++row) {
-//         for (int col = 0; col < data.cols(); ++col) {
-//             const auto val = data(row, col);
-//             has_nan |= std::isnan(val);
-//             std::cout << ' ' << val;
-//         }
-//         std::cout << '\n';
-//     }
-//     return has_nan;
-// }
-
+// Code for the procrustes was initially extracted from Procrustes3-for-lisp.c from lispmds,
+// where it was written in terms of (number_of_common_points x number_of_dimensions) matrices
+// and centering matrix J. All the products there reduce to the (number_of_dimensions x number_of_dimensions)
+// cross-covariance of the centered coordinates, that is accumulated here in a single pass over the common points.
 // ----------------------------------------------------------------------
 
-// Code for this function was extracted from Procrustes3-for-lisp.c from lispmds
-
-ProcrustesData acmacs::chart::procrustes(const Projection& primary, const Projection& secondary, const std::vector<CommonAntigensSera::common_t>& common, procrustes_scaling_t scaling)
+namespace
 {
-    auto primary_layout = primary.number_of_dimensions() == number_of_dimensions_t{2} ? primary.transformed_layout() : primary.layout();
-    auto secondary_layout = secondary.layout();
-    const auto number_of_dimensions = primary_layout->number_of_dimensions();
-    if (number_of_dimensions != secondary_layout->number_of_dimensions())
-        throw invalid_data("procrustes: projections have different number of dimensions");
+    class CrossCovariance
+    {
+      public:
+        CrossCovariance(const acmacs::Layout& primary, const acmacs::Layout& secondary, const std::vector<CommonAntigensSera::common_t>& common);
+
+        size_t number_of_dimensions;
+        size_t number_of_points{0};             // common points having coordinates in both layouts
+        std::vector<double> mean_primary, mean_secondary;
+        std::vector<double> covariance;         // row major, Xc^T * Yc
+        double secondary_sum_of_squares{0.0}; // trace(Yc^T * Yc)
+
+        double& operator()(size_t row, size_t column) { return covariance[row * number_of_dimensions + column]; }
+        double operator()(size_t row, size_t column) const { return covariance[row * number_of_dimensions + column]; }
+
+    }; // class CrossCovariance
+
+    // ----------------------------------------------------------------------
+
+    CrossCovariance::CrossCovariance(const acmacs::Layout& primary, const acmacs::Layout& secondary, const std::vector<CommonAntigensSera::common_t>& common)
+        : number_of_dimensions{*primary.number_of_dimensions()}, mean_primary(number_of_dimensions, 0.0), mean_secondary(number_of_dimensions, 0.0),
+          covariance(number_of_dimensions * number_of_dimensions, 0.0)
+    {
+        // coordinates are accumulated relative to the first common point to avoid cancellation
+        const double* origin_primary{nullptr};
+        const double* origin_secondary{nullptr};
+        for (const auto& cp : common) {
+            const double* pc = primary.data() + cp.primary * number_of_dimensions;
+            const double* sc = secondary.data() + cp.secondary * number_of_dimensions;
+            if (std::isnan(pc[0]) || std::isnan(sc[0])) // disconnected
+                continue;
+            if (origin_primary == nullptr) {
+                origin_primary = pc;
+                origin_secondary = sc;
+            }
+            ++number_of_points;
+            for (size_t row = 0; row < number_of_dimensions; ++row) {
+                const auto xr = pc[row] - origin_primary[row];
+                const auto yr = sc[row] - origin_secondary[row];
+                mean_primary[row] += xr;
+                mean_secondary[row] += yr;
+                secondary_sum_of_squares += yr * yr;
+                for (size_t column = 0; column < number_of_dimensions; ++column)
+                    operator()(row, column) += xr * (sc[column] - origin_secondary[column]);
+            }
+        }
+        if (number_of_points == 0)
+            throw invalid_data("procrustes: no common points having coordinates in both layouts");
+
+        // center: sum(x * y) - sum(x) * sum(y) / n
+        const auto num = static_cast<double>(number_of_points);
+        for (size_t row = 0; row < number_of_dimensions; ++row) {
+            for (size_t column = 0; column < number_of_dimensions; ++column)
+                operator()(row, column) -= mean_primary[row] * mean_secondary[column] / num;
+            secondary_sum_of_squares -= mean_secondary[row] * mean_secondary[row] / num;
+        }
+        for (size_t dim = 0; dim < number_of_dimensions; ++dim) {
+            mean_primary[dim] = mean_primary[dim] / num + origin_primary[dim];
+            mean_secondary[dim] = mean_secondary[dim] / num + origin_secondary[dim];
+        }
+    }
 
-    auto common_without_disconnected = common;
-    common_without_disconnected.erase(std::remove_if(std::begin(common_without_disconnected), std::end(common_without_disconnected),
-                                                     [&primary_layout, &secondary_layout](const auto& en) {
-                                                         return std::isnan(primary_layout->coordinate(en.primary, number_of_dimensions_t{0})) ||
-                                                                std::isnan(secondary_layout->coordinate(en.secondary, number_of_dimensions_t{0}));
-                                                     }),
-                                      std::end(common_without_disconnected));
-    // std::cerr << "common: " << common.size() << " common_without_disconnected: " << common_without_disconnected.size() << '\n';
-
-    alglib::real_2d_array x, y;
-    x.setlength(cint(common_without_disconnected.size()), cint(number_of_dimensions));
-    y.setlength(cint(common_without_disconnected.size()), cint(number_of_dimensions));
-    for (size_t point_no = 0; point_no < common_without_disconnected.size(); ++point_no) {
-        for (auto dim : acmacs::range(number_of_dimensions)) {
-            x(cint(point_no), cint(dim)) = primary_layout->coordinate(common_without_disconnected[point_no].primary, dim);
-            y(cint(point_no), cint(dim)) = secondary_layout->coordinate(common_without_disconnected[point_no].secondary, dim);
+    // ----------------------------------------------------------------------
+
+    // covariance = U * S * V^T, returns row major V * U^T
+    std::vector<double> rotation(const CrossCovariance& covariance)
+    {
+        const auto size = covariance.number_of_dimensions;
+        std::vector<double> result(size * size, 0.0);
+        if (size <= jacobi::max_dimensions) {
+            jacobi::matrix_t u, v;
+            jacobi::vector_t singular_values;
+            for (size_t row = 0; row < size; ++row)
+                for (size_t column = 0; column < size; ++column)
+                    jacobi::at(u, row, column) = covariance(row, column);
+            jacobi::svd(u, size, singular_values, v);
+            for (size_t row = 0; row < size; ++row)
+                for (size_t column = 0; column < size; ++column)
+                    for (size_t k = 0; k < size; ++k)
+                        result[row * size + column] += jacobi::at(v, row, k) * jacobi::at(u, column, k);
+        }
+        else {
+            using aint_t = alglib::ae_int_t;
+            const auto asize = static_cast<aint_t>(size);
+            alglib::real_2d_array matrix, u, vt;
+            alglib::real_1d_array w;
+            matrix.setcontent(asize, asize, covariance.covariance.data());
+            u.setlength(asize, asize);
+            vt.setlength(asize, asize);
+            w.setlength(asize);
+            alglib::rmatrixsvd(matrix, asize, asize, 2 /*u-needed*/, 2 /*vt-needed*/, 2 /*additionalmemory -> max performance*/, w, u, vt);
+            for (size_t row = 0; row < size; ++row)
+                for (size_t column = 0; column < size; ++column)
+                    for (size_t k = 0; k < size; ++k)
+                        result[row * size + column] += vt[static_cast<aint_t>(k)][static_cast<aint_t>(row)] * u[static_cast<aint_t>(column)][static_cast<aint_t>(k)];
         }
+        return result;
     }
 
-    ProcrustesData result(number_of_dimensions);
-    auto set_transformation = [&result, number_of_dimensions = cint(number_of_dimensions)](const auto& source) {
-        for (aint_t row = 0; row < number_of_dimensions; ++row)
-            for (aint_t col = 0; col < number_of_dimensions; ++col)
-                result.transformation(row, col) = source(row, col);
+    // ----------------------------------------------------------------------
+
+    // transformation and scale, secondary_transformed and rms are not set
+    ProcrustesData procrustes_transformation(const acmacs::Layout& primary_layout, const acmacs::Layout& secondary_layout, const std::vector<CommonAntigensSera::common_t>& common, procrustes_scaling_t scaling)
+    {
+        if (primary_layout.number_of_dimensions() != secondary_layout.number_of_dimensions())
+            throw invalid_data("procrustes: layouts have different number of dimensions");
+
+        const CrossCovariance covariance(primary_layout, secondary_layout, common);
+        const auto size = covariance.number_of_dimensions;
+        auto transformation = rotation(covariance);
+        if (std::any_of(transformation.begin(), transformation.end(), [](double val) { return std::isnan(val); }))
+            std::cerr << "WARNING: procrustes: invalid transformation after svd\n";
+
+        ProcrustesData result(primary_layout.number_of_dimensions());
+        if (scaling == procrustes_scaling_t::yes) {
+            // optimal scale: trace(Xc^T * Yc * T) / trace(Yc^T * Yc)
+            double trace_numerator{0.0};
+            for (size_t row = 0; row < size; ++row)
+                for (size_t k = 0; k < size; ++k)
+                    trace_numerator += covariance(row, k) * transformation[k * size + row];
+            result.scale = trace_numerator / covariance.secondary_sum_of_squares;
+            for (auto& val : transformation)
+                val *= result.scale;
+        }
+
+        for (size_t row = 0; row < size; ++row)
+            for (size_t column = 0; column < size; ++column)
+                result.transformation(acmacs::number_of_dimensions_t{row}, acmacs::number_of_dimensions_t{column}) = transformation[row * size + column];
         if (!result.transformation.valid())
             std::cerr << "WARNING: procrustes: invalid transformation\n";
-    };
 
-    alglib::real_2d_array transformation;
-    if (scaling == procrustes_scaling_t::no) {
-        const MatrixJProcrustes j(common_without_disconnected.size());
-        auto m4 = transpose(multiply_left_transposed(multiply(j, y), multiply(j, x)));
-        alglib::real_2d_array u, vt;
-        singular_value_decomposition(m4, u, vt);
-        if (has_nan(u))
-            std::cerr << "WARNING: procrustes: invalid u after svd (no scaling)\n";
-        if (has_nan(vt))
-            std::cerr << "WARNING: procrustes: invalid vt after svd (no scaling)\n";
-        transformation = multiply_both_transposed(vt, u);
-        if (has_nan(transformation))
-            std::cerr << "WARNING: procrustes: invalid transformation after svd (no scaling)\n";
-    }
-    else {
-        const MatrixJProcrustesScaling j(common_without_disconnected.size());
-        const auto m1 = multiply(j, y);
-        const auto m2 = multiply_left_transposed(x, m1);
-        alglib::real_2d_array u, vt;
-        singular_value_decomposition(m2, u, vt);
-        transformation = multiply_both_transposed(vt, u);
-        if (has_nan(transformation))
-            std::cerr << "WARNING: procrustes: invalid transformation after svd (with scaling)\n";
-        // std::cerr << "transformation0: " << transformation.tostring(8) << '\n';
-
-        // calculate optimal scale parameter
-        const auto denominator = multiply_left_transposed(y, m1);
-        const auto trace_denominator =
-            std::accumulate(acmacs::index_iterator<aint_t>(0), acmacs::index_iterator(cint(number_of_dimensions)), 0.0, [&denominator](double sum, auto i) { return sum + denominator(i, i); });
-        const auto m3 = multiply(y, transformation);
-        const auto m4 = multiply(j, m3);
-        const auto numerator = multiply_left_transposed(x, m4);
-        const auto trace_numerator =
-            std::accumulate(acmacs::index_iterator<aint_t>(0), acmacs::index_iterator(cint(number_of_dimensions)), 0.0, [&numerator](double sum, auto i) { return sum + numerator(i, i); });
-        const auto scale = trace_numerator / trace_denominator;
-        multiply(transformation, scale);
-        result.scale = scale;
-    }
-    set_transformation(transformation);
-
-    // translation
-    auto m5 = multiply(y, transformation);
-    multiply_add(m5, -1, x);
-    for (auto dim : acmacs::range(number_of_dimensions)) {
-        const auto t_i = std::accumulate(acmacs::index_iterator<aint_t>(0), acmacs::index_iterator(cint(common_without_disconnected.size())), 0.0,
-                                         [&m5, dim = cint(dim)](auto sum, auto row) { return sum + m5(row, dim); });
-        result.transformation.translation(dim) = t_i / static_cast<double>(common_without_disconnected.size());
+        // translation: mean(X - Y * T)
+        for (size_t column = 0; column < size; ++column) {
+            double translation = covariance.mean_primary[column];
+            for (size_t k = 0; k < size; ++k)
+                translation -= covariance.mean_secondary[k] * transformation[k * size + column];
+            result.transformation.translation(acmacs::number_of_dimensions_t{column}) = translation;
+        }
+
+        return result;
     }
 
-    // rms
-    result.secondary_transformed = result.apply(*secondary_layout);
-    result.rms = 0.0;
-    size_t num_rows = 0;
-    for (const auto& cp : common_without_disconnected) {
-        if (const auto pc = primary_layout->at(cp.primary), sc = result.secondary_transformed->at(cp.secondary); pc.exists() && sc.exists()) {
+    // ----------------------------------------------------------------------
+
+    // rms of distances between primary and transformed secondary common points, secondary is transformed on the fly
+    double procrustes_rms(const acmacs::Layout& primary_layout, const acmacs::Layout& secondary_layout, const std::vector<CommonAntigensSera::common_t>& common, const acmacs::Transformation& transformation)
+    {
+        const auto number_of_dimensions = transformation.number_of_dimensions;
+        const auto size = *number_of_dimensions;
+        double sum_squares{0.0};
+        size_t num_rows{0};
+        for (const auto& cp : common) {
+            const double* pc = primary_layout.data() + cp.primary * size;
+            const double* sc = secondary_layout.data() + cp.secondary * size;
+            if (std::isnan(pc[0]) || std::isnan(sc[0]))
+                continue;
             ++num_rows;
-            const auto make_rms_inc = [&pc, &sc](auto sum, auto dim) { return sum + square(pc[dim] - sc[dim]); };
-            result.rms = std::accumulate(acmacs::index_iterator<number_of_dimensions_t>(0UL), acmacs::index_iterator(number_of_dimensions), result.rms, make_rms_inc);
-            // std::cerr << cp.primary << ' ' << cp.secondary << ' ' << result.rms << '\n';
+            for (auto dim : acmacs::range(number_of_dimensions)) {
+                double transformed = transformation.translation(dim);
+                for (auto index : acmacs::range(number_of_dimensions))
+                    transformed += sc[*index] * transformation(index, dim);
+                sum_squares += (pc[*dim] - transformed) * (pc[*dim] - transformed);
+            }
         }
+        return std::sqrt(sum_squares / static_cast<double>(num_rows));
     }
-    result.rms = std::sqrt(result.rms / static_cast<double>(num_rows));
-
-    // std::cerr << "common points (without disconnected): " << common_without_disconnected.size() << '\n';
-    // std::cerr << "transformation: " << acmacs::to_string(result.transformation) << '\n';
-    // std::cerr << "rms: " << acmacs::to_string(result.rms) << '\n';
 
-    return result;
+    // ----------------------------------------------------------------------
 
-} // acmacs::chart::procrustes
-
-// ----------------------------------------------------------------------
-
-std::shared_ptr<acmacs::Layout> acmacs::chart::ProcrustesData::apply(const acmacs::Layout& source) const
-{
-    assert(source.number_of_dimensions() == transformation.number_of_dimensions);
-    auto result = std::make_shared<acmacs::Layout>(source.number_of_points(), source.number_of_dimensions());
-
-    // multiply source by transformation
-    for (size_t row_no = 0; row_no < source.number_of_points(); ++row_no) {
-        if (const auto row = source[row_no]; row.exists()) {
-            for (auto dim : acmacs::range(transformation.number_of_dimensions)) {
-                auto sum_squares = [&source, this, row_no, dim](auto sum, auto index) { return sum + source(row_no, index) * this->transformation(index, dim); };
-                result->coordinate(row_no, dim) = std::accumulate(acmacs::index_iterator<number_of_dimensions_t>(0UL), acmacs::index_iterator(source.number_of_dimensions()), 0.0, sum_squares) + transformation.translation(dim);
-            }
-        }
-        else {
-            result->set_nan(row_no);
-        }
+    inline std::shared_ptr<acmacs::Layout> primary_layout_of(const Projection& primary)
+    {
+        return primary.number_of_dimensions() == acmacs::number_of_dimensions_t{2} ? primary.transformed_layout() : primary.layout();
     }
 
-    return result;
-
-} // acmacs::chart::ProcrustesData::apply
+} // namespace
 
 // ----------------------------------------------------------------------
 
-alglib::real_2d_array multiply(const MatrixJ& left, const alglib::real_2d_array& right)
+ProcrustesData acmacs::chart::procrustes(const Projection& primary, const Projection& secondary, const std::vector<CommonAntigensSera::common_t>& common, procrustes_scaling_t scaling)
 {
-    // std::cerr << "multiply left " << left.rows() << 'x' << left.cols() << "  right " << right.rows() << 'x' << right.cols() << '\n';
-    alglib::real_2d_array result;
-    result.setlength(left.rows(), right.cols());
-    for (aint_t row = 0; row < left.rows(); ++row) {
-        for (aint_t column = 0; column < right.cols(); ++column) {
-            result(row, column) = std::accumulate(acmacs::index_iterator<aint_t>(0), acmacs::index_iterator(left.cols()), 0.0,
-                                                  [&left,&right,row,column](double sum, auto i) { return sum + left(row, i) * right(i, column); });
-        }
-    }
-    return result;
+    auto primary_layout = primary_layout_of(primary);
+    auto secondary_layout = secondary.layout();
+    if (primary_layout->number_of_dimensions() != secondary_layout->number_of_dimensions())
+        throw invalid_data("procrustes: projections have different number of dimensions");
+    return procrustes(*primary_layout, *secondary_layout, common, scaling);
 
-} // multiply
+} // acmacs::chart::procrustes
 
 // ----------------------------------------------------------------------
 
-alglib::real_2d_array multiply(const alglib::real_2d_array& left, const alglib::real_2d_array& right)
+ProcrustesData acmacs::chart::procrustes(const acmacs::Layout& primary_layout, const acmacs::Layout& secondary_layout, const std::vector<CommonAntigensSera::common_t>& common, procrustes_scaling_t scaling)
 {
-    alglib::real_2d_array result;
-    result.setlength(left.rows(), right.cols());
-    // std::cerr << "multiply left " << left.rows() << 'x' << left.cols() << "  right " << right.rows() << 'x' << right.cols() << "  result " << result.rows() << 'x' << result.cols() << '\n';
-    alglib::rmatrixgemm(left.rows(), right.cols(), right.rows(),
-                        1.0 /*alpha*/, left, 0 /*i-left*/, 0 /*j-left*/, 0 /*left-no-transform*/,
-                        right, 0 /*i-right*/, 0 /*j-right*/, 0 /*right-no-transform*/,
-                        0.0 /*beta*/, result, 0 /*i-result*/, 0 /*j-result*/);
+    auto result = procrustes_transformation(primary_layout, secondary_layout, common, scaling);
+    result.secondary_transformed = result.apply(secondary_layout);
+    result.rms = ::procrustes_rms(primary_layout, secondary_layout, common, result.transformation);
     return result;
 
-} // multiply
+} // acmacs::chart::procrustes
 
 // ----------------------------------------------------------------------
 
-void multiply(alglib::real_2d_array& matrix, double scale)
+double acmacs::chart::procrustes_rms(const acmacs::Layout& primary_layout, const acmacs::Layout& secondary_layout, const std::vector<CommonAntigensSera::common_t>& common, procrustes_scaling_t scaling)
 {
-    for (aint_t row = 0; row < matrix.rows(); ++row)
-        alglib::vmul(&matrix[row][0], 1, matrix.cols(), scale);
+    return ::procrustes_rms(primary_layout, secondary_layout, common, procrustes_transformation(primary_layout, secondary_layout, common, scaling).transformation);
 
-} // multiply
+} // acmacs::chart::procrustes_rms
 
 // ----------------------------------------------------------------------
 
-void multiply_add(alglib::real_2d_array& matrix, double scale, const alglib::real_2d_array& to_add)
+std::vector<ProcrustesData> acmacs::chart::procrustes(const acmacs::Layout& primary_layout, const std::vector<std::shared_ptr<acmacs::Layout>>& secondary_layouts, const std::vector<CommonAntigensSera::common_t>& common,
+                                                      procrustes_scaling_t scaling, [[maybe_unused]] int threads)
 {
-    for (aint_t row = 0; row < matrix.rows(); ++row) {
-        alglib::vmul(&matrix[row][0], 1, matrix.cols(), scale);
-        alglib::vadd(&matrix[row][0], 1, &to_add[row][0], 1, matrix.cols());
+    for (const auto& secondary_layout : secondary_layouts) {
+        if (primary_layout.number_of_dimensions() != secondary_layout->number_of_dimensions())
+            throw invalid_data("procrustes: layouts have different number of dimensions");
     }
 
-} // multiply_add
+    const auto number_of_layouts = secondary_layouts.size();
+    std::vector<std::optional<ProcrustesData>> oriented(number_of_layouts);
+#pragma omp parallel for default(none) shared(primary_layout, secondary_layouts, common, scaling, oriented, number_of_layouts) num_threads(threads <= 0 ? omp_get_max_threads() : threads) schedule(dynamic)
+    for (size_t layout_no = 0; layout_no < number_of_layouts; ++layout_no)
+        oriented[layout_no].emplace(procrustes(primary_layout, *secondary_layouts[layout_no], common, scaling));
 
-// ----------------------------------------------------------------------
-
-alglib::real_2d_array multiply_left_transposed(const alglib::real_2d_array& left, const alglib::real_2d_array& right)
-{
-    alglib::real_2d_array result;
-    result.setlength(left.cols(), right.cols());
-    alglib::rmatrixgemm(left.cols(), right.cols(), right.rows(),
-                        1.0 /*alpha*/, left, 0 /*i-left*/, 0 /*j-left*/, 1 /*left-transpose*/,
-                        right, 0 /*i-right*/, 0 /*j-right*/, 0 /*right-no-transform*/,
-                        0.0 /*beta*/, result, 0 /*i-result*/, 0 /*j-result*/);
+    std::vector<ProcrustesData> result;
+    result.reserve(number_of_layouts);
+    for (auto& entry : oriented)
+        result.push_back(std::move(*entry));
     return result;
 
-} // multiply_left_transposed
+} // acmacs::chart::procrustes
 
 // ----------------------------------------------------------------------
 
-alglib::real_2d_array multiply_both_transposed(const alglib::real_2d_array& left, const alglib::real_2d_array& right)
+std::vector<ProcrustesData> acmacs::chart::procrustes(const Projection& primary, const std::vector<std::shared_ptr<Projection>>& secondary, const std::vector<CommonAntigensSera::common_t>& common,
+                                                      procrustes_scaling_t scaling, int threads)
 {
-    alglib::real_2d_array result;
-    result.setlength(left.cols(), right.rows());
-    alglib::rmatrixgemm(left.cols(), right.rows(), left.rows(),
-                        1.0 /*alpha*/, left, 0 /*i-left*/, 0 /*j-left*/, 1 /*left-transpose*/,
-                        right, 0 /*i-right*/, 0 /*j-right*/, 1 /*right-transpose*/,
-                        0.0 /*beta*/, result, 0 /*i-result*/, 0 /*j-result*/);
-    return result;
+    // layouts are obtained sequentially, projections may load them lazily
+    auto primary_layout = primary_layout_of(primary);
+    std::vector<std::shared_ptr<acmacs::Layout>> secondary_layouts(secondary.size());
+    std::transform(secondary.begin(), secondary.end(), secondary_layouts.begin(), [](const auto& projection) { return projection->layout(); });
+    return procrustes(*primary_layout, secondary_layouts, common, scaling, threads);
 
-} // multiply_both_transposed
+} // acmacs::chart::procrustes
 
 // ----------------------------------------------------------------------
 
-alglib::real_2d_array transpose(const alglib::real_2d_array& source)
+std::shared_ptr<acmacs::Layout> acmacs::chart::ProcrustesData::apply(const acmacs::Layout& source) const
 {
-    alglib::real_2d_array result;
-    result.setlength(source.cols(), source.rows());
-    alglib::rmatrixtranspose(source.rows(), source.cols(), source, 0/*i-source*/, 0/*j-source*/, result, 0/*i-result*/, 0/*j-result*/);
-      // std::cerr << "transposed: " << source.rows() << 'x' << source.cols() << " --> " << source.cols() << 'x' << source.rows() << '\n';
-    return result;
-
-} // transpose
+    assert(source.number_of_dimensions() == transformation.number_of_dimensions);
+    auto result = std::make_shared<acmacs::Layout>(source.number_of_points(), source.number_of_dimensions());
 
-// ----------------------------------------------------------------------
+    // multiply source by transformation
+    for (size_t row_no = 0; row_no < source.number_of_points(); ++row_no) {
+        if (const auto row = source[row_no]; row.exists()) {
+            for (auto dim : acmacs::range(transformation.number_of_dimensions)) {
+                auto sum_squares = [&source, this, row_no, dim](auto sum, auto index) { return sum + source(row_no, index) * this->transformation(index, dim); };
+                result->coordinate(row_no, dim) = std::accumulate(acmacs::index_iterator<number_of_dimensions_t>(0UL), acmacs::index_iterator(source.number_of_dimensions()), 0.0, sum_squares) + transformation.translation(dim);
+            }
+        }
+        else {
+            result->set_nan(row_no);
+        }
+    }
 
-void singular_value_decomposition(const alglib::real_2d_array& matrix, alglib::real_2d_array& u, alglib::real_2d_array& vt)
-{
-    vt.setlength(matrix.cols(), matrix.cols());
-    u.setlength(matrix.rows(), matrix.rows());
-    alglib::real_1d_array w;
-    w.setlength(matrix.cols());
-    alglib::rmatrixsvd(matrix, matrix.rows(), matrix.cols(), 2/*u-needed*/, 2/*vt-needed*/, 2 /*additionalmemory -> max performance*/, w, u, vt);
+    return result;
 
-} // singular_value_decomposition
+} // acmacs::chart::ProcrustesData::apply
 
 // ----------------------------------------------------------------------
 
 acmacs::chart::ProcrustesSummary acmacs::chart::procrustes_summary(const acmacs::Layout& primary, const acmacs::Layout& transformed_secondary, const ProcrustesSummaryParameters& parameters)
 {
     ProcrustesSummary results{parameters.number_of_antigens, primary.number_of_points() - parameters.number_of_antigens};
+
+    // distances between primary and secondary points computed on the flat layout buffers
+    const auto number_of_dimensions = *primary.number_of_dimensions();
+    const double* primary_data = primary.data();
+    const double* secondary_data = transformed_secondary.data();
+    const auto point_distance = [number_of_dimensions, primary_data, secondary_data](size_t point_no) {
+        const double* pc = primary_data + point_no * number_of_dimensions;
+        const double* sc = secondary_data + point_no * number_of_dimensions;
+        double sum_squares{0.0};
+        for (size_t dim = 0; dim < number_of_dimensions; ++dim)
+            sum_squares += (pc[dim] - sc[dim]) * (pc[dim] - sc[dim]);
+        return std::sqrt(sum_squares);
+    };
+
     double sum_distance = 0;
-    for (const auto ag_no : range_from_0_to(parameters.number_of_antigens)) {
-        const double dist = distance(primary[ag_no], transformed_secondary[ag_no]);
-        // AD_DEBUG("    distance AG {:2d}: {:7.4f}", ag_no, dist);
+    for (size_t ag_no = 0; ag_no < parameters.number_of_antigens; ++ag_no) {
+        const double dist = point_distance(ag_no);
         results.antigen_distances[ag_no] = dist;
         sum_distance += dist;
         results.longest_distance = std::max(results.longest_distance, dist);
@@ -356,16 +328,22 @@ acmacs::chart::ProcrustesSummary acmacs::chart::procrustes_summary(const acmacs:
         results.average_distance = 0;
     // AD_DEBUG("average_distance (without AG {}): {:7.4f}", parameters.antigen_being_tested, results.average_distance);
 
-    for (const auto sr_no : range_from_0_to(results.serum_distances.size())) {
-        const double dist = distance(primary[sr_no + parameters.number_of_antigens], transformed_secondary[sr_no + parameters.number_of_antigens]);
+    for (size_t sr_no = 0; sr_no < results.serum_distances.size(); ++sr_no) {
+        const double dist = point_distance(sr_no + parameters.number_of_antigens);
         results.serum_distances[sr_no] = dist;
         results.longest_distance = std::max(results.longest_distance, dist);
     }
 
     if (parameters.number_of_antigens > 0) {
-        for (const auto ag_no : range_from_0_to(parameters.number_of_antigens))
-            results.antigens_by_distance[ag_no] = ag_no;
-        std::sort(results.antigens_by_distance.begin(), results.antigens_by_distance.end(), [&results](auto ag1, auto ag2) { return results.antigen_distances[ag2] < results.antigen_distances[ag1]; });
+        std::iota(results.antigens_by_distance.begin(), results.antigens_by_distance.end(), 0UL);
+        const auto longest_first = [&results](auto ag1, auto ag2) { return results.antigen_distances[ag2] < results.antigen_distances[ag1]; };
+        if (parameters.number_of_most_moved > 0 && parameters.number_of_most_moved < parameters.number_of_antigens) {
+            const auto most_moved_end = std::next(results.antigens_by_distance.begin(), static_cast<std::ptrdiff_t>(parameters.number_of_most_moved));
+            std::partial_sort(results.antigens_by_distance.begin(), most_moved_end, results.antigens_by_distance.end(), longest_first);
+            results.antigens_by_distance.erase(most_moved_end, results.antigens_by_distance.end());
+        }
+        else
+            std::sort(results.antigens_by_distance.begin(), results.antigens_by_distance.end(), longest_first);
 
         if (const double x_diff = transformed_secondary(parameters.antigen_being_tested, number_of_dimensions_t{0}) - primary(parameters.antigen_being_tested, number_of_dimensions_t{0});
             !float_zero(x_diff)) {
@@ -389,7 +367,29 @@ acmacs::chart::ProcrustesSummary acmacs::chart::procrustes_summary(const acmacs:
 
     return results;
 
-} // acmacs::chart::summary
+} // acmacs::chart::procrustes_summary
+
+// ----------------------------------------------------------------------
+
+std::vector<acmacs::chart::ProcrustesSummary> acmacs::chart::procrustes_summary(const acmacs::Layout& primary, const std::vector<std::shared_ptr<acmacs::Layout>>& transformed_secondaries,
+                                                                                const std::vector<ProcrustesSummaryParameters>& parameters, [[maybe_unused]] int threads)
+{
+    if (parameters.size() != transformed_secondaries.size() && parameters.size() != 1)
+        throw std::runtime_error{AD_FORMAT("procrustes_summary: number of parameters ({}) does not match number of layouts ({})", parameters.size(), transformed_secondaries.size())};
+
+    const auto number_of_layouts = transformed_secondaries.size();
+    std::vector<std::optional<ProcrustesSummary>> summaries(number_of_layouts);
+#pragma omp parallel for default(none) shared(primary, transformed_secondaries, parameters, summaries, number_of_layouts) num_threads(threads <= 0 ? omp_get_max_threads() : threads) schedule(dynamic)
+    for (size_t layout_no = 0; layout_no < number_of_layouts; ++layout_no)
+        summaries[layout_no].emplace(procrustes_summary(primary, *transformed_secondaries[layout_no], parameters[parameters.size() == 1 ? 0 : layout_no]));
+
+    std::vector<ProcrustesSummary> result;
+    result.reserve(number_of_layouts);
+    for (auto& entry : summaries)
+        result.push_back(std::move(*entry));
+    return result;
+
+} // acmacs::chart::procrustes_summary
 
 // ----------------------------------------------------------------------
 
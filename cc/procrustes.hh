@@ -30,6 +30,17 @@ namespace acmacs::chart
     enum class procrustes_scaling_t { no, yes };
 
     ProcrustesData procrustes(const Projection& primary, const Projection& secondary, const std::vector<CommonAntigensSera::common_t>& common, procrustes_scaling_t scaling);
+    // layouts must have the same number of dimensions, e.g. two layouts of the same chart (comparing optimization results)
+    ProcrustesData procrustes(const acmacs::Layout& primary_layout, const acmacs::Layout& secondary_layout, const std::vector<CommonAntigensSera::common_t>& common, procrustes_scaling_t scaling);
+
+    // rms only, secondary layout is not transformed (e.g. comparing relaxation results)
+    double procrustes_rms(const acmacs::Layout& primary_layout, const acmacs::Layout& secondary_layout, const std::vector<CommonAntigensSera::common_t>& common, procrustes_scaling_t scaling);
+
+    // orients each of secondary projections/layouts to the primary one in parallel, threads <= 0: use all cores
+    std::vector<ProcrustesData> procrustes(const Projection& primary, const std::vector<std::shared_ptr<Projection>>& secondary, const std::vector<CommonAntigensSera::common_t>& common,
+                                           procrustes_scaling_t scaling, int threads = 0);
+    std::vector<ProcrustesData> procrustes(const acmacs::Layout& primary_layout, const std::vector<std::shared_ptr<acmacs::Layout>>& secondary_layouts, const std::vector<CommonAntigensSera::common_t>& common,
+                                           procrustes_scaling_t scaling, int threads = 0);
 
     // ----------------------------------------------------------------------
     // avidity test support
@@ -43,7 +54,7 @@ namespace acmacs::chart
         double longest_distance{0.0};
         std::vector<double> antigen_distances;   // from primary to secondary points
         std::vector<double> serum_distances;       // from primary to secondary points
-        std::vector<size_t> antigens_by_distance; // indices antigens sorted by distance (longest first)
+        std::vector<size_t> antigens_by_distance; // indices antigens sorted by distance (longest first), just number_of_most_moved if it is set in parameters
         double test_antigen_angle{0.0};           // angle between primary and secondary point for the antigen being tested
         double distance_vaccine_to_test_antigen{0.0};  // in secondary points
         double angle_vaccine_to_test_antigen{0.0};     // in secondary points
@@ -54,6 +65,7 @@ namespace acmacs::chart
         size_t number_of_antigens;
         size_t antigen_being_tested;
         std::optional<size_t> vaccine_antigen;
+        size_t number_of_most_moved{0}; // 0 - sort all antigens by distance, otherwise partial sort
     };
 
       // Computes some summary information for procrustes results (used by routine_diagnostics.LowAvidityTest):
@@ -66,6 +78,10 @@ namespace acmacs::chart
       // - angle of vector from vaccine_antigen to antigen_being_tested in the secondary points
     ProcrustesSummary procrustes_summary(const acmacs::Layout& primary, const acmacs::Layout& transformed_secondary, const ProcrustesSummaryParameters& parameters);
 
+      // the same for many transformed secondary layouts in parallel, parameters either for each layout or just one for all
+    std::vector<ProcrustesSummary> procrustes_summary(const acmacs::Layout& primary, const std::vector<std::shared_ptr<acmacs::Layout>>& transformed_secondaries,
+                                                      const std::vector<ProcrustesSummaryParameters>& parameters, int threads = 0);
+
 } // namespace acmacs::chart
 
 /// ----------------------------------------------------------------------
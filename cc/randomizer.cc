@@ -19,11 +19,19 @@ std::shared_ptr<acmacs::chart::LayoutRandomizerPlain> acmacs::chart::randomizer_
 
 // ----------------------------------------------------------------------
 
-std::shared_ptr<acmacs::chart::LayoutRandomizer> acmacs::chart::randomizer_plain_with_current_layout_area(const ProjectionModify& projection, double diameter_multiplier, LayoutRandomizer::seed_t seed)
+double acmacs::chart::layout_area_diameter(const acmacs::Layout& layout)
 {
-    const auto mm = projection.layout_modified()->minmax();
+    const auto mm = layout.minmax();
     auto sq = [](double v) { return v*v; };
-    const auto diameter = std::sqrt(std::accumulate(mm.begin(), mm.end(), 0.0, [&sq](double sum, const auto& p) { return sum + sq(p.second - p.first); }));
+    return std::sqrt(std::accumulate(mm.begin(), mm.end(), 0.0, [&sq](double sum, const auto& p) { return sum + sq(p.second - p.first); }));
+
+} // acmacs::chart::layout_area_diameter
+
+// ----------------------------------------------------------------------
+
+std::shared_ptr<acmacs::chart::LayoutRandomizer> acmacs::chart::randomizer_plain_with_current_layout_area(const ProjectionModify& projection, double diameter_multiplier, LayoutRandomizer::seed_t seed)
+{
+    const auto diameter = layout_area_diameter(*projection.layout_modified());
     return std::make_shared<LayoutRandomizerPlain>(diameter * diameter_multiplier, seed);
 
 } // acmacs::chart::randomizer_plain_with_current_layout_area
@@ -32,9 +40,7 @@ std::shared_ptr<acmacs::chart::LayoutRandomizer> acmacs::chart::randomizer_plain
 
 std::shared_ptr<acmacs::chart::LayoutRandomizer> acmacs::chart::randomizer_border_with_current_layout_area(const ProjectionModify& projection, double diameter_multiplier, const LineSide& line_side, LayoutRandomizer::seed_t seed)
 {
-    const auto mm = projection.layout_modified()->minmax();
-    auto sq = [](double v) { return v*v; };
-    const auto diameter = std::sqrt(std::accumulate(mm.begin(), mm.end(), 0.0, [&sq](double sum, const auto& p) { return sum + sq(p.second - p.first); }));
+    const auto diameter = layout_area_diameter(*projection.layout_modified());
     return std::make_shared<LayoutRandomizerWithLineBorder>(diameter * diameter_multiplier, line_side, seed);
 
 } // acmacs::chart::randomizer_border_with_current_layout_area
@@ -48,9 +54,7 @@ std::shared_ptr<acmacs::chart::LayoutRandomizer> randomizer_plain_from_sample_op
     projection.randomize_layout(rnd);
     acmacs::chart::optimize(acmacs::chart::optimization_method::alglib_cg_pca, stress, projection.layout_modified()->data(), projection.layout_modified()->size(),
                             acmacs::chart::optimization_precision::very_rough);
-    auto sq = [](double v) { return v * v; };
-    const auto mm = projection.layout_modified()->minmax();
-    const auto diameter = std::sqrt(std::accumulate(mm.begin(), mm.end(), 0.0, [&sq](double sum, const auto& p) { return sum + sq(p.second - p.first); }));
+    const auto diameter = acmacs::chart::layout_area_diameter(*projection.layout_modified());
     if (std::isnan(diameter) || float_zero(diameter))
         throw std::runtime_error{AD_FORMAT("randomizer_plain_from_sample_optimization_internal: diameter is {}", diameter)};
     rnd->diameter(diameter * diameter_multiplier);
@@ -7,6 +7,7 @@
 #include <mutex>
 
 #include "acmacs-base/line.hh"
+#include "acmacs-base/layout.hh"
 #include "acmacs-chart-2/column-bases.hh"
 
 // ----------------------------------------------------------------------
@@ -133,6 +134,9 @@ namespace acmacs::chart
     std::shared_ptr<LayoutRandomizer> randomizer_plain_from_sample_optimization(const Chart& chart, const Stress& stress, number_of_dimensions_t number_of_dimensions, MinimumColumnBasis minimum_column_basis, double diameter_multiplier, LayoutRandomizer::seed_t seed = std::nullopt);
     std::shared_ptr<LayoutRandomizer> randomizer_plain_from_sample_optimization(const Projection& projection, const Stress& stress, double diameter_multiplier, LayoutRandomizer::seed_t seed = std::nullopt);
 
+    // diagonal of the bounding box of the layout, the current layout area of the randomizers below
+    double layout_area_diameter(const acmacs::Layout& layout);
+
     std::shared_ptr<LayoutRandomizer> randomizer_plain_with_current_layout_area(const ProjectionModify& projection, double diameter_multiplier, LayoutRandomizer::seed_t seed = std::nullopt);
     std::shared_ptr<LayoutRandomizer> randomizer_border_with_current_layout_area(const ProjectionModify& projection, double diameter_multiplier, const LineSide& line_side, LayoutRandomizer::seed_t seed = std::nullopt);
 
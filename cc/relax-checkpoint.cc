@@ -0,0 +1,76 @@
+#include <filesystem>
+
+#include "acmacs-base/to-json.hh"
+#include "acmacs-base/rjson-v2.hh"
+#include "acmacs-base/read-file.hh"
+#include "acmacs-chart-2/relax-checkpoint.hh"
+
+// ----------------------------------------------------------------------
+
+void acmacs::chart::RelaxCheckpoint::write() const
+{
+    // coordinates of disconnected points are NaN after dimension annealing, they are meaningless and not representable in json,
+    // they are written as 0 and set back to NaN by ChartModify::relax_checkpointed() on resume
+    const auto export_entry = [](const RelaxSelector::entry_t& entry) -> to_json::object {
+        return to_json::object{
+            to_json::key_val{"s", entry.stress},
+            to_json::key_val{"l", to_json::array(entry.layout.data(), entry.layout.data() + entry.layout.size(), [](double val) { return std::isfinite(val) ? val : 0.0; })},
+        };
+    };
+
+    const auto data = fmt::format("{}\n", to_json::object{
+            to_json::key_val{"  version", "relax-checkpoint-v2"},
+            to_json::key_val{"dimensions", *number_of_dimensions},
+            to_json::key_val{"minimum_column_basis", minimum_column_basis},
+            to_json::key_val{"optimization_method", optimization_method},
+            to_json::key_val{"dimension_annealing", dimension_annealing},
+            to_json::key_val{"antigens", number_of_antigens},
+            to_json::key_val{"sera", number_of_sera},
+            to_json::key_val{"titers", number_of_titers},
+            to_json::key_val{"seed", static_cast<size_t>(seed)},
+            to_json::key_val{"randomization_diameter", randomization_diameter},
+            to_json::key_val{"completed", completed},
+            to_json::key_val{"best", to_json::array(best.begin(), best.end(), export_entry)},
+        });
+    const auto temp_filename = filename + ".tmp";
+    acmacs::file::write(temp_filename, data);
+    std::filesystem::rename(temp_filename, filename);
+
+} // acmacs::chart::RelaxCheckpoint::write
+
+// ----------------------------------------------------------------------
+
+void acmacs::chart::RelaxCheckpoint::read()
+{
+    try {
+        const auto data = rjson::parse_string(static_cast<std::string>(acmacs::file::read(filename)));
+        if (data["  version"].to<std::string_view>() != "relax-checkpoint-v2")
+            throw std::runtime_error{"unsupported version"};
+        number_of_dimensions = number_of_dimensions_t{data["dimensions"].to<size_t>()};
+        minimum_column_basis = data["minimum_column_basis"].to<double>();
+        optimization_method = data["optimization_method"].to<std::string>();
+        dimension_annealing = data["dimension_annealing"].to<bool>();
+        number_of_antigens = data["antigens"].to<size_t>();
+        number_of_sera = data["sera"].to<size_t>();
+        number_of_titers = data["titers"].to<size_t>();
+        seed = static_cast<std::uint_fast32_t>(data["seed"].to<size_t>());
+        randomization_diameter = data["randomization_diameter"].to<double>();
+        completed = data["completed"].to<size_t>();
+        best.clear();
+        rjson::for_each(data["best"], [this](const rjson::value& entry) {
+            const auto& source = entry["l"];
+            acmacs::Layout layout(source.size() / *number_of_dimensions, number_of_dimensions);
+            rjson::for_each(source, [&layout](const rjson::value& val, size_t index) { layout.data()[index] = val.to<double>(); });
+            best.emplace_back(entry["s"].to<double>(), std::move(layout));
+        });
+    }
+    catch (std::exception& err) {
+        throw std::runtime_error{fmt::format("cannot read relax checkpoint from {}: {}", filename, err.what())};
+    }
+
+} // acmacs::chart::RelaxCheckpoint::read
+
+// ----------------------------------------------------------------------
+/// Local Variables:
+/// eval: (if (fboundp 'eu-rename-buffer) (eu-rename-buffer))
+/// End:
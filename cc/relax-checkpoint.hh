@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "acmacs-base/number-of-dimensions.hh"
+#include "acmacs-chart-2/relax-selector.hh"
+
+// ----------------------------------------------------------------------
+
+namespace acmacs::chart
+{
+    // State of a long ChartModify::relax_checkpointed() run periodically written to a side file,
+    // the run can be resumed after interruption or extended with more optimizations.
+    // Optimization N randomizes its starting layout with seed + N, therefore a resumed run
+    // produces the same results as an uninterrupted one.
+    struct RelaxCheckpoint
+    {
+        RelaxCheckpoint(std::string_view a_filename, size_t a_number_to_keep, size_t a_every) : filename{a_filename}, number_to_keep{a_number_to_keep}, every{a_every} {}
+
+        const std::string filename;
+        const size_t number_to_keep; // number of the best layouts stored
+        const size_t every;          // write checkpoint after every N optimizations
+
+        // parameters of the run, resuming with different ones is refused
+        number_of_dimensions_t number_of_dimensions{0};
+        double minimum_column_basis{0.0};
+        std::string optimization_method;
+        bool dimension_annealing{false};
+        size_t number_of_antigens{0}, number_of_sera{0}, number_of_titers{0}; // chart fingerprint, number_of_titers is number of non dont-care titers
+
+        std::uint_fast32_t seed{0};
+        double randomization_diameter{0.0}; // 0 - not started yet, diameter is obtained by the sample optimization
+        size_t completed{0};                // optimizations [0, completed) are done
+        std::vector<RelaxSelector::entry_t> best; // sorted by stress, coordinates of disconnected points are written as 0
+
+        bool started() const { return randomization_diameter > 0.0; }
+
+        void write() const; // written to a temporary file first and then renamed, interruption during writing does not destroy previous checkpoint
+        void read();        // throws std::runtime_error if file cannot be read or parsed
+    };
+
+} // namespace acmacs::chart
+
+// ----------------------------------------------------------------------
+/// Local Variables:
+/// eval: (if (fboundp 'eu-rename-buffer) (eu-rename-buffer))
+/// End:
@@ -0,0 +1,62 @@
+#include "acmacs-chart-2/relax-selector.hh"
+#include "acmacs-chart-2/procrustes.hh"
+
+// ----------------------------------------------------------------------
+
+bool acmacs::chart::RelaxDistinctMinima::add(double stress, acmacs::Layout&& layout)
+{
+    if (std::isnan(stress)) {
+        std::lock_guard<std::mutex> guard{access_};
+        ++number_of_added_;
+        return false;
+    }
+
+    auto candidate = std::make_shared<const acmacs::Layout>(std::move(layout));
+    size_t checked{0}; // minima_[0..checked) were already compared
+    for (;;) {
+        std::vector<std::pair<size_t, std::shared_ptr<const acmacs::Layout>>> to_compare;
+        {
+            std::lock_guard<std::mutex> guard{access_};
+            for (size_t no = checked; no < minima_.size(); ++no) {
+                if (similar_stress(minima_[no].stress, stress))
+                    to_compare.emplace_back(no, minima_[no].layout);
+            }
+            if (to_compare.empty()) { // nothing added since the last check by other threads: new distinct minimum
+                ++number_of_added_;
+                minima_.emplace_back(stress, candidate);
+                return true;
+            }
+            checked = minima_.size();
+            number_of_procrustes_ += to_compare.size();
+        }
+
+        for (const auto& [no, retained] : to_compare) {
+            if (procrustes_rms(*retained, *candidate, points_to_compare_, procrustes_scaling_t::no) < parameters_.rms_threshold) {
+                std::lock_guard<std::mutex> guard{access_};
+                ++number_of_added_;
+                auto& minimum = minima_[no];
+                ++minimum.hits;
+                if (stress < minimum.stress) {
+                    minimum.stress = stress;
+                    minimum.layout = candidate;
+                }
+                return false;
+            }
+        }
+    }
+
+} // acmacs::chart::RelaxDistinctMinima::add
+
+// ----------------------------------------------------------------------
+
+std::vector<acmacs::chart::RelaxDistinctMinima::minimum_t> acmacs::chart::RelaxDistinctMinima::extract()
+{
+    std::sort(minima_.begin(), minima_.end(), [](const auto& e1, const auto& e2) { return e1.stress < e2.stress; });
+    return std::move(minima_);
+
+} // acmacs::chart::RelaxDistinctMinima::extract
+
+// ----------------------------------------------------------------------
+/// Local Variables:
+/// eval: (if (fboundp 'eu-rename-buffer) (eu-rename-buffer))
+/// End:
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+
+#include "acmacs-base/layout.hh"
+#include "acmacs-chart-2/common.hh"
+
+// ----------------------------------------------------------------------
+
+namespace acmacs::chart
+{
+    // Collects results of parallel rough optimizations keeping just
+    // number_to_keep layouts with the lowest stress (used by ChartModify::relax_rough_fine)
+    class RelaxSelector
+    {
+      public:
+        struct entry_t
+        {
+            entry_t(double a_stress, acmacs::Layout&& a_layout) : stress{a_stress}, layout{std::move(a_layout)} {}
+            double stress;
+            acmacs::Layout layout;
+        };
+
+        explicit RelaxSelector(size_t number_to_keep) : number_to_keep_{number_to_keep} { entries_.reserve(number_to_keep); }
+
+        // thread safe, returns if layout was retained
+        bool add(double stress, acmacs::Layout&& layout)
+        {
+            std::lock_guard<std::mutex> guard{access_};
+            ++number_of_added_;
+            if (std::isnan(stress) || number_to_keep_ == 0)
+                return false;
+            if (entries_.size() < number_to_keep_) {
+                entries_.emplace_back(stress, std::move(layout));
+                std::push_heap(entries_.begin(), entries_.end(), worst_on_top);
+                return true;
+            }
+            if (stress < entries_.front().stress) {
+                std::pop_heap(entries_.begin(), entries_.end(), worst_on_top);
+                entries_.back() = entry_t{stress, std::move(layout)};
+                std::push_heap(entries_.begin(), entries_.end(), worst_on_top);
+                return true;
+            }
+            return false;
+        }
+
+        // worst retained stress, layouts having bigger stress are not going to be retained
+        double threshold() const
+        {
+            std::lock_guard<std::mutex> guard{access_};
+            return entries_.size() < number_to_keep_ ? std::numeric_limits<double>::max() : entries_.front().stress;
+        }
+
+        size_t number_of_added() const { return number_of_added_; }
+
+        // not thread safe, copy of the retained entries sorted by stress (e.g. for checkpointing between parallel batches)
+        std::vector<entry_t> sorted() const
+        {
+            auto result = entries_;
+            std::sort(result.begin(), result.end(), worst_on_top);
+            return result;
+        }
+
+        // not thread safe, call after all optimizations finished, returns entries sorted by stress
+        std::vector<entry_t> extract()
+        {
+            std::sort_heap(entries_.begin(), entries_.end(), worst_on_top);
+            return std::move(entries_);
+        }
+
+      private:
+        const size_t number_to_keep_;
+        std::vector<entry_t> entries_; // max-heap by stress, i.e. the worst retained on top
+        size_t number_of_added_{0};
+        mutable std::mutex access_;
+
+        static bool worst_on_top(const entry_t& e1, const entry_t& e2) { return e1.stress < e2.stress; }
+
+    }; // class RelaxSelector
+
+    // ----------------------------------------------------------------------
+
+    // Online clustering of optimization results (used by ChartModify::relax_distinct):
+    // a layout is a duplicate of a retained minimum if their stresses are similar
+    // and procrustes rms (without scaling) between them is below threshold.
+    // Duplicates just increase hit count of the matching minimum.
+    class RelaxDistinctMinima
+    {
+      public:
+        struct parameters_t
+        {
+            double rms_threshold{0.05};             // procrustes rms in map units
+            double relative_stress_tolerance{1e-2}; // layouts with bigger stress difference are not compared by procrustes
+        };
+
+        struct minimum_t
+        {
+            minimum_t(double a_stress, std::shared_ptr<const acmacs::Layout> a_layout) : stress{a_stress}, layout{a_layout} {}
+            double stress;
+            std::shared_ptr<const acmacs::Layout> layout; // layout with the lowest stress among hits
+            size_t hits{1};
+        };
+
+        // points_to_compare: connected points (primary == secondary), disconnected ones have random coordinates
+        RelaxDistinctMinima(const std::vector<CommonAntigensSera::common_t>& points_to_compare, const parameters_t& parameters) : points_to_compare_{points_to_compare}, parameters_{parameters} {}
+
+        // thread safe, procrustes is computed outside of the lock, returns if layout was retained as a new distinct minimum
+        bool add(double stress, acmacs::Layout&& layout);
+
+        size_t number_of_added() const { return number_of_added_; }
+        size_t number_of_procrustes() const { return number_of_procrustes_; }
+
+        // not thread safe, call after all optimizations finished, returns minima sorted by stress
+        std::vector<minimum_t> extract();
+
+      private:
+        const std::vector<CommonAntigensSera::common_t> points_to_compare_;
+        const parameters_t parameters_;
+        std::vector<minimum_t> minima_;
+        size_t number_of_added_{0};
+        size_t number_of_procrustes_{0};
+        mutable std::mutex access_;
+
+        bool similar_stress(double s1, double s2) const { return std::abs(s1 - s2) <= parameters_.relative_stress_tolerance * std::max(s1, s2); }
+
+    }; // class RelaxDistinctMinima
+
+} // namespace acmacs::chart
+
+// ----------------------------------------------------------------------
+/// Local Variables:
+/// eval: (if (fboundp 'eu-rename-buffer) (eu-rename-buffer))
+/// End:
@@ -286,11 +286,11 @@ static void update_list(const rjson::value& data, acmacs::chart::TableDistances&
 {
     const auto logged_adjusts = parameters.avidity_adjusts.logged(number_of_points);
     for (auto p1 : acmacs::range(data.size())) {
-        if (!parameters.disconnected.contains(p1)) {
+        if (!parameters.is_disconnected(p1)) {
             const auto& row = data[p1];
             for (auto serum_no : acmacs::range(row.size())) {
                 const auto p2 = serum_no + data.size();
-                if (!parameters.disconnected.contains(p2)) {
+                if (!parameters.is_disconnected(p2)) {
                     table_distances.update(acmacs::chart::Titer{row[serum_no].to<std::string_view>()}, p1, p2, column_bases.column_basis(serum_no), logged_adjusts[p1] + logged_adjusts[p2], parameters.mult);
                 }
             }
@@ -303,11 +303,11 @@ static void update_dict(const rjson::value& data, acmacs::chart::TableDistances&
 {
     const auto logged_adjusts = parameters.avidity_adjusts.logged(number_of_points);
     for (auto p1 : acmacs::range(data.size())) {
-        if (!parameters.disconnected.contains(p1)) {
+        if (!parameters.is_disconnected(p1)) {
             rjson::for_each(data[p1], [num_antigens=data.size(),p1,&parameters,&table_distances,&column_bases,&logged_adjusts](std::string_view field_name, const rjson::value& field_value) {
                 const auto serum_no = std::stoul(field_name);
                 const auto p2 = serum_no + num_antigens;
-                if (!parameters.disconnected.contains(p2))
+                if (!parameters.is_disconnected(p2))
                     table_distances.update(acmacs::chart::Titer{field_value.to<std::string_view>()}, p1, p2, column_bases.column_basis(serum_no), logged_adjusts[p1] + logged_adjusts[p2], parameters.mult);
             });
         }
@@ -1,6 +1,7 @@
 #include <cmath>
 
 #include "acmacs-base/layout.hh"
+#include "acmacs-base/omp.hh"
 #include "acmacs-chart-2/serum-circle.hh"
 #include "acmacs-chart-2/point-index-list.hh"
 #include "acmacs-chart-2/chart.hh"
@@ -75,13 +76,14 @@ const char* acmacs::chart::detail::SerumCirclePerAntigen::report_reason() const
 class TiterDistance
 {
   public:
-    TiterDistance(acmacs::chart::Titer aTiter, double aColumnBase, double aDistance)
-        : titer(aTiter), similarity(aTiter.is_dont_care() ? 0.0 : aTiter.logged_for_column_bases()), final_similarity(std::min(aColumnBase, similarity)), distance(aDistance)
+    TiterDistance(size_t aAntigenNo, acmacs::chart::Titer aTiter, double aColumnBase, double aDistance)
+        : antigen_no(aAntigenNo), titer(aTiter), similarity(aTiter.is_dont_care() ? 0.0 : aTiter.logged_for_column_bases()), final_similarity(std::min(aColumnBase, similarity)), distance(aDistance)
     {
     }
-    TiterDistance() : similarity(0), final_similarity(0), distance(std::numeric_limits<double>::quiet_NaN()) {}
+    TiterDistance() : antigen_no(0), similarity(0), final_similarity(0), distance(std::numeric_limits<double>::quiet_NaN()) {}
     operator bool() const { return !titer.is_dont_care() && !std::isnan(distance); }
 
+    size_t antigen_no;
     acmacs::chart::Titer titer;
     double similarity;
     double final_similarity;
@@ -90,6 +92,76 @@ class TiterDistance
 
 // ----------------------------------------------------------------------
 
+// titers_and_distances: valid entries only, sorted by distance, closest first
+// Candidate radii are non-decreasing, antigens inside the circle are counted by a
+// moving boundary in the sorted list and protected ones by prefix sums, i.e. O(n).
+static double serum_circle_empirical_radius(const std::vector<TiterDistance>& titers_and_distances, double protection_boundary_titer, acmacs::verbose verbose)
+{
+    std::vector<size_t> protected_prefix(titers_and_distances.size() + 1, 0); // number of protected antigens among the first n
+    for (size_t no = 0; no < titers_and_distances.size(); ++no) {
+        const auto& protection_data = titers_and_distances[no];
+        const bool protectd =
+            protection_data.titer.is_regular() ? protection_data.final_similarity >= protection_boundary_titer : protection_data.final_similarity > protection_boundary_titer;
+        protected_prefix[no + 1] = protected_prefix[no] + (protectd ? 1 : 0);
+    }
+    const auto total_protected = protected_prefix.back();
+
+    constexpr const size_t None = static_cast<size_t>(-1);
+    size_t best_sum = None;
+    double sum_radii = 0;
+    size_t num_radii = 0;
+    size_t inside = 0; // number of antigens with distance <= radius
+    if (verbose == acmacs::verbose::yes)
+        fmt::print(stderr, ">>> AG   radius    dist  protected-outside     not-protected-inside  sum   best-sum\n                         theoretically only      empirically only\n");
+    for (size_t no = 0; no < titers_and_distances.size(); ++no) {
+        const double radius = no == 0 ? titers_and_distances[no].distance : (titers_and_distances[no].distance + titers_and_distances[no - 1].distance) / 2.0;
+        while (inside < titers_and_distances.size() && titers_and_distances[inside].distance <= radius)
+            ++inside;
+        const size_t protected_outside = total_protected - protected_prefix[inside], not_protected_inside = inside - protected_prefix[inside];
+        const size_t summa = protected_outside + not_protected_inside;
+        if (best_sum == None || best_sum >= summa) { // if sums are the same, choose the smaller radius (found earlier)
+            if (best_sum == summa) {
+                sum_radii += radius;
+                ++num_radii;
+            }
+            else {
+                sum_radii = radius;
+                num_radii = 1;
+                best_sum = summa;
+            }
+        }
+        if (verbose == acmacs::verbose::yes)
+            fmt::print(stderr, "  {:4d}  {:7.4f}  {:7.4f}       {:3d}                  {:3d}              {:3d}   {:3d}\n", titers_and_distances[no].antigen_no, radius, titers_and_distances[no].distance, protected_outside, not_protected_inside, summa, best_sum);
+    }
+    return sum_radii / static_cast<double>(num_radii);
+
+} // serum_circle_empirical_radius
+
+// ----------------------------------------------------------------------
+
+// returns nullopt and sets per_antigen.failure_reason if circle cannot be calculated
+static std::optional<double> serum_circle_protection_boundary_titer(acmacs::chart::detail::SerumCirclePerAntigen& per_antigen, const acmacs::Layout& layout, size_t serum_point_no, double column_basis, double fold)
+{
+    using namespace acmacs::chart;
+    if (!layout.point_has_coordinates(serum_point_no)) {
+        per_antigen.failure_reason = serum_circle_failure_reason::serum_disconnected;
+        return std::nullopt;
+    }
+    if (!layout.point_has_coordinates(per_antigen.antigen_no)) {
+        per_antigen.failure_reason = serum_circle_failure_reason::antigen_disconnected;
+        return std::nullopt;
+    }
+    const double protection_boundary_titer = std::min(column_basis, per_antigen.titer.logged_for_column_bases()) - fold; // fixed to support forced homologous titer
+    if (protection_boundary_titer < 1.0) {
+        per_antigen.failure_reason = serum_circle_failure_reason::titer_too_low;
+        return std::nullopt;
+    }
+    return protection_boundary_titer;
+
+} // serum_circle_protection_boundary_titer
+
+// ----------------------------------------------------------------------
+
 // Description of empirical radius calculation found in my message to Derek 2015-09-21 12:03 Subject: Serum protection radius
 //
 // Program "draws" some circle around a serum with some radius. Then for
@@ -128,103 +200,33 @@ void acmacs::chart::detail::serum_circle_empirical(const SerumCircle& circle_dat
         AD_INFO("======================================================================");
     }
 
-    if (!layout.point_has_coordinates(circle_data.serum_no() + titers.number_of_antigens())) {
-        per_antigen.failure_reason = serum_circle_failure_reason::serum_disconnected;
-        return;
-    }
-    if (!layout.point_has_coordinates(per_antigen.antigen_no)) {
-        per_antigen.failure_reason = serum_circle_failure_reason::antigen_disconnected;
+    const auto protection_boundary = serum_circle_protection_boundary_titer(per_antigen, layout, circle_data.serum_no() + titers.number_of_antigens(), circle_data.column_basis(), fold);
+    if (!protection_boundary.has_value())
         return;
-    }
-
-    std::vector<TiterDistance> titers_and_distances(titers.number_of_antigens());
-    size_t max_titer_for_serum_ag_no = 0;
-    for (size_t ag_no = 0; ag_no < titers.number_of_antigens(); ++ag_no) {
-        const auto titer = titers.titer(ag_no, circle_data.serum_no());
-        if (!titer.is_dont_care()) {
-            // TODO: antigensSeraTitersMultipliers (acmacs/plot/serum_circle.py:113)
-            titers_and_distances[ag_no] = TiterDistance(titer, circle_data.column_basis(), layout.distance(ag_no, circle_data.serum_no() + titers.number_of_antigens()));
-            if (max_titer_for_serum_ag_no != ag_no && titers_and_distances[max_titer_for_serum_ag_no].final_similarity < titers_and_distances[ag_no].final_similarity)
-                max_titer_for_serum_ag_no = ag_no;
-        }
-        // else if (ag_no == per_antigen.antigen_no)
-        //     throw serum_circle_radius_calculation_error("no homologous titer");
-    }
-    // const double protection_boundary_titer = titers_and_distances[per_antigen.antigen_no].final_similarity - fold;
-    const double protection_boundary_titer = std::min(circle_data.column_basis(), per_antigen.titer.logged_for_column_bases()) - fold; // fixed to support forced homologous titer
-    if (protection_boundary_titer < 1.0) {
-        per_antigen.failure_reason = serum_circle_failure_reason::titer_too_low;
-        return;
-    }
-
+    const double protection_boundary_titer = *protection_boundary;
     if (verbose == acmacs::verbose::yes)
         AD_INFO("serum_circle_radius_empirical protection_boundary_titer: {}", protection_boundary_titer);
 
-    // sort antigen indices by antigen distance from serum, closest first
-    auto antigens_by_distances_sorting = [&titers_and_distances](size_t a, size_t b) -> bool {
-        const auto& aa = titers_and_distances[a];
-        if (aa) {
-            const auto& bb = titers_and_distances[b];
-            return bb ? aa.distance < bb.distance : true;
+    std::vector<TiterDistance> titers_and_distances;
+    for (size_t ag_no = 0; ag_no < titers.number_of_antigens(); ++ag_no) {
+        // TODO: antigensSeraTitersMultipliers (acmacs/plot/serum_circle.py:113)
+        if (const auto titer = titers.titer(ag_no, circle_data.serum_no()); !titer.is_dont_care()) {
+            if (const TiterDistance titer_distance(ag_no, titer, circle_data.column_basis(), layout.distance(ag_no, circle_data.serum_no() + titers.number_of_antigens())); titer_distance)
+                titers_and_distances.push_back(titer_distance);
+            else if (verbose == acmacs::verbose::yes)
+                fmt::print(stderr, " AG {:4d} disconnected  {:>6s}\n", ag_no, titer);
         }
-        else
-            return false;
-    };
-    PointIndexList antigens_by_distances(acmacs::index_iterator(0UL), acmacs::index_iterator(titers.number_of_antigens()));
-    std::sort(antigens_by_distances.begin(), antigens_by_distances.end(), antigens_by_distances_sorting);
+    }
+    // sort antigens by distance from serum, closest first
+    std::sort(titers_and_distances.begin(), titers_and_distances.end(), [](const auto& e1, const auto& e2) { return e1.distance < e2.distance; });
     if (verbose == acmacs::verbose::yes) {
         AD_INFO("antigens_by_distances");
         fmt::print(stderr, "  AG    distance   titer   simil   fsimil\n");
-        for (auto ag_no : antigens_by_distances) {
-            if (titers_and_distances[ag_no])
-                fmt::print(stderr, " {:4d}   {:7.4f}  {:>6s}     {:4.2f}    {:4.2f}\n", ag_no, titers_and_distances[ag_no].distance, titers_and_distances[ag_no].titer, titers_and_distances[ag_no].similarity, titers_and_distances[ag_no].final_similarity);
-            else if (!titers_and_distances[ag_no].titer.is_dont_care())
-                fmt::print(stderr, " {:4d}   disconn  {:>6s}     {:4.2f}    {:4.2f}\n", ag_no, titers_and_distances[ag_no].titer, titers_and_distances[ag_no].similarity, titers_and_distances[ag_no].final_similarity);
-        }
+        for (const auto& entry : titers_and_distances)
+            fmt::print(stderr, " {:4d}   {:7.4f}  {:>6s}     {:4.2f}    {:4.2f}\n", entry.antigen_no, entry.distance, entry.titer, entry.similarity, entry.final_similarity);
     }
 
-    constexpr const size_t None = static_cast<size_t>(-1);
-    size_t best_sum = None;
-    size_t previous = None;
-    double sum_radii = 0;
-    size_t num_radii = 0;
-    if (verbose == acmacs::verbose::yes)
-        fmt::print(stderr, ">>> AG   radius    dist  protected-outside     not-protected-inside  sum   best-sum\n                         theoretically only      empirically only\n");
-    for (size_t ag_no : antigens_by_distances) {
-        if (!titers_and_distances[ag_no])
-            break;
-        if (titers_and_distances[ag_no]) {
-            const double radius = previous == None ? titers_and_distances[ag_no].distance : (titers_and_distances[ag_no].distance + titers_and_distances[previous].distance) / 2.0;
-            size_t protected_outside = 0, not_protected_inside = 0; // , protected_inside = 0, not_protected_outside = 0;
-            for (const auto& protection_data : titers_and_distances) {
-                if (protection_data) {
-                    const bool inside = protection_data.distance <= radius;
-                    const bool protectd =
-                        protection_data.titer.is_regular() ? protection_data.final_similarity >= protection_boundary_titer : protection_data.final_similarity > protection_boundary_titer;
-                    if (protectd && !inside)
-                        ++protected_outside;
-                    else if (!protectd && inside)
-                        ++not_protected_inside;
-                }
-            }
-            const size_t summa = protected_outside + not_protected_inside;
-            if (best_sum == None || best_sum >= summa) { // if sums are the same, choose the smaller radius (found earlier)
-                if (best_sum == summa) {
-                    sum_radii += radius;
-                    ++num_radii;
-                }
-                else {
-                    sum_radii = radius;
-                    num_radii = 1;
-                    best_sum = summa;
-                }
-            }
-            if (verbose == acmacs::verbose::yes)
-                fmt::print(stderr, "  {:4d}  {:7.4f}  {:7.4f}       {:3d}                  {:3d}              {:3d}   {:3d}\n", ag_no, radius, titers_and_distances[ag_no].distance, protected_outside, not_protected_inside, summa, best_sum);
-            previous = ag_no;
-        }
-    }
-    per_antigen.radius = sum_radii / static_cast<double>(num_radii);
+    per_antigen.radius = serum_circle_empirical_radius(titers_and_distances, protection_boundary_titer, verbose);
     if (verbose == acmacs::verbose::yes)
         fmt::print(stderr, "\n>>> Radius: {}\n\n", *per_antigen.radius);
 
@@ -370,6 +372,51 @@ acmacs::chart::SerumCircle acmacs::chart::serum_circle_theoretical(const PointIn
 
 // ----------------------------------------------------------------------
 
+std::vector<acmacs::chart::SerumCirclesForSerum> acmacs::chart::serum_circles(const Chart& chart, size_t projection_no, double fold, [[maybe_unused]] int threads)
+{
+    const auto layout = chart.projection(projection_no)->layout();
+    const auto titers = chart.titers();
+    const auto sera = chart.sera();
+    const auto number_of_antigens = chart.number_of_antigens(), number_of_sera = chart.number_of_sera();
+
+    std::vector<double> column_bases(number_of_sera);
+    std::vector<PointIndexList> homologous_antigens(number_of_sera);
+    std::vector<std::vector<TiterDistance>> titers_and_distances(number_of_sera); // valid entries for each serum, sorted by distance
+    for (size_t sr_no = 0; sr_no < number_of_sera; ++sr_no) {
+        column_bases[sr_no] = chart.column_basis(sr_no, projection_no);
+        homologous_antigens[sr_no] = (*sera)[sr_no]->homologous_antigens();
+    }
+    // one pass over titers
+    for (const auto& titer_ref : titers->titers_existing()) {
+        if (const TiterDistance titer_distance(titer_ref.antigen, titer_ref.titer, column_bases[titer_ref.serum], layout->distance(titer_ref.antigen, titer_ref.serum + number_of_antigens)); titer_distance)
+            titers_and_distances[titer_ref.serum].push_back(titer_distance);
+    }
+
+    std::vector<SerumCirclesForSerum> result(number_of_sera);
+#pragma omp parallel for default(none) shared(result, titers_and_distances, homologous_antigens, column_bases, layout, titers, number_of_antigens, number_of_sera, fold) num_threads(threads <= 0 ? omp_get_max_threads() : threads) schedule(dynamic)
+    for (size_t sr_no = 0; sr_no < number_of_sera; ++sr_no) {
+        auto& sorted = titers_and_distances[sr_no];
+        std::sort(sorted.begin(), sorted.end(), [](const auto& e1, const auto& e2) { return e1.distance < e2.distance; });
+        auto& for_serum = result[sr_no];
+        for_serum.serum_no = sr_no;
+        for (const auto ag_no : homologous_antigens[sr_no]) {
+            const auto homologous_titer = titers->titer(ag_no, sr_no);
+            auto& theoretical = for_serum.theoretical.emplace_back(ag_no, sr_no, column_bases[sr_no], homologous_titer, fold);
+            if (theoretical.failure_reason() == serum_circle_failure_reason::not_calculated)
+                detail::serum_circle_theoretical(theoretical, theoretical.per_antigen_.front(), fold);
+            auto& empirical = for_serum.empirical.emplace_back(ag_no, sr_no, column_bases[sr_no], homologous_titer, fold);
+            if (auto& per_antigen = empirical.per_antigen_.front(); per_antigen.failure_reason == serum_circle_failure_reason::not_calculated) {
+                if (const auto protection_boundary = serum_circle_protection_boundary_titer(per_antigen, *layout, sr_no + number_of_antigens, column_bases[sr_no], fold); protection_boundary.has_value())
+                    per_antigen.radius = serum_circle_empirical_radius(sorted, *protection_boundary, acmacs::verbose::no);
+            }
+        }
+    }
+    return result;
+
+} // acmacs::chart::serum_circles
+
+// ----------------------------------------------------------------------
+
 acmacs::chart::SerumCoverageIndexes acmacs::chart::serum_coverage(const Titers& titers, Titer homologous_titer, size_t serum_no, double fold)
 {
     if (!homologous_titer.is_regular())
@@ -15,6 +15,7 @@ namespace acmacs::chart
 {
     class SerumCircle;
     class Chart;
+    struct SerumCirclesForSerum;
 
     enum class serum_circle_failure_reason { not_calculated, non_regular_homologous_titer, titer_too_low, serum_disconnected, antigen_disconnected };
 
@@ -100,6 +101,7 @@ namespace acmacs::chart
         friend SerumCircle serum_circle_theoretical(size_t antigen_no, size_t serum_no, double column_basis, const Titers& titers, double fold);
         friend SerumCircle serum_circle_empirical(const PointIndexList& antigens, size_t serum_no, const Layout& layout, double column_basis, const Titers& titers, double fold, acmacs::verbose verbose);
         friend SerumCircle serum_circle_theoretical(const PointIndexList& antigens, size_t serum_no, double column_basis, const Titers& titers, double fold);
+        friend std::vector<SerumCirclesForSerum> serum_circles(const Chart& chart, size_t projection_no, double fold, int threads);
     };
 
     SerumCircle serum_circle_empirical(const PointIndexList& antigens, Titer homologous_titer, size_t serum_no, const Chart& chart, size_t aProjectionNo, double fold = 2.0, acmacs::verbose verbose = acmacs::verbose::no);
@@ -117,6 +119,17 @@ namespace acmacs::chart
     SerumCircle serum_circle_empirical(const PointIndexList& antigens, size_t serum_no, const Layout& layout, double column_basis, const Titers& titers, double fold = 2.0, acmacs::verbose verbose = acmacs::verbose::no);
     SerumCircle serum_circle_theoretical(const PointIndexList& antigens, size_t serum_no, double column_basis, const Titers& titers, double fold = 2.0);
 
+    // Empirical and theoretical circles for all homologous antigens (Chart::set_homologous must be called before) of all sera.
+    // Titers are read in one pass, distances from a serum are sorted once and shared by its homologous antigens, sera are processed in parallel.
+    struct SerumCirclesForSerum
+    {
+        size_t serum_no;
+        std::vector<SerumCircle> empirical;   // in the order of serum->homologous_antigens()
+        std::vector<SerumCircle> theoretical; // in the order of serum->homologous_antigens()
+    };
+
+    std::vector<SerumCirclesForSerum> serum_circles(const Chart& chart, size_t projection_no, double fold = 2.0, int threads = 0);
+
     // ----------------------------------------------------------------------
 
     class serum_coverage_error : public std::runtime_error
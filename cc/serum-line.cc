@@ -6,16 +6,21 @@
 // ----------------------------------------------------------------------
 
 acmacs::chart::SerumLine::SerumLine(const Projection& projection)
+    : SerumLine(*projection.layout(), projection.chart().number_of_antigens())
 {
-    auto layout = projection.layout();
-    if (layout->number_of_dimensions() != number_of_dimensions_t{2})
-        throw std::runtime_error("invalid number of dimensions in projection: " + acmacs::to_string(layout->number_of_dimensions()) + ", only 2 is supported");
+} // acmacs::chart::SerumLine::SerumLine
+
+// ----------------------------------------------------------------------
 
-    const auto number_of_antigens = projection.chart().number_of_antigens();
-    line_ = acmacs::statistics::simple_linear_regression(layout->begin_sera_dimension(number_of_antigens, number_of_dimensions_t{0}), layout->end_sera_dimension(number_of_antigens, number_of_dimensions_t{0}), layout->begin_sera_dimension(number_of_antigens, number_of_dimensions_t{1}));
+acmacs::chart::SerumLine::SerumLine(const acmacs::Layout& layout, size_t number_of_antigens)
+{
+    if (layout.number_of_dimensions() != number_of_dimensions_t{2})
+        throw std::runtime_error("invalid number of dimensions in projection: " + acmacs::to_string(layout.number_of_dimensions()) + ", only 2 is supported");
+
+    line_ = acmacs::statistics::simple_linear_regression(layout.begin_sera_dimension(number_of_antigens, number_of_dimensions_t{0}), layout.end_sera_dimension(number_of_antigens, number_of_dimensions_t{0}), layout.begin_sera_dimension(number_of_antigens, number_of_dimensions_t{1}));
 
     std::vector<double> distances;
-    std::transform(layout->begin_sera(number_of_antigens), layout->end_sera(number_of_antigens), std::back_inserter(distances),
+    std::transform(layout.begin_sera(number_of_antigens), layout.end_sera(number_of_antigens), std::back_inserter(distances),
                    [this](const auto& coord) { return this->line_.distance_to(coord); });
     standard_deviation_ = acmacs::statistics::standard_deviation(distances.begin(), distances.end()).population_sd();
 
@@ -24,11 +29,18 @@ acmacs::chart::SerumLine::SerumLine(const Projection& projection)
 // ----------------------------------------------------------------------
 
 acmacs::chart::SerumLine::AntigensRelativeToLine acmacs::chart::SerumLine::antigens_relative_to_line(const Projection& projection) const
+{
+    return antigens_relative_to_line(*projection.layout(), projection.chart().number_of_antigens());
+
+} // acmacs::chart::SerumLine::antigens_relative_to_line
+
+// ----------------------------------------------------------------------
+
+acmacs::chart::SerumLine::AntigensRelativeToLine acmacs::chart::SerumLine::antigens_relative_to_line(const acmacs::Layout& layout, size_t number_of_antigens) const
 {
     acmacs::chart::SerumLine::AntigensRelativeToLine result;
-    auto layout = projection.layout();
-    for (auto antigen_no : acmacs::range(projection.chart().number_of_antigens())) {
-        const auto distance = line().distance_with_direction(layout->at(antigen_no));
+    for (auto antigen_no : acmacs::range(number_of_antigens)) {
+        const auto distance = line().distance_with_direction(layout.at(antigen_no));
         if (distance < 0)
             result.negative.insert(antigen_no);
         else
@@ -5,6 +5,11 @@
 
 // ----------------------------------------------------------------------
 
+namespace acmacs
+{
+    class Layout;
+}
+
 namespace acmacs::chart
 {
     class Projection;
@@ -13,6 +18,7 @@ namespace acmacs::chart
     {
       public:
         SerumLine(const Projection& projection);
+        SerumLine(const acmacs::Layout& layout, size_t number_of_antigens);
 
         struct AntigensRelativeToLine
         {
@@ -20,6 +26,7 @@ namespace acmacs::chart
         };
 
         AntigensRelativeToLine antigens_relative_to_line(const Projection& projection) const;
+        AntigensRelativeToLine antigens_relative_to_line(const acmacs::Layout& layout, size_t number_of_antigens) const;
 
         constexpr const acmacs::LineDefinedByEquation& line() const { return line_; }
         constexpr double standard_deviation() const { return standard_deviation_; }
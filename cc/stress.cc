@@ -49,7 +49,7 @@ acmacs::chart::Stress acmacs::chart::stress_factory(const acmacs::chart::Project
 acmacs::chart::Stress acmacs::chart::stress_factory(const Projection& projection, size_t antigen_no, double logged_avidity_adjust, multiply_antigen_titer_until_column_adjust mult)
 {
     Stress stress(projection, mult);
-    stress.parameters().avidity_adjusts.set_logged(antigen_no, logged_avidity_adjust);
+    stress.set_logged_avidity_adjust(antigen_no, logged_avidity_adjust);
     auto cb = projection.forced_column_bases();
     if (!cb)
         cb = projection.chart().column_bases(projection.minimum_column_basis());
@@ -242,7 +242,7 @@ std::vector<double> acmacs::chart::Stress::gradient(const acmacs::Layout& aLayou
 
 void acmacs::chart::Stress::gradient(const double* first, const double* last, double* gradient_first) const
 {
-    if (parameters_.unmovable->empty() && parameters_.unmovable_in_the_last_dimension->empty())
+    if (parameters_.mobility.empty())
         gradient_plain(first, last, gradient_first);
     else
         gradient_with_unmovable(first, last, gradient_first);
@@ -253,14 +253,17 @@ void acmacs::chart::Stress::gradient(const double* first, const double* last, do
 
 double acmacs::chart::Stress::value_gradient(const double* first, const double* last, double* gradient_first) const
 {
-    gradient(first, last, gradient_first);
-    return value(first, last);
+    // stress value is accumulated in the same pass over table distances as gradient
+    if (parameters_.mobility.empty())
+        return gradient_plain(first, last, gradient_first);
+    else
+        return gradient_with_unmovable(first, last, gradient_first);
 
 } // acmacs::chart::Stress::value_gradient
 
 // ----------------------------------------------------------------------
 
-void acmacs::chart::Stress::gradient_plain(const double* first, const double* last, double* gradient_first) const
+double acmacs::chart::Stress::gradient_plain(const double* first, const double* last, double* gradient_first) const
 {
     std::for_each(gradient_first, gradient_first + (last - first), [](double& val) { val = 0; });
 
@@ -277,69 +280,87 @@ void acmacs::chart::Stress::gradient_plain(const double* first, const double* la
         }
     };
 
-    auto contribution_regular = [first,num_dim=number_of_dimensions_,update](const auto& entry) {
+    double value{0};
+    auto contribution_regular = [first,num_dim=number_of_dimensions_,update,&value](const auto& entry) {
         const double map_dist = ::map_distance(first, entry, num_dim);
-        const double inc_base = (entry.distance - map_dist) * 2 / non_zero(map_dist);
+        const double diff = entry.distance - map_dist;
+        const double inc_base = diff * 2 / non_zero(map_dist);
         update(entry, inc_base);
+        value += diff * diff;
     };
-    auto contribution_less_than = [first,num_dim=number_of_dimensions_,update](const auto& entry) {
+    auto contribution_less_than = [first,num_dim=number_of_dimensions_,update,&value](const auto& entry) {
         const double map_dist = ::map_distance(first, entry, num_dim);
         const double diff = entry.distance - map_dist + 1;
-        const double inc_base = (diff * 2 * acmacs::sigmoid(diff * SigmoidMutiplier())
+        const double sigmoid = acmacs::sigmoid(diff * SigmoidMutiplier());
+        const double inc_base = (diff * 2 * sigmoid
                                 + diff * diff * acmacs::d_sigmoid(diff * SigmoidMutiplier()) * SigmoidMutiplier()) / non_zero(map_dist);
         update(entry, inc_base);
+        value += diff * diff * sigmoid;
     };
 
     std::for_each(table_distances().regular().begin(), table_distances().regular().end(), contribution_regular);
     std::for_each(table_distances().less_than().begin(), table_distances().less_than().end(), contribution_less_than);
+    return value;
 
 } // acmacs::chart::Stress::gradient_plain
 
 // ----------------------------------------------------------------------
 
-void acmacs::chart::Stress::gradient_with_unmovable(const double* first, const double* last, double* gradient_first) const
+double acmacs::chart::Stress::gradient_with_unmovable(const double* first, const double* last, double* gradient_first) const
 {
-    std::vector<bool> unmovable(parameters_.number_of_points, false);
-    for (const auto p_no: parameters_.unmovable)
-        unmovable[p_no] = true;
-    std::vector<bool> unmovable_in_the_last_dimension(parameters_.number_of_points, false);
-    for (const auto p_no: parameters_.unmovable_in_the_last_dimension)
-        unmovable_in_the_last_dimension[p_no] = true;
-
     std::for_each(gradient_first, gradient_first + (last - first), [](double& val) { val = 0; });
 
-    auto update = [first,gradient_first,num_dim=static_cast<size_t>(number_of_dimensions_),&unmovable,&unmovable_in_the_last_dimension](const auto& entry, double inc_base) {
+    // number of leading dimensions in which a point is movable, mobility mask is precomputed in StressParameters
+    const auto num_dimensions = static_cast<size_t>(number_of_dimensions_);
+    const auto movable_dimensions = [num_dimensions, &mobility = parameters_.mobility](size_t point_no) -> size_t {
+        switch (mobility[point_no]) {
+            case StressParameters::mobility_t::movable:
+                return num_dimensions;
+            case StressParameters::mobility_t::unmovable_in_the_last_dimension:
+                return num_dimensions - 1;
+            case StressParameters::mobility_t::unmovable:
+                break;
+        }
+        return 0;
+    };
+
+    auto update = [first,gradient_first,num_dim=num_dimensions,&movable_dimensions](const auto& entry, double inc_base) {
         using diff_t = typename std::vector<double>::difference_type;
-        auto p1f = [p=static_cast<diff_t>(entry.point_1 * num_dim)] (auto b) { return b + p; };
-        auto p2f = [p=static_cast<diff_t>(entry.point_2 * num_dim)] (auto b) { return b + p; };
-        auto p1 = p1f(first);
-        auto r1 = p1f(gradient_first);
-        auto p2 = p2f(first);
-        auto r2 = p2f(gradient_first);
+        auto p1 = first + static_cast<diff_t>(entry.point_1 * num_dim),
+                p2 = first + static_cast<diff_t>(entry.point_2 * num_dim);
+        auto r1 = gradient_first + static_cast<diff_t>(entry.point_1 * num_dim),
+                r2 = gradient_first + static_cast<diff_t>(entry.point_2 * num_dim);
+        const auto movable_1 = movable_dimensions(entry.point_1), movable_2 = movable_dimensions(entry.point_2);
         for (size_t dim = 0; dim < num_dim; ++dim, ++p1, ++p2, ++r1, ++r2) {
             const double inc = inc_base * (*p1 - *p2);
-            if (!unmovable[entry.point_1] && (!unmovable_in_the_last_dimension[entry.point_1] || (dim + 1) < num_dim))
+            if (dim < movable_1)
                 *r1 -= inc;
-            if (!unmovable[entry.point_2] && (!unmovable_in_the_last_dimension[entry.point_2] || (dim + 1) < num_dim))
+            if (dim < movable_2)
                 *r2 += inc;
         }
     };
 
-    auto contribution_regular = [first,num_dim=number_of_dimensions_,update](const auto& entry) {
+    double value{0};
+    auto contribution_regular = [first,num_dim=number_of_dimensions_,update,&value](const auto& entry) {
         const double map_dist = ::map_distance(first, entry, num_dim);
-        const double inc_base = (entry.distance - map_dist) * 2 / non_zero(map_dist);
+        const double diff = entry.distance - map_dist;
+        const double inc_base = diff * 2 / non_zero(map_dist);
         update(entry, inc_base);
+        value += diff * diff;
     };
-    auto contribution_less_than = [first,num_dim=number_of_dimensions_,update](const auto& entry) {
+    auto contribution_less_than = [first,num_dim=number_of_dimensions_,update,&value](const auto& entry) {
         const double map_dist = ::map_distance(first, entry, num_dim);
         const double diff = entry.distance - map_dist + 1;
-        const double inc_base = (diff * 2 * acmacs::sigmoid(diff * SigmoidMutiplier())
+        const double sigmoid = acmacs::sigmoid(diff * SigmoidMutiplier());
+        const double inc_base = (diff * 2 * sigmoid
                                 + diff * diff * acmacs::d_sigmoid(diff * SigmoidMutiplier()) * SigmoidMutiplier()) / non_zero(map_dist);
         update(entry, inc_base);
+        value += diff * diff * sigmoid;
     };
 
     std::for_each(table_distances().regular().begin(), table_distances().regular().end(), contribution_regular);
     std::for_each(table_distances().less_than().begin(), table_distances().less_than().end(), contribution_less_than);
+    return value;
 
 } // acmacs::chart::Stress::gradient_with_unmovable
 
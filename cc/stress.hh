@@ -16,14 +16,33 @@ namespace acmacs::chart
 
     struct StressParameters
     {
+        // per point mobility used by gradient, precomputed from unmovable and unmovable_in_the_last_dimension
+        enum class mobility_t : unsigned char { movable, unmovable, unmovable_in_the_last_dimension };
+
         StressParameters(size_t a_number_of_points, UnmovablePoints&& a_unmovable, DisconnectedPoints&& a_disconnected, UnmovableInTheLastDimensionPoints&& a_unmovable_in_the_last_dimension, multiply_antigen_titer_until_column_adjust a_mult, AvidityAdjusts&& a_avidity_adjusts, dodgy_titer_is_regular a_dodgy_titer_is_regular)
             : number_of_points(a_number_of_points), unmovable(std::move(a_unmovable)), disconnected(std::move(a_disconnected)),
               unmovable_in_the_last_dimension(std::move(a_unmovable_in_the_last_dimension)), mult(a_mult),
-              avidity_adjusts(std::move(a_avidity_adjusts)), dodgy_titer_is_regular(a_dodgy_titer_is_regular) {}
+              avidity_adjusts(std::move(a_avidity_adjusts)), dodgy_titer_is_regular(a_dodgy_titer_is_regular) { update_masks(); }
         StressParameters(size_t a_number_of_points, multiply_antigen_titer_until_column_adjust a_mult, dodgy_titer_is_regular a_dodgy_titer_is_regular)
-            : number_of_points(a_number_of_points), mult(a_mult), dodgy_titer_is_regular(a_dodgy_titer_is_regular) {}
+            : number_of_points(a_number_of_points), mult(a_mult), dodgy_titer_is_regular(a_dodgy_titer_is_regular) { update_masks(); }
         StressParameters(size_t a_number_of_points)
-            : number_of_points(a_number_of_points) {}
+            : number_of_points(a_number_of_points) { update_masks(); }
+
+        // must be called after changing disconnected, unmovable or unmovable_in_the_last_dimension, Stress gives read only access to its parameters and its setters call it
+        void update_masks()
+        {
+            disconnected_set = PointIndexSet{disconnected, number_of_points};
+            mobility.clear();
+            if (!unmovable->empty() || !unmovable_in_the_last_dimension->empty()) {
+                mobility.resize(number_of_points, mobility_t::movable);
+                for (const auto p_no : unmovable_in_the_last_dimension)
+                    mobility.at(p_no) = mobility_t::unmovable_in_the_last_dimension;
+                for (const auto p_no : unmovable)
+                    mobility.at(p_no) = mobility_t::unmovable;
+            }
+        }
+
+        bool is_disconnected(size_t point_no) const { return disconnected_set.contains(point_no); }
 
         size_t number_of_points;
         UnmovablePoints unmovable;
@@ -32,6 +51,8 @@ namespace acmacs::chart
         multiply_antigen_titer_until_column_adjust mult{multiply_antigen_titer_until_column_adjust::yes};
         AvidityAdjusts avidity_adjusts;
         enum dodgy_titer_is_regular dodgy_titer_is_regular{dodgy_titer_is_regular::no};
+        PointIndexSet disconnected_set;  // the same points as disconnected
+        std::vector<mobility_t> mobility; // empty if all points are movable, otherwise size is number_of_points
 
     }; // struct StressParameters
 
@@ -60,13 +81,31 @@ namespace acmacs::chart
         constexpr const TableDistances& table_distances() const { return table_distances_; }
         constexpr TableDistances& table_distances() { return table_distances_; }
         TableDistancesForPoint table_distances_for(size_t point_no) const { return TableDistancesForPoint(point_no, table_distances_); }
+        // read only, masks precomputed in parameters are kept in sync by the setters below
         constexpr const StressParameters& parameters() const { return parameters_; }
-        constexpr StressParameters& parameters() { return parameters_; }
-        void set_disconnected(const DisconnectedPoints& to_disconnect) { parameters_.disconnected = to_disconnect; }
-        void extend_disconnected(const PointIndexList& to_disconnect) { parameters_.disconnected.extend(to_disconnect); }
+        void set_disconnected(const DisconnectedPoints& to_disconnect)
+        {
+            parameters_.disconnected = to_disconnect;
+            parameters_.disconnected_set = PointIndexSet{to_disconnect, parameters_.number_of_points};
+        }
+        void extend_disconnected(const PointIndexList& to_disconnect)
+        {
+            parameters_.disconnected.extend(to_disconnect);
+            parameters_.disconnected_set.extend(to_disconnect);
+        }
         size_t number_of_disconnected() const { return parameters_.disconnected.size(); }
-        void set_unmovable(const UnmovablePoints& unmovable) { parameters_.unmovable = unmovable; }
-        void set_unmovable_in_the_last_dimension(const UnmovableInTheLastDimensionPoints& unmovable_in_the_last_dimension) { parameters_.unmovable_in_the_last_dimension = unmovable_in_the_last_dimension; }
+        void set_unmovable(const UnmovablePoints& unmovable)
+        {
+            parameters_.unmovable = unmovable;
+            parameters_.update_masks();
+        }
+        void set_unmovable_in_the_last_dimension(const UnmovableInTheLastDimensionPoints& unmovable_in_the_last_dimension)
+        {
+            parameters_.unmovable_in_the_last_dimension = unmovable_in_the_last_dimension;
+            parameters_.update_masks();
+        }
+
+        void set_logged_avidity_adjust(size_t point_no, double logged_avidity_adjust) { parameters_.avidity_adjusts.set_logged(point_no, logged_avidity_adjust); }
 
         void set_coordinates_of_disconnected(double* first, size_t num_args, double value, number_of_dimensions_t number_of_dimensions) const;
 
@@ -75,8 +114,9 @@ namespace acmacs::chart
         TableDistances table_distances_;
         StressParameters parameters_;
 
-        void gradient_plain(const double* first, const double* last, double* gradient_first) const;
-        void gradient_with_unmovable(const double* first, const double* last, double* gradient_first) const;
+        // return stress value computed in the same pass
+        double gradient_plain(const double* first, const double* last, double* gradient_first) const;
+        double gradient_with_unmovable(const double* first, const double* last, double* gradient_first) const;
 
     }; // class Stress
 
@@ -104,6 +104,52 @@ namespace acmacs::chart
             }
         }
 
+        // positions of the entries of a point in regular() and less_than()
+        struct EntryIndexes
+        {
+            std::vector<size_t> regular, less_than;
+        };
+
+        // for each point, single pass over entries
+        std::vector<EntryIndexes> entry_indexes(size_t number_of_points) const
+        {
+            std::vector<EntryIndexes> result(number_of_points);
+            for (size_t index = 0; index < regular().size(); ++index) {
+                result[regular()[index].point_1].regular.push_back(index);
+                result[regular()[index].point_2].regular.push_back(index);
+            }
+            for (size_t index = 0; index < less_than().size(); ++index) {
+                result[less_than()[index].point_1].less_than.push_back(index);
+                result[less_than()[index].point_2].less_than.push_back(index);
+            }
+            return result;
+        }
+
+        void apply_mult(multiply_antigen_titer_until_column_adjust mult)
+        {
+            if (mult == multiply_antigen_titer_until_column_adjust::yes) {
+                for (auto* entries : {&regular(), &less_than()}) {
+                    for (auto& entry : *entries)
+                        entry.distance = std::max(entry.distance, 0.0);
+                }
+            }
+        }
+
+        // in-place change of the avidity adjust of a point (avidity test): entries at indexes are set from unadjusted (table distances computed with
+        // multiply_antigen_titer_until_column_adjust::no) minus logged_adjust_diff, then mult is applied to them. logged_adjust_diff == 0 restores entries.
+        void set_logged_adjust(const EntryIndexes& indexes, const TableDistances& unadjusted, double logged_adjust_diff, multiply_antigen_titer_until_column_adjust mult)
+        {
+            const auto update = [logged_adjust_diff, mult](entries_t& target, const entries_t& source, const std::vector<size_t>& positions) {
+                for (const auto index : positions) {
+                    target[index].distance = source[index].distance - logged_adjust_diff;
+                    if (target[index].distance < 0 && mult == multiply_antigen_titer_until_column_adjust::yes)
+                        target[index].distance = 0;
+                }
+            };
+            update(regular(), unadjusted.regular(), indexes.regular);
+            update(less_than(), unadjusted.less_than(), indexes.less_than);
+        }
+
         // void report() const { std::cerr << "TableDistances regular: " << regular().size() << "  less-than: " << less_than().size() << '\n'; }
 
         struct EntryForPoint
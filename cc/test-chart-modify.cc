@@ -25,6 +25,7 @@ static void test_insert_serum(acmacs::chart::ChartP chart, size_t before, const
 static void test_insert_remove_antigen(acmacs::chart::ChartP chart, size_t before, const argc_argv& args, report_time report);
 static void test_insert_remove_serum(acmacs::chart::ChartP chart, size_t before, const argc_argv& args, report_time report);
 static void test_extensions(acmacs::chart::ChartP chart, const argc_argv& args, report_time report);
+static std::vector<acmacs::Indexes> multiple_indexes_to_remove(size_t number_of);
 
 enum class compare_titers { no, yes };
 static void compare_antigens(acmacs::chart::ChartP chart_source, size_t source_ag_no, acmacs::chart::AntigenP source_antigen, acmacs::chart::ChartP chart_imported, size_t imported_ag_no, compare_titers ct);
@@ -84,9 +85,13 @@ int main(int argc, char* const argv[])
             std::cout << "  test_remove_antigens\n";
             for (auto ag_no : antigens_to_test)
                 test_remove_antigens(chart, {ag_no}, args, report);
+            for (const auto& indexes : multiple_indexes_to_remove(chart->number_of_antigens()))
+                test_remove_antigens(chart, indexes, args, report);
             std::cout << "  test_remove_sera\n";
             for (auto sr_no : sera_to_test)
                 test_remove_sera(chart, {sr_no}, args, report);
+            for (const auto& indexes : multiple_indexes_to_remove(chart->number_of_sera()))
+                test_remove_sera(chart, indexes, args, report);
             std::cout << "  test_extensions\n";
             test_extensions(chart, args, report);
         }
@@ -342,6 +347,27 @@ void test_remove_sera(acmacs::chart::ChartP chart, const acmacs::Indexes& indexe
 
 // ----------------------------------------------------------------------
 
+// adjacent, first and last, scattered (chart must have at least 5 antigens/sera)
+std::vector<acmacs::Indexes> multiple_indexes_to_remove(size_t number_of)
+{
+    const auto make = [](std::initializer_list<size_t> source) {
+        acmacs::Indexes indexes; // sorted, without duplicates
+        for (const auto no : source)
+            indexes.insert(no);
+        return indexes;
+    };
+    return {
+        make({0, 1}),
+        make({number_of / 2, number_of / 2 + 1}),
+        make({number_of - 2, number_of - 1}),
+        make({0, number_of - 1}),
+        make({0, number_of / 2, number_of / 2 + 1, number_of - 1}),
+    };
+
+} // multiple_indexes_to_remove
+
+// ----------------------------------------------------------------------
+
 void test_insert_antigen(acmacs::chart::ChartP chart, size_t before, const argc_argv& args, report_time report)
 {
     std::string exported;
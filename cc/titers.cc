@@ -256,7 +256,7 @@ void acmacs::chart::Titers::update(acmacs::chart::TableDistances& table_distance
     table_distances.dodgy_is_regular(parameters.dodgy_titer_is_regular);
     if (number_of_sera()) {
         for (const auto& titer_ref : titers_existing()) {
-            if (!parameters.disconnected.contains(titer_ref.antigen) && !parameters.disconnected.contains(titer_ref.serum + num_antigens))
+            if (!parameters.is_disconnected(titer_ref.antigen) && !parameters.is_disconnected(titer_ref.serum + num_antigens))
                 table_distances.update(titer_ref.titer, titer_ref.antigen, titer_ref.serum + num_antigens, column_bases.column_basis(titer_ref.serum), logged_adjusts[titer_ref.antigen] + logged_adjusts[titer_ref.serum + num_antigens], parameters.mult);
         }
     }